@@ -0,0 +1,200 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <cmath>
+#include "models.h"
+
+/*
+ * Adaptive Dormand-Prince 5(4) integration of the noise-free models.
+ *
+ * The right-hand sides are the stepper.h functors, built over noise arrays
+ * that read 0 and evaluated as f.begin(first, y1, y2) then f(y1, y2, ...)
+ * at every stage, so the source population s of the ant models follows the
+ * state continuously instead of being held for a step. The functor must be
+ * autonomous over the run; a model with a switch in time (the gaze window)
+ * is run one piece at a time.
+ *
+ * Each step is accepted when the rms of the embedded error estimate, scaled
+ * by atol + rtol*|y|, is at most 1, and the next step size follows from it.
+ * The results are written on the fixed grid t = i*h by the method's fourth
+ * order continuous extension, so the steps can be far longer than h.
+ */
+
+/* Dormand & Prince (1980) coefficients, with Hairer's dense output */
+#define DP_A21 (1.0/5)
+#define DP_A31 (3.0/40)
+#define DP_A32 (9.0/40)
+#define DP_A41 (44.0/45)
+#define DP_A42 (-56.0/15)
+#define DP_A43 (32.0/9)
+#define DP_A51 (19372.0/6561)
+#define DP_A52 (-25360.0/2187)
+#define DP_A53 (64448.0/6561)
+#define DP_A54 (-212.0/729)
+#define DP_A61 (9017.0/3168)
+#define DP_A62 (-355.0/33)
+#define DP_A63 (46732.0/5247)
+#define DP_A64 (49.0/176)
+#define DP_A65 (-5103.0/18656)
+#define DP_A71 (35.0/384)
+#define DP_A73 (500.0/1113)
+#define DP_A74 (125.0/192)
+#define DP_A75 (-2187.0/6784)
+#define DP_A76 (11.0/84)
+#define DP_E1 (71.0/57600)
+#define DP_E3 (-71.0/16695)
+#define DP_E4 (71.0/1920)
+#define DP_E5 (-17253.0/339200)
+#define DP_E6 (22.0/525)
+#define DP_E7 (-1.0/40)
+#define DP_D1 (-12715105075.0/11282082432)
+#define DP_D3 (87487479700.0/32700410799)
+#define DP_D4 (-10690763975.0/1880347072)
+#define DP_D5 (701980252875.0/199316789632)
+#define DP_D6 (-1453857185.0/822651844)
+#define DP_D7 (69997945.0/29380423)
+
+/* step size control: safety factor and the limits on how fast it may change */
+#define DP_SAFETY 0.9
+#define DP_SHRINK_MIN 0.2
+#define DP_GROW_MAX 10.0
+
+template <class RHS>
+struct Dopri5 {
+    RHS &f;
+    int first;                  /* step the noise-free functor is begun at */
+    const adaptive_tol_t *tol;
+    adaptive_stats_t *stats;
+
+    Dopri5(RHS &rhs, int first_step, const adaptive_tol_t *tolerances, adaptive_stats_t *s)
+        : f(rhs), first(first_step), tol(tolerances), stats(s) {}
+
+    inline void eval(double y1, double y2, double *dy1, double *dy2) {
+        f.begin(first, y1, y2);
+        f(y1, y2, dy1, dy2);
+        stats->rhs_evaluations++;
+    }
+
+    /* rms norm of (v1, v2) scaled by the tolerance at (y1, y2) */
+    inline double norm(double v1, double v2, double y1, double y2) const {
+        double e1 = v1 / (tol->atol + tol->rtol * fabs(y1));
+        double e2 = v2 / (tol->atol + tol->rtol * fabs(y2));
+        return sqrt((e1*e1 + e2*e2) / 2);
+    }
+
+    /* starting step, Hairer, Norsett & Wanner, Solving ODEs I, II.4 */
+    double initial_step(double y1, double y2, double k1_1, double k1_2, double span) {
+        double d0 = norm(y1, y2, y1, y2);
+        double d1 = norm(k1_1, k1_2, y1, y2);
+        double h0 = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+        if (h0 > span) h0 = span;
+
+        double f1, f2;
+        eval(y1 + h0*k1_1, y2 + h0*k1_2, &f1, &f2);
+        double d2 = norm(f1 - k1_1, f2 - k1_2, y1, y2) / h0;
+
+        double dmax = d1 > d2 ? d1 : d2;
+        double h1 = dmax <= 1e-15 ? fmax(1e-6, h0*1e-3) : pow(0.01/dmax, 1.0/5);
+        double step = fmin(100*h0, h1);
+        return step < span ? step : span;
+    }
+
+    /*
+     * advance grid steps first .. first+count-1 of spacing h; the result at
+     * step `first` is already in place and steps first+1 .. first+count are
+     * written
+     */
+    void run(double h, int count, double *results_y1, double *results_y2) {
+        if (count <= 0) return;
+        const int last = first + count;
+        const double t_end = last * h;
+        double t = first * h;
+        double y1 = results_y1[first];
+        double y2 = results_y2[first];
+
+        double k1_1, k1_2;
+        eval(y1, y2, &k1_1, &k1_2);
+        const double min_step = tol->min_step;
+        double dt = initial_step(y1, y2, k1_1, k1_2, t_end - t);
+        if (dt < min_step) dt = min_step;
+        bool rejected_last = false;
+        int next = first + 1;   /* next grid point to write */
+
+        while (next <= last) {
+            bool final_step = t + dt >= t_end || t_end - (t + dt) < 1e-12 * t_end;
+            if (final_step) dt = t_end - t;
+
+            double k2_1, k2_2, k3_1, k3_2, k4_1, k4_2, k5_1, k5_2, k6_1, k6_2, k7_1, k7_2;
+            eval(y1 + dt*(DP_A21*k1_1),
+                 y2 + dt*(DP_A21*k1_2), &k2_1, &k2_2);
+            eval(y1 + dt*(DP_A31*k1_1 + DP_A32*k2_1),
+                 y2 + dt*(DP_A31*k1_2 + DP_A32*k2_2), &k3_1, &k3_2);
+            eval(y1 + dt*(DP_A41*k1_1 + DP_A42*k2_1 + DP_A43*k3_1),
+                 y2 + dt*(DP_A41*k1_2 + DP_A42*k2_2 + DP_A43*k3_2), &k4_1, &k4_2);
+            eval(y1 + dt*(DP_A51*k1_1 + DP_A52*k2_1 + DP_A53*k3_1 + DP_A54*k4_1),
+                 y2 + dt*(DP_A51*k1_2 + DP_A52*k2_2 + DP_A53*k3_2 + DP_A54*k4_2), &k5_1, &k5_2);
+            eval(y1 + dt*(DP_A61*k1_1 + DP_A62*k2_1 + DP_A63*k3_1 + DP_A64*k4_1 + DP_A65*k5_1),
+                 y2 + dt*(DP_A61*k1_2 + DP_A62*k2_2 + DP_A63*k3_2 + DP_A64*k4_2 + DP_A65*k5_2), &k6_1, &k6_2);
+            double n1 = y1 + dt*(DP_A71*k1_1 + DP_A73*k3_1 + DP_A74*k4_1 + DP_A75*k5_1 + DP_A76*k6_1);
+            double n2 = y2 + dt*(DP_A71*k1_2 + DP_A73*k3_2 + DP_A74*k4_2 + DP_A75*k5_2 + DP_A76*k6_2);
+            eval(n1, n2, &k7_1, &k7_2);
+
+            double err1 = dt*(DP_E1*k1_1 + DP_E3*k3_1 + DP_E4*k4_1 + DP_E5*k5_1 + DP_E6*k6_1 + DP_E7*k7_1);
+            double err2 = dt*(DP_E1*k1_2 + DP_E3*k3_2 + DP_E4*k4_2 + DP_E5*k5_2 + DP_E6*k6_2 + DP_E7*k7_2);
+            double e1 = err1 / (tol->atol + tol->rtol * fmax(fabs(y1), fabs(n1)));
+            double e2 = err2 / (tol->atol + tol->rtol * fmax(fabs(y2), fabs(n2)));
+            double err = sqrt((e1*e1 + e2*e2) / 2);
+
+            /* a step too small to shorten further is taken as it is */
+            bool too_small = dt <= min_step || dt <= 1e-14 * fmax(fabs(t), 1.0);
+            if (err > 1.0 && !too_small) {
+                stats->rejected++;
+                dt *= fmax(DP_SHRINK_MIN, DP_SAFETY * pow(err, -1.0/5));
+                if (dt < min_step) dt = min_step;
+                rejected_last = true;
+                continue;
+            }
+
+            stats->accepted++;
+            if (stats->min_step == 0.0 || dt < stats->min_step) stats->min_step = dt;
+            if (dt > stats->max_step) stats->max_step = dt;
+
+            /* dense output on the grid points this step covers */
+            double t_new = final_step ? t_end : t + dt;
+            if (next <= last && next * h <= t_new) {
+                double diff1 = n1 - y1, diff2 = n2 - y2;
+                double b1 = dt*k1_1 - diff1, b2 = dt*k1_2 - diff2;
+                double c1 = diff1 - dt*k7_1 - b1, c2 = diff2 - dt*k7_2 - b2;
+                double d1 = dt*(DP_D1*k1_1 + DP_D3*k3_1 + DP_D4*k4_1 + DP_D5*k5_1 + DP_D6*k6_1 + DP_D7*k7_1);
+                double d2 = dt*(DP_D1*k1_2 + DP_D3*k3_2 + DP_D4*k4_2 + DP_D5*k5_2 + DP_D6*k6_2 + DP_D7*k7_2);
+                for (; next <= last && next * h <= t_new; next++) {
+                    if (next == last) {
+                        results_y1[next] = n1;
+                        results_y2[next] = n2;
+                        continue;
+                    }
+                    double theta = (next * h - t) / dt;
+                    double theta1 = 1.0 - theta;
+                    results_y1[next] = y1 + theta*(diff1 + theta1*(b1 + theta*(c1 + theta1*d1)));
+                    results_y2[next] = y2 + theta*(diff2 + theta1*(b2 + theta*(c2 + theta1*d2)));
+                }
+            }
+
+            /* first same as last: k7 is the derivative at the new point */
+            t = t_new;
+            y1 = n1;
+            y2 = n2;
+            k1_1 = k7_1;
+            k1_2 = k7_2;
+
+            double factor = err > 0.0 ? DP_SAFETY * pow(err, -1.0/5) : DP_GROW_MAX;
+            if (factor > DP_GROW_MAX) factor = DP_GROW_MAX;
+            if (factor < DP_SHRINK_MIN) factor = DP_SHRINK_MIN;
+            if (rejected_last && factor > 1.0) factor = 1.0;
+            dt *= factor;
+            rejected_last = false;
+        }
+    }
+};
+
+#endif // ADAPTIVE_H
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "benchmark.h"
+#include "buffer_pool.h"
+#include "ensemble.h"
+#include "model_registry.h"
+#include "models_batch.h"
+
+static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* the uniform and normal of the Philox generator before the ziggurat, one counter block a draw */
+static inline double box_muller_uniform(uint32_t hi, uint32_t lo) {
+    uint64_t bits = (((uint64_t)hi << 32) | lo) >> 11;
+    return (bits + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+static void box_muller_block(const noise_key_t *key, uint32_t stream, int n, double *out) {
+    for (int i=0; i<n; i++) {
+        uint32_t r[4];
+        rng_bits(key, stream, (uint32_t)i, r);
+        double u1 = box_muller_uniform(r[0], r[1]);
+        double u2 = box_muller_uniform(r[2], r[3]);
+        out[i] = sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+    }
+}
+
+/* fill in the speedups against the first row */
+static void set_speedups(benchmark_row_t *rows, int count) {
+    for (int i=0; i<count; i++) rows[i].speedup = rows[0].ns / rows[i].ns;
+}
+
+int benchmark_noise(benchmark_row_t *rows) {
+    batch_isa_t saved = batch_isa();
+    std::vector<double> out(BENCHMARK_DRAWS);
+    noise_key_t key = noise_key(42, 0);
+    double best[BENCHMARK_MAX_ROWS];
+    for (int i=0; i<BENCHMARK_MAX_ROWS; i++) best[i] = HUGE_VAL;
+
+    for (int rep=0; rep<BENCHMARK_REPEATS; rep++) {
+        double start = now();
+        box_muller_block(&key, rep, BENCHMARK_DRAWS, out.data());
+        best[0] = std::min(best[0], now() - start);
+
+        std::default_random_engine generator(rep);
+        std::normal_distribution<double> normal(0.0, 1.0);
+        start = now();
+        for (int i=0; i<BENCHMARK_DRAWS; i++) out[i] = normal(generator);
+        best[1] = std::min(best[1], now() - start);
+
+        for (int isa=BATCH_SCALAR; isa<=BATCH_AVX512; isa++) {
+            batch_set_isa((batch_isa_t)isa);
+            if (batch_isa() != isa) break;
+            start = now();
+            rng_normal_block(&key, rep, 0, BENCHMARK_DRAWS, 0.0, 1.0, out.data());
+            best[2+isa] = std::min(best[2+isa], now() - start);
+        }
+    }
+    batch_set_isa(saved);
+
+    int count = 0;
+    rows[count].name = "box-muller";
+    rows[count].isa = nullptr;
+    rows[count].ns = best[0] / BENCHMARK_DRAWS * 1e9;
+    count++;
+    rows[count].name = "std::normal_distribution";
+    rows[count].isa = nullptr;
+    rows[count].ns = best[1] / BENCHMARK_DRAWS * 1e9;
+    count++;
+    for (int isa=BATCH_SCALAR; isa<=BATCH_AVX512 && best[2+isa] < HUGE_VAL; isa++) {
+        rows[count].name = "ziggurat";
+        rows[count].isa = batch_isa_name((batch_isa_t)isa);
+        rows[count].ns = best[2+isa] / BENCHMARK_DRAWS * 1e9;
+        count++;
+    }
+    set_speedups(rows, count);
+    return count;
+}
+
+int benchmark_kernels(model_t m, int n_trials, benchmark_row_t *rows) {
+    const model_desc_t *desc = model_desc(m);
+    if (desc == nullptr || n_trials < 1) return 0;
+    batch_isa_t saved = batch_isa();
+    const int n = ENSEMBLE_CHUNK;
+    n_trials = (n_trials + n-1) / n * n;
+
+    std::vector<char> params(desc->params_size);
+    desc->set_defaults(params.data());
+    model_set_param_value(m, params.data(), "d", BENCHMARK_DURATION);
+    double y1_0 = 0., y2_0 = 0.;
+    model_get_param(m, params.data(), "y1_0", &y1_0);
+    model_get_param(m, params.data(), "y2_0", &y2_0);
+    int length = model_params_length(m, params.data());
+    int channels = desc->noise_channels;
+
+    /* the noise of trials 0 .. ENSEMBLE_CHUNK-1, each its own run for the scalar kernel and interleaved for the batch */
+    buffer_vector_t scalar_noise((size_t)n*channels*length);
+    buffer_vector_t batch_noise((size_t)channels*length*n);
+    std::vector<double *> trial_channels((size_t)n*channels);
+    std::vector<const double *> batch_channels(channels);
+    for (int j=0; j<n; j++) {
+        for (int c=0; c<channels; c++) trial_channels[j*channels+c] = scalar_noise.data() + ((size_t)j*channels + c)*length;
+        noise_key_t key = noise_key(1, j);
+        desc->fill_noise(params.data(), &key, 0, length, &trial_channels[j*channels]);
+    }
+    for (int c=0; c<channels; c++) {
+        double *row = batch_noise.data() + (size_t)c*length*n;
+        for (int i=0; i<length; i++) {
+            for (int j=0; j<n; j++) row[(size_t)i*n+j] = trial_channels[j*channels+c][i];
+        }
+        batch_channels[c] = row;
+    }
+    buffer_vector_t results_y1((size_t)length*n);
+    buffer_vector_t results_y2((size_t)length*n);
+
+    /* a params struct per trial, pointing at its noise */
+    std::vector<std::vector<char> > trial_params(n, params);
+    for (int j=0; j<n; j++) desc->set_noise_arrays(trial_params[j].data(), &trial_channels[j*channels]);
+
+    double best[BENCHMARK_MAX_ROWS];
+    for (int i=0; i<BENCHMARK_MAX_ROWS; i++) best[i] = HUGE_VAL;
+    for (int rep=0; rep<BENCHMARK_KERNEL_REPEATS; rep++) {
+        double start = now();
+        for (int t=0; t<n_trials; t++) {
+            results_y1[0] = y1_0;
+            results_y2[0] = y2_0;
+            desc->rk4_steps(trial_params[t % n].data(), 0, length-1, results_y1.data(), results_y2.data());
+        }
+        best[0] = std::min(best[0], now() - start);
+
+        for (int isa=BATCH_SCALAR; isa<=BATCH_AVX512; isa++) {
+            batch_set_isa((batch_isa_t)isa);
+            if (batch_isa() != isa) break;
+            start = now();
+            for (int t=0; t<n_trials; t+=n) {
+                model_rk4_batch(m, params.data(), n, batch_channels.data(), results_y1.data(), results_y2.data());
+            }
+            best[1+isa] = std::min(best[1+isa], now() - start);
+        }
+    }
+    batch_set_isa(saved);
+
+    double steps = (double)n_trials * (length-1);
+    int count = 0;
+    rows[count].name = "scalar kernel";
+    rows[count].isa = nullptr;
+    rows[count].ns = best[0] / steps * 1e9;
+    count++;
+    for (int isa=BATCH_SCALAR; isa<=BATCH_AVX512 && best[1+isa] < HUGE_VAL; isa++) {
+        rows[count].name = "batch kernel";
+        rows[count].isa = batch_isa_name((batch_isa_t)isa);
+        rows[count].ns = best[1+isa] / steps * 1e9;
+        count++;
+    }
+    set_speedups(rows, count);
+    return count;
+}
@@ -0,0 +1,53 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "simulation.h"
+
+/*
+ * The timings behind the speed figures given for the noise generator and
+ * the batch kernels, so they can be measured again on any machine (see -B
+ * in cli.cpp). Everything runs on the calling thread, each variant being
+ * timed a few times over (BENCHMARK_REPEATS for the noise,
+ * BENCHMARK_KERNEL_REPEATS for the kernels) and the best kept. Only the
+ * instruction sets the cpu supports are timed, and the one in use is
+ * restored after.
+ */
+
+#define BENCHMARK_REPEATS 15
+#define BENCHMARK_KERNEL_REPEATS 5
+
+/* normal draws timed per variant */
+#define BENCHMARK_DRAWS (1 << 18)
+
+/* duration of the trials the kernels are timed on */
+#define BENCHMARK_DURATION 50
+
+/* most rows either benchmark writes */
+#define BENCHMARK_MAX_ROWS 6
+
+/* one timed variant */
+typedef struct benchmark_row_s {
+    const char *name;
+    const char *isa;    /* the instruction set, null where it does not apply */
+    double ns;          /* per normal draw, or per step of a trial */
+    double speedup;     /* the first row's ns over this one's */
+} benchmark_row_t;
+
+/*
+ * BENCHMARK_DRAWS standard normals into one array: Box-Muller on Philox
+ * (the generator the ziggurat replaced), std::normal_distribution, then
+ * rng_normal_block on each instruction set. returns the rows written
+ */
+int benchmark_noise(benchmark_row_t *rows);
+
+/*
+ * the rk4 kernel over n_trials trials of duration BENCHMARK_DURATION with
+ * the other parameters at their defaults and the noise drawn beforehand
+ * (n_trials is rounded up to a multiple of ENSEMBLE_CHUNK):
+ * the scalar kernel called once per trial, then the batch kernels on
+ * ENSEMBLE_CHUNK trials at a time on each instruction set. returns the
+ * rows written
+ */
+int benchmark_kernels(model_t m, int n_trials, benchmark_row_t *rows);
+
+#endif // BENCHMARK_H
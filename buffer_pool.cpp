@@ -0,0 +1,121 @@
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#include "buffer_pool.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+/* pages are touched this far apart when a buffer is first taken from the system */
+#define BUFFER_PAGE 4096
+
+/* size classes: 4 to each power of two, from 64 bytes up */
+#define CLASS_STEPS 4
+#define CLASS_COUNT (CLASS_STEPS * 64)
+#define BUFFER_MAX_BYTES ((size_t)1 << 60)
+
+/*
+ * in front of every buffer, one cache line so that the buffer after it
+ * stays aligned: the class it was made for
+ */
+typedef struct buffer_header_s {
+    int size_class;
+    char pad[BUFFER_ALIGN - sizeof(int)];
+} buffer_header_t;
+
+typedef struct buffer_pool_s {
+    std::mutex lock;
+    std::vector<void *> free_lists[CLASS_COUNT];   /* headers of free buffers, by class */
+    size_t free_bytes;
+} buffer_pool_t;
+
+/* never destroyed, so buffers given back during exit still have somewhere to go */
+static buffer_pool_t &pool() {
+    static buffer_pool_t *p = new buffer_pool_t();
+    return *p;
+}
+
+/* bytes of a class: (CLASS_STEPS + k) / CLASS_STEPS * 2^e, for class e*CLASS_STEPS + k */
+static size_t class_bytes(int size_class) {
+    int e = size_class / CLASS_STEPS, k = size_class % CLASS_STEPS;
+    return ((size_t)(CLASS_STEPS + k) << e) / CLASS_STEPS;
+}
+
+/* the smallest class that holds bytes (at most BUFFER_MAX_BYTES) */
+static int size_class_of(size_t bytes) {
+    int e = 6;
+    while (((size_t)1 << (e + 1)) < bytes) e++;
+    int size_class = e * CLASS_STEPS;
+    while (class_bytes(size_class) < bytes) size_class++;
+    return size_class;
+}
+
+static void *system_alloc(size_t bytes) {
+#ifdef _WIN32
+    return _aligned_malloc(bytes, BUFFER_ALIGN);
+#else
+    void *p = nullptr;
+    return posix_memalign(&p, BUFFER_ALIGN, bytes) == 0 ? p : nullptr;
+#endif
+}
+
+static void system_free(void *p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+void *buffer_pool_alloc(size_t bytes) {
+    if (bytes > BUFFER_MAX_BYTES) throw std::bad_alloc();
+    int size_class = size_class_of(bytes > 0 ? bytes : 1);
+    size_t size = class_bytes(size_class);
+    buffer_pool_t &p = pool();
+    {
+        std::lock_guard<std::mutex> guard(p.lock);
+        std::vector<void *> &list = p.free_lists[size_class];
+        if (!list.empty()) {
+            void *header = list.back();
+            list.pop_back();
+            p.free_bytes -= size;
+            return (char *)header + sizeof(buffer_header_t);
+        }
+    }
+
+    buffer_header_t *header = (buffer_header_t *)system_alloc(sizeof(buffer_header_t) + size);
+    if (header == nullptr) throw std::bad_alloc();
+    header->size_class = size_class;
+
+    /* fault the pages in now, one write each, rather than in the middle of a run */
+    volatile char *buffer = (volatile char *)(header + 1);
+    for (size_t i=0; i<bytes; i+=BUFFER_PAGE) buffer[i] = 0;
+    return header + 1;
+}
+
+void buffer_pool_free(void *buffer) {
+    if (buffer == nullptr) return;
+    buffer_header_t *header = (buffer_header_t *)buffer - 1;
+    size_t size = class_bytes(header->size_class);
+    buffer_pool_t &p = pool();
+    {
+        std::lock_guard<std::mutex> guard(p.lock);
+        if (p.free_bytes + size <= BUFFER_POOL_MAX_BYTES) {
+            p.free_lists[header->size_class].push_back(header);
+            p.free_bytes += size;
+            return;
+        }
+    }
+    system_free(header);
+}
+
+void buffer_pool_trim() {
+    buffer_pool_t &p = pool();
+    std::lock_guard<std::mutex> guard(p.lock);
+    for (int c=0; c<CLASS_COUNT; c++) {
+        for (size_t i=0; i<p.free_lists[c].size(); i++) system_free(p.free_lists[c][i]);
+        p.free_lists[c].clear();
+    }
+    p.free_bytes = 0;
+}
@@ -0,0 +1,74 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*
+ * Recycled buffers for noise and results. Ensembles, sweeps and searches
+ * set up per thread buffers again for every call (and the threads with
+ * them), each fresh one costing an allocation and a page fault for every
+ * page the first run touches. Buffers taken from the pool come back to it
+ * when given up and are handed out again, already faulted in.
+ *
+ * Every buffer starts on a BUFFER_ALIGN boundary, a cache line, so the
+ * rows of a batch (see models_batch.h) whose width is a multiple of the
+ * widest vector never split a load across two lines. Sizes are rounded up
+ * to a quarter of a power of two, so a buffer serves any request within a
+ * quarter of its size. The pool is shared by all threads, as those here
+ * seldom outlive a call; it keeps at most BUFFER_POOL_MAX_BYTES of free
+ * buffers and returns the rest to the system.
+ */
+
+#define BUFFER_ALIGN 64
+#define BUFFER_POOL_MAX_BYTES ((size_t)512 << 20)
+
+/*
+ * at least bytes of memory, BUFFER_ALIGN aligned and with every page
+ * touched; the contents are whatever was left there. never null: throws
+ * std::bad_alloc as operator new does
+ */
+void *buffer_pool_alloc(size_t bytes);
+
+/* give a buffer from buffer_pool_alloc back (null is ignored) */
+void buffer_pool_free(void *buffer);
+
+/*
+ * return every free buffer to the system. for callers that keep buffers
+ * well apart rather than call after call, as the GUI's runs are, which
+ * would otherwise leave up to BUFFER_POOL_MAX_BYTES held for nothing
+ */
+void buffer_pool_trim();
+
+/*
+ * a std::allocator drawing from the pool, for std::vector. elements made
+ * without a value are default initialised, so resize leaves new doubles
+ * as they were (not zeroed): every user here writes before it reads
+ */
+template <class T>
+struct buffer_pool_allocator {
+    typedef T value_type;
+
+    buffer_pool_allocator() {}
+    template <class U> buffer_pool_allocator(const buffer_pool_allocator<U> &) {}
+
+    T *allocate(size_t n) { return (T *)buffer_pool_alloc(n * sizeof(T)); }
+    void deallocate(T *p, size_t) { buffer_pool_free(p); }
+
+    template <class U> void construct(U *p) { ::new((void *)p) U; }
+    template <class U, class... Args> void construct(U *p, Args&&... args) { ::new((void *)p) U(std::forward<Args>(args)...); }
+
+    template <class U> struct rebind { typedef buffer_pool_allocator<U> other; };
+};
+
+template <class T, class U>
+bool operator==(const buffer_pool_allocator<T> &, const buffer_pool_allocator<U> &) { return true; }
+template <class T, class U>
+bool operator!=(const buffer_pool_allocator<T> &, const buffer_pool_allocator<U> &) { return false; }
+
+/* the usual buffer of noise or results */
+typedef std::vector<double, buffer_pool_allocator<double> > buffer_vector_t;
+
+#endif // BUFFER_POOL_H
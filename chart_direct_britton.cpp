@@ -2,58 +2,19 @@
 
 /* for debugging */
 #include <iostream>
+#include <vector>
 
-ChartDirectBritton::ChartDirectBritton(params_direct_britton_t *p, QWidget *parent)
-    : QWidget(parent), params(p)
+ChartDirectBritton::ChartDirectBritton(SimulationRunPtr run, int available, QWidget *parent)
+    : ChartModel(run, parent)
 {
-    /* make the window sort of large */
-    setFixedSize(1000,600);
-
-    /* populate noise arrays using seed */
-    std::default_random_engine generator(params->seed);
-    int length = ceil(params->d/params->h);
-
-    params->cn_q1 = (double *)malloc(length * sizeof(*(params->cn_q1)));
-    params->cn_q2 = (double *)malloc(length * sizeof(*(params->cn_q2)));
-    params->cn_r1 = (double *)malloc(length * sizeof(*(params->cn_r1)));
-    params->cn_r2 = (double *)malloc(length * sizeof(*(params->cn_r2)));
-    params->cn_r1_prime = (double *)malloc(length * sizeof(*(params->cn_r1_prime)));
-    params->cn_r2_prime = (double *)malloc(length * sizeof(*(params->cn_r2_prime)));
-    params->cn_l1 = (double *)malloc(length * sizeof(*(params->cn_l1)));
-    params->cn_l2 = (double *)malloc(length * sizeof(*(params->cn_l2)));
-
-    direct_britton_set_noise(&generator,
-                    0.0,
-                    params->std_dev,
-                    length,
-                    params->cn_q1,
-                    params->cn_q2,
-                    params->cn_r1,
-                    params->cn_r2,
-                    params->cn_r1_prime,
-                    params->cn_r2_prime,
-                    params->cn_l1,
-                    params->cn_l2);
-
-    /* get results of approximation */
-    results_y1 = (double *)malloc(length * sizeof(*results_y1));
-    results_y2 = (double *)malloc(length * sizeof(*results_y2));
-
-    // note: function call will set initial conditions
-    direct_britton_rk4(params, results_y1, results_y2);
-
-    /* create series to chart */
-    double t;
+    const params_direct_britton_t &params = *(const params_direct_britton_t *)simulation->params();
+
+    int length = ceil(params.d/params.h);
+
+    /* create series to chart: ChartLOD fills them from the results */
     QtCharts::QLineSeries *series1 = new QtCharts::QLineSeries();
     QtCharts::QLineSeries *series2 = new QtCharts::QLineSeries();
     QtCharts::QLineSeries *source_population = new QtCharts::QLineSeries();
-    t = 0.;
-    for(int i=0;i<length;i++) {
-        series1->append(t,results_y1[i]);
-        series2->append(t,results_y2[i]);
-        source_population->append(t,params->population-results_y1[i]-results_y2[i]);
-        t += params->h;
-    }
 
     /* set series options */
     series1->setName("Nest A");
@@ -71,9 +32,8 @@ ChartDirectBritton::ChartDirectBritton(params_direct_britton_t *p, QWidget *pare
     chart->legend()->setVisible(true);
     //chart->setTitle("Simplified Direct Britton Model");
 
-    /* this will animate the series as it is displayed */
-    chart->setAnimationOptions(QtCharts::QChart::SeriesAnimations);
-    chart->setAnimationDuration(3000);  // duration in milliseconds
+    /* no animations: ChartLOD refills the series on every zoom, resize and live frame */
+    chart->setAnimationOptions(QtCharts::QChart::NoAnimation);
 
     /* create axes */
     /* time axis */
@@ -82,8 +42,8 @@ ChartDirectBritton::ChartDirectBritton(params_direct_britton_t *p, QWidget *pare
     axisX->setGridLineVisible(false);
 
     /* activation axis */
-    QtCharts::QValueAxis *axisY = new QtCharts::QValueAxis;
-    axisY->setRange(-1.0,params->population);
+    QtCharts::QValueAxis *axisY = axis_y = new QtCharts::QValueAxis;
+    axisY->setRange(-1.0,params.population);
     axisY->setTitleText("Population");
     axisY->setGridLineVisible(false);
 
@@ -104,63 +64,30 @@ ChartDirectBritton::ChartDirectBritton(params_direct_britton_t *p, QWidget *pare
     source_population->attachAxis(axisX);
     source_population->attachAxis(axisY);
 
-    /* chart view goes on top */
-    chart_view = new QtCharts::QChartView(chart);
-    chart_view->setRenderHint(QPainter::Antialiasing);
-
-    /* button box comes next */
-    button_box = new QGroupBox;
-    QHBoxLayout *button_layout = new QHBoxLayout;
-    m_button_print = new QPushButton("print", this);
-    m_button_close = new QPushButton("close", this);
-    button_layout->addWidget(m_button_print);
-    button_layout->addWidget(m_button_close);
-    button_box->setLayout(button_layout);
-
-    /* assemble window: main layout */
-    QVBoxLayout *main_layout = new QVBoxLayout;
-    main_layout->addWidget(chart_view);
-    main_layout->addWidget(button_box);
-
-    setLayout(main_layout);
-    setWindowTitle(tr("Simplified Direct Britton Model"));
-    show();
-
-    /* wire the signals */
-    connect(m_button_print, SIGNAL (clicked()), this, SLOT(slot_print()));
-    connect(m_button_close, SIGNAL (clicked()), this, SLOT(slot_close()));
+    /* feed the series through min/max pyramids, as finely as the plot can show */
+    lod = new ChartLOD(chart, axisX, params.h, length, this);
+    lod->add_series(series1, nullptr, 0);
+    lod->add_series(series2, nullptr, 0);
+    lod->add_series(source_population, nullptr, 0);
+    append_results(0, available);
+    lod->show_all();
+
+    show_window(chart, tr("Simplified Direct Britton Model"));
 }
 
-void ChartDirectBritton::slot_close() {
-    free(params->cn_q1);
-    free(params->cn_q2);
-    free(params->cn_r1);
-    free(params->cn_r2);
-    free(params->cn_l1);
-    free(params->cn_l2);
-    free(params->cn_r1_prime);
-    free(params->cn_r2_prime);
-    free(results_y1);
-    free(results_y2);
-    this->close();
+void ChartDirectBritton::append_series(int from, int count) {
+    const params_direct_britton_t &params = *(const params_direct_britton_t *)simulation->params();
+    const double *results_y1 = simulation->y1();
+    const double *results_y2 = simulation->y2();
+
+    /* the series drawn from both results */
+    std::vector<double> source(count);
+    for(int i=0;i<count;i++) source[i] = params.population-results_y1[from+i]-results_y2[from+i];
+
+    lod->append(2, source.data(), count);
 }
 
-void ChartDirectBritton::slot_print() {
-    /* create a printer */
-    QPrinter *printer = new QPrinter(QPrinter::HighResolution);
-    //printer->setOrientation(QPrinter::Landscape);
-    QPrintDialog *dialog = new QPrintDialog(printer);
-    dialog->setWindowTitle("Print Chart");
-    if (dialog->exec() != QDialog::Accepted)
-        return;
-
-    /* make a painter to paint onto the pages of the printer */
-    QPainter *painter = new QPainter();
-    painter->begin(printer);
-    painter->setRenderHint(QPainter::Antialiasing);
-    chart_view->render(painter, printer->pageRect());
-    painter->end();
-    delete(dialog);
-    delete(painter);
-    delete(printer);
+void ChartDirectBritton::set_axes() {
+    const params_direct_britton_t &params = *(const params_direct_britton_t *)simulation->params();
+    axis_y->setRange(-1.0,params.population);
 }
@@ -2,64 +2,20 @@
 
 /* for debugging */
 #include <iostream>
+#include <vector>
 
-ChartGaze::ChartGaze(params_gaze_t *p, QWidget *parent)
-    : QWidget(parent), params(p)
+ChartGaze::ChartGaze(SimulationRunPtr run, int available, QWidget *parent)
+    : ChartModel(run, parent)
 {
-    /* make the window sort of large */
-    setFixedSize(1000,600);
-
-    /* populate noise arrays using seed */
-    // if we wanted a seed from time: unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::default_random_engine generator(params->seed);
-    int length = ceil(params->d/params->h);
-    params->n_I1 = (double *)malloc(length * sizeof(*(params->n_I1)));
-    params->n_I2 = (double *)malloc(length * sizeof(*(params->n_I2)));
-    params->n_w1 = (double *)malloc(length * sizeof(*(params->n_w1)));
-    params->n_w2 = (double *)malloc(length * sizeof(*(params->n_w2)));
-    params->n_g1 = (double *)malloc(length * sizeof(*(params->n_g1)));
-    params->n_g2 = (double *)malloc(length * sizeof(*(params->n_g2)));
-    params->n_l1 = (double *)malloc(length * sizeof(*(params->n_l1)));
-    params->n_l2 = (double *)malloc(length * sizeof(*(params->n_l2)));
-
-    gaze_set_noise(&generator,
-                   0.0,
-                   params->n_std_dev,
-                   length,
-                   params->n_I1,
-                   params->n_I2,
-                   params->n_w1,
-                   params->n_w2,
-                   params->n_g1,
-                   params->n_g2,
-                   params->n_l1,
-                   params->n_l2);
-
-    /* get results of approximation */
-    results_y1 = (double *)malloc(length * sizeof(*results_y1));
-    results_y2 = (double *)malloc(length * sizeof(*results_y2));
-
-    // note: function call sets initial conditions
-    gaze_rk4(&generator, params, results_y1, results_y2);
-
-    /* create series to chart */
-    double t;
+    const params_gaze_t &params = *(const params_gaze_t *)simulation->params();
+
+    int length = ceil(params.d/params.h);
+
+    /* create series to chart: ChartLOD fills them from the results */
     QtCharts::QLineSeries *series1 = new QtCharts::QLineSeries();
     QtCharts::QLineSeries *series2 = new QtCharts::QLineSeries();
     QtCharts::QLineSeries *series_diff = new QtCharts::QLineSeries();
     QtCharts::QLineSeries *series_gaze = new QtCharts::QLineSeries();
-    t = 0.;
-    for(int i=0;i<length;i++) {
-        series_diff->append(t,results_y1[i]-results_y2[i]);
-        series1->append(t,results_y1[i]);
-        series2->append(t,results_y2[i]);
-        if(params->gaze_start >= params->gaze_end) {
-            series_gaze->append(t,-1.5);
-        } else if (t >= params->gaze_start && t <= params->gaze_end) {
-            series_gaze->append(t,-1.0);
-        } else series_gaze->append(t,-1.5);
-        t += params->h;
-    }
 
     /* set series options */
     series1->setName("y1 activation");
@@ -77,9 +33,8 @@ ChartGaze::ChartGaze(params_gaze_t *p, QWidget *parent)
     chart->legend()->setVisible(true);
     //chart->setTitle("Gaze Model");
 
-    /* this will animate the series as it is displayed */
-    chart->setAnimationOptions(QtCharts::QChart::SeriesAnimations);
-    chart->setAnimationDuration(3000);  // duration in milliseconds
+    /* no animations: ChartLOD refills the series on every zoom, resize and live frame */
+    chart->setAnimationOptions(QtCharts::QChart::NoAnimation);
 
     /* create axes */
     /* time axis */
@@ -123,63 +78,36 @@ ChartGaze::ChartGaze(params_gaze_t *p, QWidget *parent)
     series_gaze->attachAxis(axisX);
     series_gaze->attachAxis(axisY);
 
-    /* main chart view goes on top */
-    chart_view = new QtCharts::QChartView(chart);
-    chart_view->setRenderHint(QPainter::Antialiasing);
-
-    /* button box comes next */
-    button_box = new QGroupBox;
-    QHBoxLayout *button_layout = new QHBoxLayout;
-    m_button_print = new QPushButton("print", this);
-    m_button_close = new QPushButton("close", this);
-    button_layout->addWidget(m_button_print);
-    button_layout->addWidget(m_button_close);
-    button_box->setLayout(button_layout);
-
-    /* assemble window: main layout */
-    QVBoxLayout *main_layout = new QVBoxLayout;
-    main_layout->addWidget(chart_view);
-    main_layout->addWidget(button_box);
-
-    setLayout(main_layout);
-    setWindowTitle(tr("Gaze Model"));
-    show();
-
-    /* wire the signals */
-    connect(m_button_close, SIGNAL (clicked()), this, SLOT(slot_close()));
-    connect(m_button_print, SIGNAL (clicked()), this, SLOT(slot_print()));
-}
+    /* feed the series through min/max pyramids, as finely as the plot can show */
+    lod = new ChartLOD(chart, axisX, params.h, length, this);
+    lod->add_series(series1, nullptr, 0);
+    lod->add_series(series2, nullptr, 0);
+    lod->add_series(series_diff, nullptr, 0);
+    lod->add_series(series_gaze, nullptr, 0);
+    append_results(0, available);
+    lod->show_all();
 
-void ChartGaze::slot_close() {
-    free(params->n_I1);
-    free(params->n_I2);
-    free(params->n_w1);
-    free(params->n_w2);
-    free(params->n_g1);
-    free(params->n_g2);
-    free(params->n_l1);
-    free(params->n_l2);
-    free(results_y1);
-    free(results_y2);
-    this->close();
+    show_window(chart, tr("Gaze Model"));
 }
 
-void ChartGaze::slot_print() {
-    /* create a printer */
-    QPrinter *printer = new QPrinter(QPrinter::HighResolution);
-    //printer->setOrientation(QPrinter::Landscape);
-    QPrintDialog *dialog = new QPrintDialog(printer);
-    dialog->setWindowTitle("Print Chart");
-    if (dialog->exec() != QDialog::Accepted)
-        return;
-
-    /* make a painter to paint onto the pages of the printer */
-    QPainter *painter = new QPainter();
-    painter->begin(printer);
-    painter->setRenderHint(QPainter::Antialiasing);
-    chart_view->render(painter, printer->pageRect());
-    painter->end();
-    delete(dialog);
-    delete(painter);
-    delete(printer);
+void ChartGaze::append_series(int from, int count) {
+    const params_gaze_t &params = *(const params_gaze_t *)simulation->params();
+    const double *results_y1 = simulation->y1();
+    const double *results_y2 = simulation->y2();
+
+    /* the series drawn from both results */
+    std::vector<double> diff(count);
+    std::vector<double> gaze(count);
+    for(int i=0;i<count;i++) {
+        double t = (from+i)*params.h;
+        diff[i] = results_y1[from+i]-results_y2[from+i];
+        if(params.gaze_start >= params.gaze_end) {
+            gaze[i] = -1.5;
+        } else if (t >= params.gaze_start && t <= params.gaze_end) {
+            gaze[i] = -1.0;
+        } else gaze[i] = -1.5;
+    }
+
+    lod->append(2, diff.data(), count);
+    lod->append(3, gaze.data(), count);
 }
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <QList>
+#include <QPointF>
+#include "chart_lod.h"
+
+/* buckets to use before the chart has been laid out */
+#define LOD_DEFAULT_BUCKETS 1000
+
+ChartLOD::ChartLOD(QtCharts::QChart *c, QtCharts::QValueAxis *axis, double step, int run_length, QObject *parent)
+    : QObject(parent), chart(c), axis_x(axis), h(step), length(run_length), refilling(false)
+{
+    connect(axis_x, SIGNAL (rangeChanged(qreal,qreal)), this, SLOT(slot_range_changed(qreal,qreal)));
+    connect(chart, SIGNAL (plotAreaChanged(QRectF)), this, SLOT(slot_plot_area_changed(QRectF)));
+}
+
+ChartLOD::~ChartLOD() {
+    for (size_t s=0; s<series_list.size(); s++) lod_pyramid_destroy(series_list[s].pyramid);
+}
+
+int ChartLOD::add_series(QtCharts::QLineSeries *series, const double *values, int count) {
+    lod_series_t entry;
+    entry.series = series;
+    entry.pyramid = lod_pyramid_create(values, count);
+    series_list.push_back(entry);
+    return (int)series_list.size() - 1;
+}
+
+void ChartLOD::append(int index, const double *values, int count) {
+    lod_pyramid_append(series_list[index].pyramid, values, count);
+}
+
+void ChartLOD::show_all() {
+    double t_max = length > 1 ? (length - 1) * h : h;
+
+    refilling = true;
+    axis_x->setRange(0., t_max);
+    refilling = false;
+    refill(0., t_max);
+}
+
+void ChartLOD::refresh() {
+    refill(axis_x->min(), axis_x->max());
+}
+
+bool ChartLOD::reset(double step, int run_length) {
+    for (size_t s=0; s<series_list.size(); s++) {
+        lod_pyramid_destroy(series_list[s].pyramid);
+        series_list[s].pyramid = lod_pyramid_create(nullptr, 0);
+    }
+    bool changed = step != h || run_length != length;
+    h = step;
+    length = run_length;
+    return changed;
+}
+
+void ChartLOD::extend(int run_length) {
+    length = run_length;
+}
+
+void ChartLOD::refill(double t_min, double t_max) {
+    int buckets = (int)chart->plotArea().width();
+    if (buckets < 1) buckets = LOD_DEFAULT_BUCKETS;
+    indices.resize(LOD_POINTS_PER_BUCKET * buckets);
+
+    /* one step beyond either end, so the lines run to the edges of the plot */
+    double first = std::max(floor(t_min / h) - 1., 0.);
+    double last = std::min(ceil(t_max / h) + 1., (double)INT_MAX - 1.);
+
+    refilling = true;
+    for (size_t s=0; s<series_list.size(); s++) {
+        const lod_pyramid_t *pyramid = series_list[s].pyramid;
+        int n = lod_decimate(pyramid, (int)first, (int)last + 1, buckets, indices.data());
+        QList<QPointF> points;
+        points.reserve(n);
+        for (int i=0; i<n; i++) points.append(QPointF(indices[i] * h, lod_pyramid_value(pyramid, indices[i])));
+        series_list[s].series->replace(points);
+    }
+    refilling = false;
+}
+
+void ChartLOD::slot_range_changed(qreal min, qreal max) {
+    if (refilling) return;
+    refill(min, max);
+}
+
+void ChartLOD::slot_plot_area_changed(const QRectF &plot_area) {
+    (void)plot_area;
+    if (refilling) return;
+    refresh();
+}
@@ -0,0 +1,68 @@
+#ifndef CHART_LOD_H
+#define CHART_LOD_H
+
+#include <QChart>
+#include <QLineSeries>
+#include <QObject>
+#include <QRectF>
+#include <QValueAxis>
+#include <vector>
+#include "lod.h"
+
+/*
+ * Feeds the line series of a chart from min/max pyramids (see lod.h), so a
+ * chart only ever holds a few points per pixel of its plot area: however
+ * long the run, drawing, resizing and zooming cost the same. The series are
+ * filled again for the visible time range whenever the time axis or the
+ * plot area changes, so zooming in brings back the detail, down to every
+ * step. A chart of a run still going is given its results as they come,
+ * with append and refresh.
+ */
+class ChartLOD : public QObject
+{
+    Q_OBJECT
+public:
+    /* the time axis starts at 0 and goes up by h per value, length of them in the whole run */
+    ChartLOD(QtCharts::QChart *chart, QtCharts::QValueAxis *axis_x, double h, int length, QObject *parent = 0);
+    ~ChartLOD();
+
+    /* chart values (count of them so far, copied) in series; returns its index */
+    int add_series(QtCharts::QLineSeries *series, const double *values, int count);
+
+    /* add count more values to series index, drawn at the next refresh */
+    void append(int index, const double *values, int count);
+
+    /* show the whole run, as much of it as there is */
+    void show_all();
+
+    /* draw the visible range again */
+    void refresh();
+
+    /* empty every series for a new run; returns whether its time axis differs from the last */
+    bool reset(double h, int length);
+
+    /* the run charted goes on to length values, the series keeping those they have */
+    void extend(int length);
+
+private:
+    typedef struct lod_series_s {
+        QtCharts::QLineSeries *series;
+        lod_pyramid_t *pyramid;
+    } lod_series_t;
+
+    void refill(double t_min, double t_max);
+
+    QtCharts::QChart *chart;
+    QtCharts::QValueAxis *axis_x;
+    double h;
+    int length;
+    std::vector<lod_series_t> series_list;
+    std::vector<int> indices;
+    bool refilling;     /* ignore the range changes our own updates cause */
+
+private slots:
+    void slot_range_changed(qreal min, qreal max);
+    void slot_plot_area_changed(const QRectF &plot_area);
+};
+
+#endif // CHART_LOD_H
@@ -0,0 +1,128 @@
+#include <QHBoxLayout>
+#include <QPainter>
+#include <QPrintDialog>
+#include <QPrinter>
+#include <QVBoxLayout>
+#include "chart_model.h"
+#include "chart_um.h"
+#include "chart_pratt.h"
+#include "chart_indirect_britton.h"
+#include "chart_direct_britton.h"
+#include "chart_gaze.h"
+
+ChartModel::ChartModel(SimulationRunPtr run, QWidget *parent)
+    : QWidget(parent), simulation(run), lod(nullptr)
+{
+    /* closing the window frees it, and the run with it unless something else holds it */
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    /* make the window sort of large */
+    setFixedSize(1000,600);
+}
+
+void ChartModel::append_results(int from, int to) {
+    int count = to - from;
+    if (count <= 0) return;
+
+    lod->append(0, simulation->y1() + from, count);
+    lod->append(1, simulation->y2() + from, count);
+    append_series(from, count);
+    lod->refresh();
+}
+
+void ChartModel::set_results(SimulationRunPtr run, int available) {
+    simulation = run;
+    double h = 0.;
+    model_get_param(simulation->model(), simulation->params(), "h", &h);
+    bool new_axis = lod->reset(h, simulation->length());
+    set_axes();
+    append_results(0, available);
+    if (new_axis) lod->show_all();
+    else lod->refresh();
+}
+
+void ChartModel::extend_results(SimulationRunPtr run, int available) {
+    int shown = simulation->length();
+    simulation = run;
+    lod->extend(simulation->length());
+    append_results(shown, available);
+    lod->show_all();
+}
+
+void ChartModel::show_window(QtCharts::QChart *chart, const QString &title) {
+    /* chart view goes on top */
+    chart_view = new QtCharts::QChartView(chart);
+    chart_view->setRenderHint(QPainter::Antialiasing);
+
+    /* drag across the chart to zoom in on a time range, right click to zoom out */
+    chart_view->setRubberBand(QtCharts::QChartView::HorizontalRubberBand);
+
+    /* button box comes next */
+    button_box = new QGroupBox;
+    QHBoxLayout *button_layout = new QHBoxLayout;
+    m_button_print = new QPushButton("print", this);
+    m_button_close = new QPushButton("close", this);
+    button_layout->addWidget(m_button_print);
+    button_layout->addWidget(m_button_close);
+    button_box->setLayout(button_layout);
+
+    /* assemble window: main layout */
+    QVBoxLayout *main_layout = new QVBoxLayout;
+    main_layout->addWidget(chart_view);
+    main_layout->addWidget(button_box);
+
+    setLayout(main_layout);
+    setWindowTitle(title);
+    show();
+
+    /* wire the signals */
+    connect(m_button_print, SIGNAL (clicked()), this, SLOT(slot_print()));
+    connect(m_button_close, SIGNAL (clicked()), this, SLOT(slot_close()));
+}
+
+void ChartModel::slot_close() {
+    this->close();
+}
+
+void ChartModel::slot_print() {
+    /* create a printer */
+    QPrinter *printer = new QPrinter(QPrinter::HighResolution);
+    //printer->setOrientation(QPrinter::Landscape);
+    QPrintDialog *dialog = new QPrintDialog(printer);
+    dialog->setWindowTitle("Print Chart");
+    if (dialog->exec() != QDialog::Accepted)
+        return;
+
+    /* make a painter to paint onto the pages of the printer */
+    QPainter *painter = new QPainter();
+    painter->begin(printer);
+    painter->setRenderHint(QPainter::Antialiasing);
+    chart_view->render(painter, printer->pageRect());
+    painter->end();
+    delete(dialog);
+    delete(painter);
+    delete(printer);
+}
+
+typedef ChartModel *(*chart_factory_t)(SimulationRunPtr run, int available);
+
+template <class Chart>
+static ChartModel *create_chart(SimulationRunPtr run, int available)
+{
+    return new Chart(run, available);
+}
+
+/* in model_t order */
+static const chart_factory_t chart_factories[MODEL_COUNT] = {
+    create_chart<ChartUM>,
+    create_chart<ChartPratt>,
+    create_chart<ChartIndirectBritton>,
+    create_chart<ChartDirectBritton>,
+    create_chart<ChartGaze>,
+};
+
+ChartModel *chart_create(SimulationRunPtr run, int available)
+{
+    unsigned m = run->model();
+    return m < MODEL_COUNT ? chart_factories[m](run, available) : nullptr;
+}
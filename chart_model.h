@@ -0,0 +1,70 @@
+#ifndef CHART_MODEL_H
+#define CHART_MODEL_H
+
+#include <QChart>
+#include <QChartView>
+#include <QGroupBox>
+#include <QPushButton>
+#include <QString>
+#include <QWidget>
+#include "chart_lod.h"
+#include "simulation_run.h"
+
+/*
+ * A chart window of a run, whatever the model: what the main window feeds
+ * and replaces, so it charts every model the same way. Each model's chart
+ * (ChartUM, ChartPratt, ...) builds its chart and ChartLOD, y1 and y2 first
+ * and then the series it draws from them; feeding results to the series,
+ * taking a new or longer run, the window around the chart and printing are
+ * done here for all of them. chart_create picks the model's chart.
+ */
+class ChartModel : public QWidget
+{
+    Q_OBJECT
+public:
+    /* the chart holds run, and frees it with itself when its window is closed */
+    explicit ChartModel(SimulationRunPtr run, QWidget *parent = 0);
+
+    /* chart results from .. to-1 of the run too, as it brings them */
+    void append_results(int from, int to);
+
+    /* chart a new run in place of the one shown, as the constructor */
+    void set_results(SimulationRunPtr run, int available);
+
+    /* chart run, the one shown with a longer d: its results from the end of those shown to available */
+    void extend_results(SimulationRunPtr run, int available);
+
+protected:
+    /* results from .. from+count-1 of the run into the model's own series, from index 2 of lod */
+    virtual void append_series(int from, int count) = 0;
+
+    /* set the axes that depend on the parameters again, for a new run */
+    virtual void set_axes() {}
+
+    /* the window: chart above the print and close buttons, titled title */
+    void show_window(QtCharts::QChart *chart, const QString &title);
+
+    /* the run charted, with its own copy of the parameters */
+    SimulationRunPtr simulation;
+
+    /* feeds the series; made by the model's chart */
+    ChartLOD *lod;
+
+private:
+    /* window component: the chart */
+    QtCharts::QChartView *chart_view;
+
+    /* window component: button box */
+    QGroupBox *button_box;
+    QPushButton *m_button_print;
+    QPushButton *m_button_close;
+
+private slots:
+    void slot_close();
+    void slot_print();
+};
+
+/* a new chart window for run, charting the first `available` of its results; null for a model without one */
+ChartModel *chart_create(SimulationRunPtr run, int available);
+
+#endif // CHART_MODEL_H
@@ -1,50 +1,27 @@
 #ifndef CHART_PRATT_H
 #define CHART_PRATT_H
 
-#include <QApplication>
 #include <QChart>
 #include <QtCharts/QCategoryAxis>
-#include <QChartView>
-#include <QFlags>
-#include <QGroupBox>
 #include <QLineSeries>
-#include <QPrinter>
-#include <QPrintDialog>
-#include <QPushButton>
 #include <QValueAxis>
-#include <QVBoxLayout>
-#include <QWidget>
 #include "models.h"
+#include "chart_model.h"
 
-class ChartPratt : public QWidget
+class ChartPratt : public ChartModel
 {
     Q_OBJECT
 public:
-    explicit ChartPratt(params_pratt_t *p, QWidget *parent = 0);
+    /* chart run, the first `available` of its results so far */
+    ChartPratt(SimulationRunPtr run, int available, QWidget *parent = 0);
 
-private:
-    /* pointer to parameters */
-    params_pratt_t *params;
-
-    /* simulation results */
-    double * results_y1;
-    double * results_y2;
-
-    /* window component: the chart */
-    QtCharts::QChartView *chart_view;
-
-    /* window component: button box */
-    QGroupBox *button_box;
-    QPushButton *m_button_print;
-    QPushButton *m_button_close;
+protected:
+    /* the source population, population - y1 - y2 */
+    void append_series(int from, int count);
+    void set_axes();
 
-signals:
-
-public slots:
-
-private slots:
-    void slot_close();
-    void slot_print();
+private:
+    QtCharts::QValueAxis *axis_y;   /* population: set again for a new run */
 };
 
 #endif // CHART_PRATT_H
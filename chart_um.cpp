@@ -2,41 +2,19 @@
 
 /* for debugging */
 #include <iostream>
+#include <vector>
 
-ChartUM::ChartUM(params_um_t *p, QWidget *parent)
-    : QWidget(parent), params(p)
+ChartUM::ChartUM(SimulationRunPtr run, int available, QWidget *parent)
+    : ChartModel(run, parent)
 {
-    /* make the window sort of large */
-    setFixedSize(1000,600);
-
-    /* populate noise arrays using seed */
-    // if we wanted a seed from time: unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::default_random_engine generator(params->seed);
-    int length = ceil(params->d/params->h);
-    params->cn1 = (double *)malloc(length * sizeof(*(params->cn1)));
-    params->cn2 = (double *)malloc(length * sizeof(*(params->cn2)));
-    um_set_noise(&generator, 0.0, params->std_dev, length, params->cn1, params->cn2);
-
-    /* get results of approximation */
-    results_y1 = (double *)malloc(length * sizeof(*results_y1));
-    results_y2 = (double *)malloc(length * sizeof(*results_y2));
-
-    /* note: function call sets initial conditions */
-    usher_mcclelland_rk4(params, results_y1, results_y2);
-    //usher_mcclelland_eulers(params, results_y1, results_y2);
-
-    /* create series to chart */
-    double t;
+    const params_um_t &params = *(const params_um_t *)simulation->params();
+
+    int length = ceil(params.d/params.h);
+
+    /* create series to chart: ChartLOD fills them from the results */
     QtCharts::QLineSeries *series1 = new QtCharts::QLineSeries();
     QtCharts::QLineSeries *series2 = new QtCharts::QLineSeries();
     QtCharts::QLineSeries *series_diff = new QtCharts::QLineSeries();
-    t = 0.;
-    for(int i=0;i<length;i++) {
-        series_diff->append(t,results_y1[i]-results_y2[i]);
-        series1->append(t,results_y1[i]);
-        series2->append(t,results_y2[i]);
-        t += params->h;
-    }
 
     /* set series options */
     series1->setName("y1 activation");
@@ -53,9 +31,8 @@ ChartUM::ChartUM(params_um_t *p, QWidget *parent)
     chart->legend()->setVisible(true);
     //chart->setTitle("Usher-McClelland Model");
 
-    /* this will animate the series as it is displayed */
-    chart->setAnimationOptions(QtCharts::QChart::SeriesAnimations);
-    chart->setAnimationDuration(3000);  // duration in milliseconds
+    /* no animations: ChartLOD refills the series on every zoom, resize and live frame */
+    chart->setAnimationOptions(QtCharts::QChart::NoAnimation);
 
     /* create axes */
     /* time axis */
@@ -96,57 +73,24 @@ ChartUM::ChartUM(params_um_t *p, QWidget *parent)
     series_diff->attachAxis(axisY);
     series_diff->attachAxis(axisX);
 
-    /* chart view goes on top */
-    chart_view = new QtCharts::QChartView(chart);
-    chart_view->setRenderHint(QPainter::Antialiasing);
-
-    /* button box comes next */
-    button_box = new QGroupBox;
-    QHBoxLayout *button_layout = new QHBoxLayout;
-    m_button_close = new QPushButton("close", this);
-    m_button_print = new QPushButton("print", this);
-    button_layout->addWidget(m_button_print);
-    button_layout->addWidget(m_button_close);
-    button_box->setLayout(button_layout);
-
-    /* assemble window: main layout */
-    QVBoxLayout *main_layout = new QVBoxLayout;
-    main_layout->addWidget(chart_view);
-    main_layout->addWidget(button_box);
-
-    setLayout(main_layout);
-    setWindowTitle(tr("Usher-McClelland Model"));
-    show();
-
-    /* wire the signals */
-    connect(m_button_print, SIGNAL (clicked()), this, SLOT(slot_print()));
-    connect(m_button_close, SIGNAL (clicked()), this, SLOT(slot_close()));
-}
+    /* feed the series through min/max pyramids, as finely as the plot can show */
+    lod = new ChartLOD(chart, axisX, params.h, length, this);
+    lod->add_series(series1, nullptr, 0);
+    lod->add_series(series2, nullptr, 0);
+    lod->add_series(series_diff, nullptr, 0);
+    append_results(0, available);
+    lod->show_all();
 
-void ChartUM::slot_close() {
-    free(params->cn1);
-    free(params->cn2);
-    free(results_y1);
-    free(results_y2);
-    this->close();
+    show_window(chart, tr("Usher-McClelland Model"));
 }
 
-void ChartUM::slot_print() {
-    /* create a printer */
-    QPrinter *printer = new QPrinter(QPrinter::HighResolution);
-    //printer->setOrientation(QPrinter::Landscape);
-    QPrintDialog *dialog = new QPrintDialog(printer);
-    dialog->setWindowTitle("Print Chart");
-    if (dialog->exec() != QDialog::Accepted)
-        return;
-
-    /* make a painter to paint onto the pages of the printer */
-    QPainter *painter = new QPainter();
-    painter->begin(printer);
-    painter->setRenderHint(QPainter::Antialiasing);
-    chart_view->render(painter, printer->pageRect());
-    painter->end();
-    delete(dialog);
-    delete(painter);
-    delete(printer);
+void ChartUM::append_series(int from, int count) {
+    const double *results_y1 = simulation->y1();
+    const double *results_y2 = simulation->y2();
+
+    /* the series drawn from both results */
+    std::vector<double> diff(count);
+    for(int i=0;i<count;i++) diff[i] = results_y1[from+i]-results_y2[from+i];
+
+    lod->append(2, diff.data(), count);
 }
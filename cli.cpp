@@ -0,0 +1,899 @@
+/*
+ * insect_decision_cli: run any of the models without a display.
+ *
+ * usage: insect_decision_cli [options] <model> [name=value ...]
+ *
+ * Parameters start from the model defaults, are then read from the config
+ * file (if any) and finally from the command line, so later settings win.
+ * The trajectory is written as whitespace separated columns: t y1 y2.
+ * With -n the model is run as a Monte Carlo ensemble instead and the
+ * summary statistics are written, followed by one row per trial. With -p
+ * the ensemble is run at every point of a parameter sweep and one summary
+ * row is written per point; with -O as well the parameters are searched
+ * for the best objective instead, and one row is written per candidate;
+ * with -F they are fitted to an observed trajectory by approximate Bayesian
+ * computation, and the posterior sample is written. With -e the equilibria
+ * of the noise-free model are written instead, or with -p their branches
+ * over the parameter's range. With -W the run (or every trial of -n) goes
+ * to a binary trajectory file instead, which -R reads back. -B times the
+ * noise generator and the batch kernels instead.
+ */
+
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "benchmark.h"
+#include "ensemble.h"
+#include "equilibrium.h"
+#include "fit.h"
+#include "models_batch.h"
+#include "optimize.h"
+#include "simulation.h"
+#include "sweep.h"
+#include "trajectory_file.h"
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [options] <model> [name=value ...]\n"
+            "\n"
+            "options:\n"
+            "  -c FILE    read name=value parameters from FILE ('#' starts a comment)\n"
+            "  -o FILE    write the trajectory to FILE instead of stdout\n"
+            "  -m METHOD  integration method: rk4 (default), euler, dopri5 (adaptive, without\n"
+            "             noise; the work done is reported on stderr), or em, milstein or exact\n"
+            "             (the noise as Brownian increments, std_dev per unit time; exact\n"
+            "             transitions at any step for um and gaze, em for the others;\n"
+            "             milstein, em for um and gaze, is not offered for the ant models)\n"
+            "  -r X       relative tolerance for dopri5 (default 1e-6)\n"
+            "  -a X       absolute tolerance for dopri5 (default 1e-6)\n"
+            "  -H X       shortest step for dopri5 (default: none)\n"
+            "  -n N       run an ensemble of N trials instead of a single trajectory\n"
+            "  -j N       threads for the ensemble (default: one per core)\n"
+            "  -b KIND    decision boundary: difference (|y1 - y2|, the default), nest (y1 or\n"
+            "             y2) or quorum (y1 or y2 as a fraction of the population). a single\n"
+            "             run given -b or -t stops there and reports the decision on stderr\n"
+            "  -t X       threshold for the boundary, positive and at most 1 for a quorum\n"
+            "             (default: see model_default_boundary)\n"
+            "  -s         ensemble summary only, no per trial rows\n"
+            "  -p SPEC    sweep a parameter, SPEC is name=lo:hi[:count] (count for a grid,\n"
+            "             default 11); repeat for more. runs -n trials (default 100) a point\n"
+            "  -D DESIGN  sweep design: grid (default), random, lhs or sobol\n"
+            "  -N N       points of a random, lhs or sobol sweep (default 1000)\n"
+            "  -O OBJ     search the -p parameters (within their ranges, from the values set)\n"
+            "             for the best objective instead: reward_rate (accuracy / (mean\n"
+            "             decision time + inter-trial interval)) or decision_time (the mean,\n"
+            "             at the target accuracy). runs -n trials (default 1000) a candidate\n"
+            "  -C N       the correct choice for -O, 1 (default) or 2\n"
+            "  -A X       target accuracy for -O decision_time (default 0.9)\n"
+            "  -I X       inter-trial interval for -O reward_rate (default 1)\n"
+            "  -E N       most candidates -O evaluates (default 100)\n"
+            "  -F FILE    fit the -p parameters (uniform priors over their ranges) to the\n"
+            "             trajectory in FILE (t y1 y2 rows) by rejection ABC instead: runs\n"
+            "             -n candidates (default 100000) and keeps the closest -K\n"
+            "  -K N       posterior sample size for -F (default 1000)\n"
+            "  -T X       largest rms distance -F accepts (default: no limit)\n"
+            "  -e         write the equilibria of the noise-free model and their stability\n"
+            "             instead; with one -p name=lo:hi, trace their branches over it\n"
+            "  -W FILE    write the run, or the -n trials, to the binary trajectory file FILE\n"
+            "             instead, each stopped at the boundary if -b or -t is given\n"
+            "  -R FILE[:TRIAL]\n"
+            "             read a trajectory file instead (no model needed): its header and\n"
+            "             how each trial ended, or TRIAL's trajectory as t y1 y2\n"
+            "  -S ISA     vector instructions for the ensemble: scalar, sse2, avx2 or avx512\n"
+            "             (default: the best the cpu supports)\n"
+            "  -B         time the normal draws and the rk4 kernels on every instruction set\n"
+            "             the cpu supports instead (no model needed): per draw, and per step\n"
+            "             of -n trials (default 10000) of every model, or just the model given\n"
+            "  -l         list the models and their parameters\n"
+            "  -h         show this help\n",
+            prog);
+}
+
+static void list_models() {
+    for (int m=0; m<MODEL_COUNT; m++) {
+        std::vector<char> params(model_params_size((model_t)m));
+        model_set_defaults((model_t)m, params.data());
+
+        printf("%s (%s)\n", model_name((model_t)m), model_long_name((model_t)m));
+        int count;
+        const param_info_t *info = model_param_info((model_t)m, &count);
+        for (int i=0; i<count; i++) {
+            double v;
+            model_get_param((model_t)m, params.data(), info[i].name, &v);
+            printf("  %-12s %-10g %s\n", info[i].name, v, info[i].description);
+        }
+    }
+}
+
+/* strip leading and trailing whitespace in place */
+static char *trim(char *s) {
+    while (*s == ' ' || *s == '\t') s++;
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) end--;
+    *end = '\0';
+    return s;
+}
+
+/* apply one "name=value" assignment, reporting errors against where it came from */
+static int apply_assignment(model_t m, void *params, char *assignment, const char *where) {
+    char *eq = strchr(assignment, '=');
+    if (eq == nullptr) {
+        fprintf(stderr, "%s: expected name=value, got '%s'\n", where, assignment);
+        return -1;
+    }
+    *eq = '\0';
+    char *name = trim(assignment);
+    char *value = trim(eq + 1);
+
+    switch (model_set_param(m, params, name, value)) {
+        case 0:
+            return 0;
+        case -1:
+            fprintf(stderr, "%s: unknown parameter '%s' for model %s\n", where, name, model_name(m));
+            return -1;
+        default:
+            fprintf(stderr, "%s: bad value '%s' for parameter '%s'\n", where, value, name);
+            return -1;
+    }
+}
+
+static int read_config(model_t m, void *params, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) {
+        perror(path);
+        return -1;
+    }
+
+    char line[1024];
+    int line_number = 0;
+    int status = 0;
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        line_number++;
+        char *hash = strchr(line, '#');
+        if (hash != nullptr) *hash = '\0';
+        char *s = trim(line);
+        if (*s == '\0') continue;
+
+        std::string where = std::string(path) + ":" + std::to_string(line_number);
+        if (apply_assignment(m, params, s, where.c_str()) != 0) status = -1;
+    }
+    fclose(f);
+    return status;
+}
+
+static int write_trajectory(FILE *out, double h, int length, const double *results_y1, const double *results_y2) {
+    double t = 0.;
+    for (int i=0; i<length; i++) {
+        if (fprintf(out, "%.10g\t%.10g\t%.10g\n", t, results_y1[i], results_y2[i]) < 0) return -1;
+        t += h;
+    }
+    return 0;
+}
+
+static int write_ensemble(FILE *out, model_t m, method_t method, const boundary_t *boundary, int threads,
+                          const trial_outcome_t *outcomes, const ensemble_stats_t *stats, bool summary_only) {
+    fprintf(out, "# model %s, %s, %d trials, %d threads (%s), %s threshold %g\n",
+            model_name(m), method_name(method), stats->n_trials, threads, batch_isa_name(batch_isa()),
+            boundary_name(boundary->kind), boundary->threshold);
+    fprintf(out, "# p_choice1 %.6f\n", stats->p_choice1);
+    fprintf(out, "# p_choice2 %.6f\n", stats->p_choice2);
+    fprintf(out, "# p_undecided %.6f\n", stats->p_undecided);
+    fprintf(out, "# decision_time mean %.6g sd %.6g median %.6g\n", stats->mean_dt, stats->sd_dt, stats->median_dt);
+    fprintf(out, "# decision_time | choice1 %.6g | choice2 %.6g\n", stats->mean_dt1, stats->mean_dt2);
+    fprintf(out, "# final mean y1 %.6g y2 %.6g\n", stats->mean_y1, stats->mean_y2);
+    if (summary_only) return 0;
+
+    fprintf(out, "trial\tchoice\tdecision_time\ty1\ty2\n");
+    for (int i=0; i<stats->n_trials; i++) {
+        const trial_outcome_t *o = &outcomes[i];
+        if (fprintf(out, "%d\t%d\t%.10g\t%.10g\t%.10g\n", i, o->choice, o->decision_time, o->y1, o->y2) < 0) return -1;
+    }
+    return 0;
+}
+
+/* where write_sweep_row writes, and how many axis values a row has */
+typedef struct sweep_output_s {
+    FILE *out;
+    int n_axes;
+    long rows;          /* written so far */
+} sweep_output_t;
+
+static int write_sweep_row(const sweep_row_t *row, void *user) {
+    sweep_output_t *output = (sweep_output_t *)user;
+    FILE *out = output->out;
+    output->rows++;
+    if (fprintf(out, "%ld", row->point) < 0) return -1;
+    for (int a=0; a<output->n_axes; a++) {
+        if (fprintf(out, "\t%.10g", row->values[a]) < 0) return -1;
+    }
+    const ensemble_stats_t *s = &row->stats;
+    if (fprintf(out, "\t%.6f\t%.6f\t%.6f\t%.6g\t%.6g\t%.6g\t%.6g\t%.6g\t%.6g\t%.6g\t%.6g\t%.6g\n",
+                s->p_choice1, s->p_choice2, s->p_undecided, s->mean_dt, s->sd_dt,
+                s->q10_dt, s->median_dt, s->q90_dt, s->mean_dt1, s->mean_dt2, s->mean_y1, s->mean_y2) < 0) return -1;
+    return 0;
+}
+
+static int write_sweep(FILE *out, const sweep_t *sweep, const boundary_t *boundary, int threads) {
+    fprintf(out, "# sweep model %s, %s, %s design, %ld points x %d trials, %d threads (%s), %s threshold %g\n",
+            model_name(sweep->m), method_name(sweep->method), sweep_design_name(sweep->design),
+            sweep_points(sweep), sweep->n_trials, threads, batch_isa_name(batch_isa()),
+            boundary_name(boundary->kind), boundary->threshold);
+    fprintf(out, "point");
+    for (int a=0; a<sweep->n_axes; a++) fprintf(out, "\t%s", sweep->axes[a].name);
+    fprintf(out, "\tp_choice1\tp_choice2\tp_undecided\tmean_dt\tsd_dt\tq10_dt\tmedian_dt\tq90_dt\tmean_dt1\tmean_dt2\tmean_y1\tmean_y2\n");
+
+    sweep_output_t output = {out, sweep->n_axes, 0};
+    return run_sweep(sweep, write_sweep_row, &output);
+}
+
+static int write_candidate(const optimize_eval_t *eval, void *user) {
+    sweep_output_t *output = (sweep_output_t *)user;
+    FILE *out = output->out;
+    output->rows++;
+    if (fprintf(out, "%d", eval->evaluation) < 0) return -1;
+    for (int v=0; v<output->n_axes; v++) {
+        if (fprintf(out, "\t%.10g", eval->values[v]) < 0) return -1;
+    }
+    if (fprintf(out, "\t%.8g\t%.6f\t%.6g\n", eval->objective, eval->accuracy, eval->mean_time) < 0) return -1;
+    fflush(out);
+    return 0;
+}
+
+static int write_optimize(FILE *out, const optimize_t *opt, const boundary_t *boundary, int threads) {
+    fprintf(out, "# optimize model %s, %s, %s, choice %d correct, %d trials a candidate, %d threads (%s), %s threshold %g\n",
+            model_name(opt->m), method_name(opt->method), objective_name(opt->objective), opt->correct,
+            opt->n_trials, threads, batch_isa_name(batch_isa()), boundary_name(boundary->kind), boundary->threshold);
+    fprintf(out, "evaluation");
+    for (int v=0; v<opt->n_vars; v++) fprintf(out, "\t%s", opt->vars[v].name);
+    fprintf(out, "\tobjective\taccuracy\tmean_time\n");
+
+    sweep_output_t output = {out, opt->n_vars, 0};
+    optimize_eval_t best;
+    optimize_status_t status = run_optimize(opt, write_candidate, &output, &best);
+    if (status == OPTIMIZE_STOPPED || status == OPTIMIZE_EMPTY) return -1;
+
+    fprintf(out, "# %s after %d candidates; best, candidate %d:",
+            status == OPTIMIZE_CONVERGED ? "converged" : "out of evaluations", (int)output.rows, best.evaluation);
+    for (int v=0; v<opt->n_vars; v++) fprintf(out, " %s=%.10g", opt->vars[v].name, best.values[v]);
+    return fprintf(out, " %s %.8g accuracy %.6f mean_time %.6g\n",
+                   objective_name(opt->objective), best.objective, best.accuracy, best.mean_time) < 0 ? -1 : 0;
+}
+
+static int write_equilibrium(FILE *out, const equilibrium_t *eq) {
+    return fprintf(out, "%.10g\t%.10g\t%s\t%d\t%.6g\t%.6g\t%.6g\t%.6g",
+                   eq->y1, eq->y2, stability_name(eq->stability), eq->feasible,
+                   eq->re[0], eq->im[0], eq->re[1], eq->im[1]) < 0 ? -1 : 0;
+}
+
+static int write_equilibria(FILE *out, model_t m, const void *params) {
+    equilibrium_t eq[EQUILIBRIUM_MAX];
+    int n = model_equilibria(m, params, eq, EQUILIBRIUM_MAX);
+    fprintf(out, "# equilibria model %s, %d found\n", model_name(m), n);
+    fprintf(out, "y1\ty2\tstability\tfeasible\tre1\tim1\tre2\tim2\n");
+    for (int k=0; k<n; k++) {
+        if (write_equilibrium(out, &eq[k]) != 0 || fprintf(out, "\n") < 0) return -1;
+    }
+    return 0;
+}
+
+static int write_branch_point(const branch_point_t *point, void *user) {
+    FILE *out = (FILE *)user;
+    if (fprintf(out, "%d\t%d\t%.10g\t", point->branch, point->index, point->value) < 0) return -1;
+    if (write_equilibrium(out, &point->eq) != 0) return -1;
+    return fprintf(out, "\t%s\n", branch_point_name(point->kind)) < 0 ? -1 : 0;
+}
+
+static int write_continuation(FILE *out, const continuation_t *c) {
+    fprintf(out, "# continuation model %s in %s over %g .. %g\n", model_name(c->m), c->name, c->lo, c->hi);
+    fprintf(out, "branch\tpoint\t%s\ty1\ty2\tstability\tfeasible\tre1\tim1\tre2\tim2\tspecial\n", c->name);
+    int branches;
+    int status = run_continuation(c, write_branch_point, out, &branches);
+    if (status != 0) return status;
+    return fprintf(out, "# %d branches\n", branches) < 0 ? -1 : 0;
+}
+
+/* read t y1 y2 rows, '#' starting a comment */
+static int read_observed(const char *path, std::vector<double> *t, std::vector<double> *y1, std::vector<double> *y2) {
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) {
+        perror(path);
+        return -1;
+    }
+
+    char line[1024];
+    int line_number = 0;
+    int status = 0;
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        line_number++;
+        char *hash = strchr(line, '#');
+        if (hash != nullptr) *hash = '\0';
+        char *s = trim(line);
+        if (*s == '\0') continue;
+
+        double values[3];
+        if (sscanf(s, "%lf %lf %lf", &values[0], &values[1], &values[2]) != 3) {
+            fprintf(stderr, "%s:%d: expected t y1 y2\n", path, line_number);
+            status = -1;
+            continue;
+        }
+        t->push_back(values[0]);
+        y1->push_back(values[1]);
+        y2->push_back(values[2]);
+    }
+    fclose(f);
+    return status;
+}
+
+static int write_fit(FILE *out, const fit_t *fit, bool summary_only) {
+    std::vector<fit_sample_t> samples(fit->n_accept);
+    fit_result_t result;
+    if (run_fit(fit, samples.data(), &result) != 0) {
+        fprintf(stderr, "fit: the observations must be in time order and within the run\n");
+        return -1;
+    }
+
+    fprintf(out, "# fit model %s, %d observations, %ld candidates (%ld stopped early), %d threads (%s)\n",
+            model_name(fit->m), fit->n_obs, result.simulated, result.rejected_early, fit->threads,
+            batch_isa_name(batch_isa()));
+    fprintf(out, "# accepted %d, rms distance up to %.6g\n", result.n_accepted, result.max_distance);
+    for (int v=0; v<fit->n_vars; v++) {
+        fit_summary_t summary;
+        fit_summarise(samples.data(), result.n_accepted, v, &summary);
+        fprintf(out, "# %s mean %.6g sd %.6g | 5%% %.6g median %.6g 95%% %.6g\n", fit->priors[v].name,
+                summary.mean, summary.sd, summary.q05, summary.median, summary.q95);
+    }
+    if (summary_only) return 0;
+
+    fprintf(out, "candidate");
+    for (int v=0; v<fit->n_vars; v++) fprintf(out, "\t%s", fit->priors[v].name);
+    fprintf(out, "\tdistance\n");
+    for (int i=0; i<result.n_accepted; i++) {
+        if (fprintf(out, "%ld", samples[i].candidate) < 0) return -1;
+        for (int v=0; v<fit->n_vars; v++) fprintf(out, "\t%.10g", samples[i].values[v]);
+        if (fprintf(out, "\t%.10g\n", samples[i].distance) < 0) return -1;
+    }
+    return 0;
+}
+
+/* read a trajectory file: its header and index, or one trial's trajectory */
+static int read_trajectory_file(FILE *out, const char *path, long trial) {
+    trajectory_file_t *tf;
+    int status = trajectory_file_open(path, &tf);
+    if (status != 0) {
+        fprintf(stderr, "%s: %s\n", path, trajectory_error_name(status));
+        return -1;
+    }
+    const trajectory_header_t *header = trajectory_file_header(tf);
+    const model_t m = (model_t)header->model;
+    const int length = (int)header->length;
+
+    status = 0;
+    if (trial >= 0) {
+        const double *results_y1 = trajectory_file_column(tf, TRAJECTORY_Y1, trial);
+        const double *results_y2 = trajectory_file_column(tf, TRAJECTORY_Y2, trial);
+        decision_t decision = {0, -1., length, length};
+        if (results_y1 == nullptr) {
+            fprintf(stderr, "%s: no trial %ld, the file has %lu\n", path, trial, (unsigned long)header->n_trials);
+            status = -1;
+        } else {
+            trajectory_file_get_index(tf, trial, &decision);
+            status = write_trajectory(out, header->h, decision.steps, results_y1, results_y2);
+        }
+    } else {
+        fprintf(out, "# trajectories model %s, %s, %lu trials from trial %lu of seed %ld, %d results each, h %g\n",
+                model_name(m), method_name((method_t)header->method), (unsigned long)header->n_trials,
+                (unsigned long)header->first_trial, (long)header->seed, length, header->h);
+        std::vector<char> params(model_params_size(m));
+        trajectory_file_params(tf, params.data());
+        int count;
+        const param_info_t *info = model_param_info(m, &count);
+        for (int i=0; i<count; i++) {
+            double v = 0.;
+            model_get_param(m, params.data(), info[i].name, &v);
+            fprintf(out, "# %s = %.10g\n", info[i].name, v);
+        }
+        if (header->flags & TRAJECTORY_HAS_INDEX) {
+            fprintf(out, "trial\tchoice\tdecision_time\tsteps\n");
+            for (long i=0; i<(long)header->n_trials && status == 0; i++) {
+                decision_t decision;
+                trajectory_file_get_index(tf, i, &decision);
+                if (fprintf(out, "%ld\t%d\t%.10g\t%d\n", i, decision.choice, decision.time, decision.steps) < 0) status = -1;
+            }
+        }
+    }
+    trajectory_file_close(tf);
+    return status;
+}
+
+static void write_benchmark_rows(FILE *out, const benchmark_row_t *rows, int count) {
+    for (int i=0; i<count; i++) {
+        fprintf(out, "%-26s %-7s %8.2f ns %6.2fx\n", rows[i].name, rows[i].isa != nullptr ? rows[i].isa : "",
+                rows[i].ns, rows[i].speedup);
+    }
+}
+
+/* the benchmarks of benchmark.h, for model m or (m < 0) every model */
+static int write_benchmark(FILE *out, int m, int n_trials) {
+    benchmark_row_t rows[BENCHMARK_MAX_ROWS];
+    fprintf(out, "# normal draws: %d, best of %d\n", BENCHMARK_DRAWS, BENCHMARK_REPEATS);
+    write_benchmark_rows(out, rows, benchmark_noise(rows));
+    for (int i=0; i<MODEL_COUNT; i++) {
+        if (m >= 0 && i != m) continue;
+        fprintf(out, "# rk4 %s: %d trials, d %d, noise drawn beforehand, best of %d\n",
+                model_name((model_t)i), n_trials, BENCHMARK_DURATION, BENCHMARK_KERNEL_REPEATS);
+        write_benchmark_rows(out, rows, benchmark_kernels((model_t)i, n_trials, rows));
+    }
+    return fflush(out) != 0 ? -1 : 0;
+}
+
+/* parse a sweep axis "name=lo:hi[:count]" for model m */
+static int parse_axis(model_t m, char *spec, sweep_axis_t *axis) {
+    char *eq = strchr(spec, '=');
+    if (eq == nullptr) {
+        fprintf(stderr, "sweep: expected name=lo:hi[:count], got '%s'\n", spec);
+        return -1;
+    }
+    *eq = '\0';
+    char *name = trim(spec);
+    int count;
+    const param_info_t *info = model_param_info(m, &count);
+    axis->name = nullptr;
+    for (int i=0; i<count; i++) {
+        if (strcmp(info[i].name, name) == 0) axis->name = info[i].name;
+    }
+    if (axis->name == nullptr) {
+        fprintf(stderr, "sweep: unknown parameter '%s' for model %s\n", name, model_name(m));
+        return -1;
+    }
+
+    axis->count = 11;
+    int fields = sscanf(eq + 1, "%lf:%lf:%d", &axis->lo, &axis->hi, &axis->count);
+    if (fields < 2 || axis->count < 1) {
+        fprintf(stderr, "sweep: bad range '%s' for parameter '%s'\n", eq + 1, name);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *config_path = nullptr;
+    const char *output_path = nullptr;
+    int n_trials = 0;
+    bool n_trials_given = false;
+    int threads = 0;
+    double threshold = -1.;
+    bool threshold_given = false;
+    boundary_kind_t boundary_kind = BOUNDARY_DIFFERENCE;
+    bool stop_at_boundary = false;
+    bool summary_only = false;
+    method_t method = METHOD_RK4;
+    std::vector<std::string> sweep_specs;
+    sweep_design_t design = SWEEP_GRID;
+    long sweep_n_points = 1000;
+    int objective = -1;
+    int correct = 1;
+    double target_accuracy = 0.9;
+    double inter_trial = 1.0;
+    int max_evaluations = 100;
+    bool equilibria = false;
+    const char *observed_path = nullptr;
+    int n_accept = 1000;
+    double fit_tolerance = 0.;
+    const char *write_path = nullptr;
+    const char *read_path = nullptr;
+    bool benchmark = false;
+    adaptive_tol_t tol;
+    adaptive_default_tol(&tol);
+    int argi = 1;
+
+    for (; argi < argc && argv[argi][0] == '-'; argi++) {
+        const char *opt = argv[argi];
+        if (strcmp(opt, "-h") == 0 || strcmp(opt, "--help") == 0) {
+            usage(argv[0]);
+            return 0;
+        } else if (strcmp(opt, "-l") == 0) {
+            list_models();
+            return 0;
+        } else if (strcmp(opt, "-c") == 0 && argi + 1 < argc) {
+            config_path = argv[++argi];
+        } else if (strcmp(opt, "-o") == 0 && argi + 1 < argc) {
+            output_path = argv[++argi];
+        } else if (strcmp(opt, "-m") == 0 && argi + 1 < argc) {
+            const char *name = argv[++argi];
+            int m = method_from_name(name);
+            if (m < 0) {
+                fprintf(stderr, "unknown integration method '%s'\n", name);
+                return 2;
+            }
+            method = (method_t)m;
+        } else if (strcmp(opt, "-r") == 0 && argi + 1 < argc) {
+            tol.rtol = atof(argv[++argi]);
+        } else if (strcmp(opt, "-a") == 0 && argi + 1 < argc) {
+            tol.atol = atof(argv[++argi]);
+        } else if (strcmp(opt, "-H") == 0 && argi + 1 < argc) {
+            tol.min_step = atof(argv[++argi]);
+        } else if (strcmp(opt, "-n") == 0 && argi + 1 < argc) {
+            n_trials = atoi(argv[++argi]);
+            n_trials_given = true;
+        } else if (strcmp(opt, "-j") == 0 && argi + 1 < argc) {
+            threads = atoi(argv[++argi]);
+        } else if (strcmp(opt, "-t") == 0 && argi + 1 < argc) {
+            threshold = atof(argv[++argi]);
+            threshold_given = true;
+            stop_at_boundary = true;
+        } else if (strcmp(opt, "-b") == 0 && argi + 1 < argc) {
+            const char *name = argv[++argi];
+            int kind = boundary_from_name(name);
+            if (kind <= BOUNDARY_NONE) {
+                fprintf(stderr, "unknown decision boundary '%s'\n", name);
+                return 2;
+            }
+            boundary_kind = (boundary_kind_t)kind;
+            stop_at_boundary = true;
+        } else if (strcmp(opt, "-p") == 0 && argi + 1 < argc) {
+            sweep_specs.push_back(argv[++argi]);
+        } else if (strcmp(opt, "-D") == 0 && argi + 1 < argc) {
+            const char *name = argv[++argi];
+            int d = sweep_design_from_name(name);
+            if (d < 0) {
+                fprintf(stderr, "unknown sweep design '%s'\n", name);
+                return 2;
+            }
+            design = (sweep_design_t)d;
+        } else if (strcmp(opt, "-N") == 0 && argi + 1 < argc) {
+            sweep_n_points = atol(argv[++argi]);
+        } else if (strcmp(opt, "-O") == 0 && argi + 1 < argc) {
+            const char *name = argv[++argi];
+            objective = objective_from_name(name);
+            if (objective < 0) {
+                fprintf(stderr, "unknown objective '%s'\n", name);
+                return 2;
+            }
+        } else if (strcmp(opt, "-C") == 0 && argi + 1 < argc) {
+            correct = atoi(argv[++argi]);
+        } else if (strcmp(opt, "-A") == 0 && argi + 1 < argc) {
+            target_accuracy = atof(argv[++argi]);
+        } else if (strcmp(opt, "-I") == 0 && argi + 1 < argc) {
+            inter_trial = atof(argv[++argi]);
+        } else if (strcmp(opt, "-E") == 0 && argi + 1 < argc) {
+            max_evaluations = atoi(argv[++argi]);
+        } else if (strcmp(opt, "-F") == 0 && argi + 1 < argc) {
+            observed_path = argv[++argi];
+        } else if (strcmp(opt, "-K") == 0 && argi + 1 < argc) {
+            n_accept = atoi(argv[++argi]);
+        } else if (strcmp(opt, "-T") == 0 && argi + 1 < argc) {
+            fit_tolerance = atof(argv[++argi]);
+        } else if (strcmp(opt, "-W") == 0 && argi + 1 < argc) {
+            write_path = argv[++argi];
+        } else if (strcmp(opt, "-R") == 0 && argi + 1 < argc) {
+            read_path = argv[++argi];
+        } else if (strcmp(opt, "-e") == 0) {
+            equilibria = true;
+        } else if (strcmp(opt, "-B") == 0) {
+            benchmark = true;
+        } else if (strcmp(opt, "-s") == 0) {
+            summary_only = true;
+        } else if (strcmp(opt, "-S") == 0 && argi + 1 < argc) {
+            const char *name = argv[++argi];
+            int isa = BATCH_SCALAR;
+            while (isa <= BATCH_AVX512 && strcmp(name, batch_isa_name((batch_isa_t)isa)) != 0) isa++;
+            if (isa > BATCH_AVX512) {
+                fprintf(stderr, "unknown instruction set '%s'\n", name);
+                return 2;
+            }
+            batch_set_isa((batch_isa_t)isa);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    /* counts, tolerances and the threshold, whichever mode goes on to use them */
+    if (n_trials_given && n_trials < 1) {
+        fprintf(stderr, "-n: the trials must be positive\n");
+        return 2;
+    }
+    if (threads < 0) {
+        fprintf(stderr, "-j: the threads must be positive, or 0 for one per core\n");
+        return 2;
+    }
+    if (sweep_n_points < 1 || sweep_n_points > INT32_MAX) {
+        fprintf(stderr, "-N: the points must be 1 .. %d\n", INT32_MAX);
+        return 2;
+    }
+    if (correct != 1 && correct != 2) {
+        fprintf(stderr, "-C: the correct choice is 1 or 2\n");
+        return 2;
+    }
+    if (!(target_accuracy > 0.0 && target_accuracy <= 1.0)) {
+        fprintf(stderr, "-A: the target accuracy must be in (0, 1]\n");
+        return 2;
+    }
+    if (!(inter_trial >= 0.0)) {
+        fprintf(stderr, "-I: the inter-trial interval must not be negative\n");
+        return 2;
+    }
+    if (max_evaluations < 1) {
+        fprintf(stderr, "-E: the evaluations must be positive\n");
+        return 2;
+    }
+    if (threshold_given && !(threshold > 0.0 && std::isfinite(threshold))) {
+        fprintf(stderr, "-t: the threshold must be positive and finite\n");
+        return 2;
+    }
+    if (threshold_given && boundary_kind == BOUNDARY_QUORUM && threshold > 1.0) {
+        fprintf(stderr, "-t: a quorum is a fraction of the population, at most 1\n");
+        return 2;
+    }
+    if (n_accept < 1) {
+        fprintf(stderr, "-K: the sample size must be positive\n");
+        return 2;
+    }
+    if (!(fit_tolerance >= 0.0)) {
+        fprintf(stderr, "-T: the distance must not be negative\n");
+        return 2;
+    }
+    if (!(tol.rtol >= 0.0 && tol.atol >= 0.0) || tol.rtol + tol.atol <= 0.0 || !(tol.min_step >= 0.0)) {
+        fprintf(stderr, "-r, -a, -H: tolerances and step must not be negative, and the tolerances not both zero\n");
+        return 2;
+    }
+
+    if (read_path != nullptr) {
+        /* FILE:TRIAL, the trial being digits after the last colon */
+        std::string path(read_path);
+        long trial = -1;
+        size_t colon = path.rfind(':');
+        if (colon != std::string::npos && colon + 1 < path.size() &&
+            path.find_first_not_of("0123456789", colon + 1) == std::string::npos) {
+            trial = atol(path.c_str() + colon + 1);
+            path.resize(colon);
+        }
+        FILE *out = stdout;
+        if (output_path != nullptr) {
+            out = fopen(output_path, "w");
+            if (out == nullptr) {
+                perror(output_path);
+                return 1;
+            }
+        }
+        int status = read_trajectory_file(out, path.c_str(), trial);
+        if (out != stdout && fclose(out) != 0) status = -1;
+        return status != 0 ? 1 : 0;
+    }
+
+    if (benchmark) {
+        int m = -1;
+        if (argi < argc && (m = model_from_name(argv[argi])) < 0) {
+            fprintf(stderr, "unknown model '%s' (try -l)\n", argv[argi]);
+            return 2;
+        }
+        FILE *out = stdout;
+        if (output_path != nullptr) {
+            out = fopen(output_path, "w");
+            if (out == nullptr) {
+                perror(output_path);
+                return 1;
+            }
+        }
+        int status = write_benchmark(out, m, n_trials > 0 ? n_trials : 10000);
+        if (out != stdout && fclose(out) != 0) status = -1;
+        return status != 0 ? 1 : 0;
+    }
+
+    if (argi >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    int m = model_from_name(argv[argi]);
+    if (m < 0) {
+        fprintf(stderr, "unknown model '%s' (try -l)\n", argv[argi]);
+        return 2;
+    }
+    model_t model = (model_t)m;
+    argi++;
+    if (!model_offers_method(model, method)) {
+        fprintf(stderr, "%s is not offered for the %s model (see sde.h)\n", method_name(method), model_name(model));
+        return 2;
+    }
+
+    /* defaults, then config file, then command line */
+    std::vector<char> params(model_params_size(model));
+    model_set_defaults(model, params.data());
+
+    if (config_path != nullptr && read_config(model, params.data(), config_path) != 0) return 2;
+    for (; argi < argc; argi++) {
+        std::vector<char> assignment(argv[argi], argv[argi] + strlen(argv[argi]) + 1);
+        if (apply_assignment(model, params.data(), assignment.data(), "command line") != 0) return 2;
+    }
+
+    double h, d;
+    model_get_param(model, params.data(), "h", &h);
+    model_get_param(model, params.data(), "d", &d);
+    if (h <= 0.0 || d <= 0.0) {
+        fprintf(stderr, "step size and duration must be positive\n");
+        return 2;
+    }
+    if (d / h >= INT_MAX) {
+        fprintf(stderr, "step size too small: d/h must be below %d steps\n", INT_MAX);
+        return 2;
+    }
+
+    boundary_t boundary;
+    if (model_default_boundary(model, params.data(), boundary_kind, &boundary) != 0) {
+        fprintf(stderr, "model %s has no population for a quorum\n", model_name(model));
+        return 2;
+    }
+    if (threshold_given) boundary.threshold = threshold;
+
+    FILE *out = stdout;
+    if (output_path != nullptr) {
+        out = fopen(output_path, "w");
+        if (out == nullptr) {
+            perror(output_path);
+            return 1;
+        }
+    }
+
+    int status;
+    std::vector<sweep_axis_t> axes(sweep_specs.size());
+    for (size_t a=0; a<sweep_specs.size(); a++) {
+        std::vector<char> spec(sweep_specs[a].begin(), sweep_specs[a].end());
+        spec.push_back('\0');
+        if (parse_axis(model, spec.data(), &axes[a]) != 0) return 2;
+    }
+    if (equilibria) {
+        if (axes.size() > 1) {
+            fprintf(stderr, "equilibria: continue in one parameter at a time\n");
+            return 2;
+        }
+        if (axes.empty()) {
+            status = write_equilibria(out, model, params.data());
+        } else {
+            continuation_t c;
+            c.m = model;
+            c.params = params.data();
+            c.name = axes[0].name;
+            c.lo = axes[0].lo;
+            c.hi = axes[0].hi;
+            c.max_step = 0.;
+            c.max_points = 0;
+            int count;
+            const param_info_t *info = model_param_info(model, &count);
+            for (int i=0; i<count; i++) {
+                if (strcmp(info[i].name, c.name) == 0 && info[i].type != PARAM_DOUBLE) {
+                    fprintf(stderr, "equilibria: %s is an integer parameter\n", c.name);
+                    return 2;
+                }
+            }
+            if (c.hi <= c.lo) {
+                fprintf(stderr, "equilibria: the range of %s must be lo:hi with lo < hi\n", c.name);
+                return 2;
+            }
+            status = write_continuation(out, &c);
+        }
+    } else if (observed_path != nullptr) {
+        if (axes.empty() || (int)axes.size() > FIT_MAX_VARS) {
+            fprintf(stderr, "fit: give 1 .. %d parameters to fit with -p\n", FIT_MAX_VARS);
+            return 2;
+        }
+        std::vector<double> t, y1, y2;
+        if (read_observed(observed_path, &t, &y1, &y2) != 0) return 2;
+        if (t.empty()) {
+            fprintf(stderr, "%s: no observations\n", observed_path);
+            return 2;
+        }
+        fit_t fit;
+        fit.m = model;
+        fit.params = params.data();
+        fit.n_vars = (int)axes.size();
+        for (int v=0; v<fit.n_vars; v++) {
+            fit.priors[v].name = axes[v].name;
+            fit.priors[v].lo = axes[v].lo;
+            fit.priors[v].hi = axes[v].hi;
+        }
+        fit.n_obs = (int)t.size();
+        fit.t = t.data();
+        fit.y1 = y1.data();
+        fit.y2 = y2.data();
+        fit.n_candidates = n_trials > 0 ? n_trials : 100000;
+        fit.n_accept = n_accept;
+        fit.tolerance = fit_tolerance;
+        fit.threads = threads > 0 ? threads : ensemble_default_threads();
+        status = write_fit(out, &fit, summary_only);
+    } else if (objective >= 0) {
+        if (axes.empty() || (int)axes.size() > OPTIMIZE_MAX_VARS) {
+            fprintf(stderr, "optimize: give 1 .. %d parameters to search with -p\n", OPTIMIZE_MAX_VARS);
+            return 2;
+        }
+        optimize_t opt;
+        opt.m = model;
+        opt.method = method;
+        opt.params = params.data();
+        opt.n_vars = (int)axes.size();
+        for (int v=0; v<opt.n_vars; v++) {
+            opt.vars[v].name = axes[v].name;
+            opt.vars[v].lo = axes[v].lo;
+            opt.vars[v].hi = axes[v].hi;
+        }
+        opt.objective = (objective_t)objective;
+        opt.correct = correct;
+        opt.target_accuracy = target_accuracy;
+        opt.inter_trial = inter_trial;
+        opt.n_trials = n_trials > 0 ? n_trials : 1000;
+        opt.threads = threads > 0 ? threads : ensemble_default_threads();
+        opt.boundary = &boundary;
+        opt.max_evaluations = max_evaluations;
+        opt.tolerance = 1e-3;
+        status = write_optimize(out, &opt, &boundary, opt.threads);
+    } else if (!axes.empty()) {
+        if ((int)axes.size() > SWEEP_MAX_AXES) {
+            fprintf(stderr, "sweep: at most %d parameters\n", SWEEP_MAX_AXES);
+            return 2;
+        }
+        double seed;
+        model_get_param(model, params.data(), "seed", &seed);
+        sweep_t sweep;
+        sweep.m = model;
+        sweep.method = method;
+        sweep.params = params.data();
+        sweep.n_axes = (int)axes.size();
+        for (int a=0; a<sweep.n_axes; a++) sweep.axes[a] = axes[a];
+        sweep.design = design;
+        sweep.n_points = sweep_n_points;
+        sweep.design_seed = (uint32_t)seed;
+        sweep.n_trials = n_trials > 0 ? n_trials : 100;
+        sweep.threads = threads > 0 ? threads : ensemble_default_threads();
+        sweep.boundary = &boundary;
+        status = write_sweep(out, &sweep, &boundary, sweep.threads);
+    } else if (write_path != nullptr) {
+        long trials = n_trials > 0 ? n_trials : 1;
+        status = write_trajectory_file(write_path, model, method, params.data(), 0, trials, threads,
+                                       stop_at_boundary ? &boundary : nullptr);
+        if (status != 0) {
+            fprintf(stderr, "%s: %s\n", write_path, trajectory_error_name(status));
+            return 1;
+        }
+        fprintf(stderr, "%s: %ld trials of %d results\n", write_path, trials, model_params_length(model, params.data()));
+    } else if (n_trials > 0) {
+        if (threads <= 0) threads = ensemble_default_threads();
+        std::vector<trial_outcome_t> outcomes(n_trials);
+        ensemble_stats_t stats;
+        run_ensemble(model, method, params.data(), n_trials, threads, &boundary, outcomes.data(), &stats);
+        status = write_ensemble(out, model, method, &boundary, threads, outcomes.data(), &stats, summary_only);
+    } else {
+        int length = model_params_length(model, params.data());
+        std::vector<double> results_y1(length);
+        std::vector<double> results_y2(length);
+        decision_t decision = {0, -1., length, length};
+        if (method == METHOD_DOPRI5) {
+            adaptive_stats_t work;
+            model_integrate_adaptive(model, params.data(), &tol, results_y1.data(), results_y2.data(), &work);
+            fprintf(stderr, "dopri5: %ld rhs evaluations, %ld steps (%ld rejected), step %g .. %g\n",
+                    work.rhs_evaluations, work.accepted, work.rejected, work.min_step, work.max_step);
+            if (stop_at_boundary) boundary_scan(&boundary, h, 0, length-1, results_y1.data(), results_y2.data(), 1, &decision);
+        } else {
+            double seed;
+            model_get_param(model, params.data(), "seed", &seed);
+            noise_key_t key = noise_key((int)seed, 0);
+            model_integrate_until(model, method, params.data(), &key, stop_at_boundary ? &boundary : nullptr,
+                                  results_y1.data(), results_y2.data(), &decision);
+        }
+        if (stop_at_boundary) {
+            fprintf(stderr, "decision: choice %d at t = %.10g (%s threshold %g)\n",
+                    decision.choice, decision.time, boundary_name(boundary.kind), boundary.threshold);
+        }
+        status = write_trajectory(out, h, decision.steps, results_y1.data(), results_y2.data());
+    }
+
+    if (out != stdout && fclose(out) != 0) status = -1;
+    if (status != 0) {
+        fprintf(stderr, "error writing output\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "buffer_pool.h"
+#include "ensemble.h"
+#include "models_batch.h"
+
+/*
+ * steps run between checks of the boundary: trials that decide early stop
+ * within a block of their decision (a batch, once all of its lanes have)
+ */
+#define ENSEMBLE_BLOCK 256
+
+/*
+ * per thread buffers, reused across chunks: a block of each trial's noise
+ * is drawn into `scratch` and interleaved into `noise` for the batch kernel,
+ * which steps the trials through a block of results: the state carried in
+ * from the block before, then the block's steps. so the memory taken does
+ * not grow with the length of the run, but for the methods without batch
+ * kernels, which keep one trial's whole run.
+ * they come from the buffer pool, so the next call's threads take them up
+ * again, and start on a cache line, as do the rows of a full chunk
+ */
+struct ensemble_workspace_s {
+    buffer_vector_t scratch;
+    buffer_vector_t noise;
+    buffer_vector_t results_y1;
+    buffer_vector_t results_y2;
+    std::vector<double *> scratch_channels;
+    std::vector<const double *> noise_channels;
+};
+
+ensemble_workspace_t *ensemble_workspace_create() {
+    return new ensemble_workspace_t;
+}
+
+void ensemble_workspace_destroy(ensemble_workspace_t *ws) {
+    delete ws;
+}
+
+int ensemble_default_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? (int)n : 1;
+}
+
+/* outcome of a trial from its decision and the results, stride apart, from step first on */
+static void score_trial(const decision_t *decision, const double *results_y1, const double *results_y2, int first, int stride, trial_outcome_t *outcome) {
+    outcome->choice = decision->choice;
+    outcome->decision_time = decision->time;
+    outcome->y1 = results_y1[(size_t)(decision->steps-1-first)*stride];
+    outcome->y2 = results_y2[(size_t)(decision->steps-1-first)*stride];
+}
+
+void ensemble_run_trials(ensemble_workspace_t *ws,
+                         model_t m,
+                         method_t method,
+                         const void *params,
+                         int first,
+                         int n,
+                         const boundary_t *boundary,
+                         trial_outcome_t *outcomes) {
+    int length = model_params_length(m, params);
+    int channels = model_noise_channels(m);
+    double h, base_seed, y1_0, y2_0;
+    model_get_param(m, params, "h", &h);
+    model_get_param(m, params, "seed", &base_seed);
+    model_get_param(m, params, "y1_0", &y1_0);
+    model_get_param(m, params, "y2_0", &y2_0);
+
+    /* a whole run of one trial for the other methods, one block of the batch for rk4 */
+    size_t results_size = method != METHOD_RK4 ? (size_t)length : (size_t)(ENSEMBLE_BLOCK + 1) * ENSEMBLE_CHUNK;
+    if (ws->results_y1.size() < results_size) {
+        ws->results_y1.resize(results_size);
+        ws->results_y2.resize(results_size);
+    }
+    double *results_y1 = ws->results_y1.data();
+    double *results_y2 = ws->results_y2.data();
+    decision_t decisions[ENSEMBLE_CHUNK];
+
+    if (method != METHOD_RK4) {
+        /* no batch kernels for the other methods: one trial at a time */
+        for (int j=0; j<n; j++) {
+            noise_key_t key = noise_key((int)base_seed, first + j);
+            model_integrate_until(m, method, params, &key, boundary, results_y1, results_y2, &decisions[j]);
+            score_trial(&decisions[j], results_y1, results_y2, 0, 1, &outcomes[j]);
+        }
+        return;
+    }
+
+    if (ws->scratch.size() < (size_t)channels * ENSEMBLE_BLOCK) {
+        ws->scratch.resize((size_t)channels * ENSEMBLE_BLOCK);
+        ws->noise.resize((size_t)channels * ENSEMBLE_BLOCK * ENSEMBLE_CHUNK);
+    }
+    ws->scratch_channels.resize(channels);
+    ws->noise_channels.resize(channels);
+    for (int c=0; c<channels; c++) {
+        ws->scratch_channels[c] = ws->scratch.data() + (size_t)c * ENSEMBLE_BLOCK;
+        ws->noise_channels[c] = ws->noise.data() + (size_t)c * ENSEMBLE_BLOCK * ENSEMBLE_CHUNK;
+    }
+
+    int undecided = n;
+    for (int j=0; j<n; j++) {
+        results_y1[j] = y1_0;
+        results_y2[j] = y2_0;
+        decisions[j].choice = 0;
+        decisions[j].time = -1.;
+        decisions[j].steps = length;
+        decisions[j].written = length;
+    }
+
+    for (int step=0; step<length-1 && undecided > 0; step+=ENSEMBLE_BLOCK) {
+        int count = std::min(length-1-step, ENSEMBLE_BLOCK);
+        for (int j=0; j<n; j++) {
+            noise_key_t key = noise_key((int)base_seed, first + j);
+            model_fill_noise(m, params, &key, step, count, ws->scratch_channels.data());
+            for (int c=0; c<channels; c++) {
+                double *lane = ws->noise.data() + (size_t)c * ENSEMBLE_BLOCK * ENSEMBLE_CHUNK + j;
+                for (int i=0; i<count; i++) lane[(size_t)i*n] = ws->scratch_channels[c][i];
+            }
+        }
+
+        /* row 0 is the state at step, rows 1 .. count the block's steps */
+        model_rk4_batch_steps(m, params, n, step, count, ws->noise_channels.data(), results_y1, results_y2);
+
+        if (boundary != nullptr && boundary->kind != BOUNDARY_NONE) {
+            for (int j=0; j<n; j++) {
+                if (decisions[j].choice != 0) continue;
+                int from = step == 0 ? 0 : step + 1;
+                if (boundary_scan_block(boundary, h, step, from, step + count, results_y1 + j, results_y2 + j, n, &decisions[j])) {
+                    score_trial(&decisions[j], results_y1 + j, results_y2 + j, step, n, &outcomes[j]);
+                    undecided--;
+                }
+            }
+        }
+
+        /* the last step is carried into the next block */
+        std::copy(results_y1 + (size_t)count*n, results_y1 + (size_t)(count+1)*n, results_y1);
+        std::copy(results_y2 + (size_t)count*n, results_y2 + (size_t)(count+1)*n, results_y2);
+    }
+
+    /* the undecided trials end where the run does, now row 0 */
+    for (int j=0; j<n; j++) {
+        if (decisions[j].choice == 0) score_trial(&decisions[j], results_y1 + j, results_y2 + j, length-1, n, &outcomes[j]);
+    }
+}
+
+void run_ensemble(model_t m,
+                  method_t method,
+                  const void *params,
+                  int n_trials,
+                  int threads,
+                  const boundary_t *boundary,
+                  trial_outcome_t *outcomes,
+                  ensemble_stats_t *stats) {
+    if (n_trials <= 0) {
+        if (stats != nullptr) ensemble_compute_stats(outcomes, 0, stats);
+        return;
+    }
+    if (threads <= 0) threads = ensemble_default_threads();
+    int n_chunks = (n_trials + ENSEMBLE_CHUNK - 1) / ENSEMBLE_CHUNK;
+    if (threads > n_chunks) threads = n_chunks;
+
+    std::atomic<int> next_chunk(0);
+
+    auto worker = [&]() {
+        ensemble_workspace_t ws;
+        for (;;) {
+            int chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= n_chunks) break;
+            int first = chunk * ENSEMBLE_CHUNK;
+            int n = std::min(n_trials - first, ENSEMBLE_CHUNK);
+            ensemble_run_trials(&ws, m, method, params, first, n, boundary, outcomes + first);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i=1; i<threads; i++) pool.push_back(std::thread(worker));
+    worker();
+    for (auto &t : pool) t.join();
+
+    if (stats != nullptr) ensemble_compute_stats(outcomes, n_trials, stats);
+}
+
+/* quantile p of sorted values, interpolating between the two nearest */
+static double sorted_quantile(const std::vector<double> &sorted, double p) {
+    double pos = p * (sorted.size() - 1);
+    size_t below = (size_t)pos;
+    if (below + 1 >= sorted.size()) return sorted.back();
+    double frac = pos - below;
+    return (1 - frac) * sorted[below] + frac * sorted[below+1];
+}
+
+void ensemble_compute_stats(const trial_outcome_t *outcomes, int n_trials, ensemble_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->n_trials = n_trials;
+    if (n_trials <= 0) return;
+
+    /* sums are taken in trial order so the statistics are reproducible */
+    std::vector<double> times;
+    double sum_dt1 = 0., sum_dt2 = 0.;
+    for (int i=0; i<n_trials; i++) {
+        const trial_outcome_t *o = &outcomes[i];
+        stats->mean_y1 += o->y1;
+        stats->mean_y2 += o->y2;
+        if (o->choice == 1) {
+            stats->n_choice1++;
+            sum_dt1 += o->decision_time;
+        } else if (o->choice == 2) {
+            stats->n_choice2++;
+            sum_dt2 += o->decision_time;
+        } else {
+            stats->n_undecided++;
+            continue;
+        }
+        times.push_back(o->decision_time);
+    }
+
+    stats->mean_y1 /= n_trials;
+    stats->mean_y2 /= n_trials;
+    stats->p_choice1 = (double)stats->n_choice1 / n_trials;
+    stats->p_choice2 = (double)stats->n_choice2 / n_trials;
+    stats->p_undecided = (double)stats->n_undecided / n_trials;
+    stats->mean_dt1 = stats->n_choice1 > 0 ? sum_dt1 / stats->n_choice1 : -1.;
+    stats->mean_dt2 = stats->n_choice2 > 0 ? sum_dt2 / stats->n_choice2 : -1.;
+
+    if (times.empty()) {
+        stats->mean_dt = -1.;
+        stats->sd_dt = 0.;
+        stats->median_dt = -1.;
+        stats->q10_dt = -1.;
+        stats->q90_dt = -1.;
+        return;
+    }
+
+    double sum = 0.;
+    for (double t : times) sum += t;
+    stats->mean_dt = sum / times.size();
+    double ss = 0.;
+    for (double t : times) ss += (t - stats->mean_dt) * (t - stats->mean_dt);
+    stats->sd_dt = times.size() > 1 ? sqrt(ss / (times.size() - 1)) : 0.;
+
+    std::sort(times.begin(), times.end());
+    stats->median_dt = sorted_quantile(times, 0.5);
+    stats->q10_dt = sorted_quantile(times, 0.1);
+    stats->q90_dt = sorted_quantile(times, 0.9);
+}
+
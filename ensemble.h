@@ -0,0 +1,91 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "simulation.h"
+
+/*
+ * Monte Carlo ensembles: many independent trials of one parameter set,
+ * spread across threads. Trial j draws its noise from (seed, j) of the
+ * counter-based generator, so results only depend on the base seed, never on
+ * the number of threads or how trials were scheduled. Trial 0 reproduces a
+ * single run with the same seed.
+ */
+
+/* outcome of a single trial */
+typedef struct trial_outcome_s {
+    int choice;             /* 1 or 2 for the side that crossed the boundary, 0 if undecided */
+    double decision_time;   /* time the boundary was first crossed (interpolated), -1 if undecided */
+    double y1;              /* y1 where the trial stopped: at its decision, or the end of the run */
+    double y2;              /* y2 likewise */
+} trial_outcome_t;
+
+/* aggregate statistics over an ensemble */
+typedef struct ensemble_stats_s {
+    int n_trials;
+    int n_choice1;          /* trials that chose option 1 */
+    int n_choice2;          /* trials that chose option 2 */
+    int n_undecided;        /* trials that never crossed the boundary */
+    double p_choice1;
+    double p_choice2;
+    double p_undecided;
+    double mean_dt;         /* decision time over decided trials */
+    double sd_dt;
+    double median_dt;
+    double q10_dt;          /* 10% and 90% quantiles of the decision time */
+    double q90_dt;
+    double mean_dt1;        /* decision time conditional on choosing 1 */
+    double mean_dt2;        /* decision time conditional on choosing 2 */
+    double mean_y1;         /* states where the trials stopped */
+    double mean_y2;
+} ensemble_stats_t;
+
+/*
+ * trials handed to a worker at a time. they are run as one batch, one trial
+ * per vector lane, so this is a multiple of the widest vector (8 doubles)
+ */
+#define ENSEMBLE_CHUNK 16
+
+/* per thread buffers for ensemble_run_trials, grown as needed */
+typedef struct ensemble_workspace_s ensemble_workspace_t;
+
+ensemble_workspace_t *ensemble_workspace_create();
+void ensemble_workspace_destroy(ensemble_workspace_t *ws);
+
+/* number of threads used when 0 is requested */
+int ensemble_default_threads();
+
+/*
+ * run n_trials independent trials of the model on up to `threads` threads
+ * (0 for one per core). params is not modified; params->seed is the base seed.
+ * outcomes must hold n_trials entries, stats may be null.
+ * METHOD_RK4 runs the trials in vector batches (see models_batch.h), the
+ * other methods one trial at a time. Each trial stops soon after it first
+ * crosses the boundary (see *_integrate_until), which decides it; with a
+ * null boundary every trial runs to the end undecided.
+ */
+void run_ensemble(model_t m,
+                  method_t method,
+                  const void *params,
+                  int n_trials,
+                  int threads,
+                  const boundary_t *boundary,
+                  trial_outcome_t *outcomes,
+                  ensemble_stats_t *stats);
+
+/*
+ * run trials first .. first+n-1 (n at most ENSEMBLE_CHUNK) as run_ensemble
+ * does, into outcomes[0 .. n-1]: the unit of work it hands each thread
+ */
+void ensemble_run_trials(ensemble_workspace_t *ws,
+                         model_t m,
+                         method_t method,
+                         const void *params,
+                         int first,
+                         int n,
+                         const boundary_t *boundary,
+                         trial_outcome_t *outcomes);
+
+/* aggregate statistics from per trial outcomes */
+void ensemble_compute_stats(const trial_outcome_t *outcomes, int n_trials, ensemble_stats_t *stats);
+
+#endif // ENSEMBLE_H
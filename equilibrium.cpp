@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "equilibrium.h"
+
+/* Newton's method: most iterations, and the step (relative to the state's size) taken as converged */
+#define NEWTON_MAX_ITERATIONS 50
+#define NEWTON_TOLERANCE 1e-10
+
+/* halvings of a Newton step that does not reduce the residual */
+#define NEWTON_MAX_HALVINGS 10
+
+/* starting points of model_equilibria along each side of its grid */
+#define EQUILIBRIUM_GRID 9
+
+/* equilibria closer than this, relative to the state's size, are the same one */
+#define EQUILIBRIUM_SAME 1e-6
+
+/* continuation defaults, and the shortest step tried before a branch is given up */
+#define CONTINUATION_MAX_STEP 0.02
+#define CONTINUATION_MAX_POINTS 10000
+#define CONTINUATION_MIN_STEP 1e-8
+
+/* corrector iterations, and how few of them let the next step lengthen */
+#define CONTINUATION_CORRECTOR_ITERATIONS 8
+#define CONTINUATION_EASY_ITERATIONS 3
+#define CONTINUATION_GROWTH 1.5
+
+/* a branch is given up once it runs this many times the state's size from where it started */
+#define CONTINUATION_MAX_STATE 100.0
+
+const char *stability_name(stability_t stability) {
+    switch (stability) {
+        case STABILITY_STABLE_NODE: return "stable_node";
+        case STABILITY_STABLE_FOCUS: return "stable_focus";
+        case STABILITY_SADDLE: return "saddle";
+        case STABILITY_UNSTABLE_NODE: return "unstable_node";
+        case STABILITY_UNSTABLE_FOCUS: return "unstable_focus";
+        case STABILITY_DEGENERATE: return "degenerate";
+        default: return "unknown";
+    }
+}
+
+const char *branch_point_name(branch_point_kind_t kind) {
+    switch (kind) {
+        case BRANCH_POINT_REGULAR: return "-";
+        case BRANCH_POINT_START: return "start";
+        case BRANCH_POINT_END: return "end";
+        case BRANCH_POINT_FOLD: return "fold";
+        case BRANCH_POINT_BIFURCATION: return "bifurcation";
+        case BRANCH_POINT_HOPF: return "hopf";
+        default: return "unknown";
+    }
+}
+
+/* the size of the state: the population of the ant models, 1 for the activations of um and gaze */
+static double state_scale(model_t m, const void *params) {
+    double population;
+    if (model_get_param(m, params, "population", &population) == 0 && population > 0.0) return population;
+    return 1.0;
+}
+
+/*****************************************************************************
+ *
+ * Equilibria
+ *
+ *****************************************************************************/
+
+int equilibrium_newton(model_t m, const void *params, double *y1, double *y2) {
+    const double tolerance = NEWTON_TOLERANCE * state_scale(m, params);
+    double f[2], jac[2][2];
+    model_jacobian(m, params, *y1, *y2, f, jac);
+    double residual = hypot(f[0], f[1]);
+
+    for (int iteration=1; iteration<=NEWTON_MAX_ITERATIONS; iteration++) {
+        double det = jac[0][0]*jac[1][1] - jac[0][1]*jac[1][0];
+        if (det == 0.0 || !std::isfinite(det)) return -1;
+        double d1 = -(jac[1][1]*f[0] - jac[0][1]*f[1]) / det;
+        double d2 = -(jac[0][0]*f[1] - jac[1][0]*f[0]) / det;
+        if (hypot(d1, d2) <= tolerance) {
+            *y1 += d1;
+            *y2 += d2;
+            return iteration;
+        }
+
+        /* halve the step until it reduces the residual, or for as long as allowed */
+        double t = 1.0;
+        double next1, next2, next_f[2], next_jac[2][2], next_residual;
+        for (int halvings=0; ; halvings++) {
+            next1 = *y1 + t*d1;
+            next2 = *y2 + t*d2;
+            model_jacobian(m, params, next1, next2, next_f, next_jac);
+            next_residual = hypot(next_f[0], next_f[1]);
+            if (next_residual < residual || halvings == NEWTON_MAX_HALVINGS) break;
+            t *= 0.5;
+        }
+        if (!std::isfinite(next_residual)) return -1;
+
+        *y1 = next1;
+        *y2 = next2;
+        memcpy(f, next_f, sizeof(f));
+        memcpy(jac, next_jac, sizeof(jac));
+        residual = next_residual;
+    }
+    return -1;
+}
+
+void equilibrium_classify(model_t m, const void *params, double y1, double y2, equilibrium_t *eq) {
+    double f[2], jac[2][2];
+    model_jacobian(m, params, y1, y2, f, jac);
+    eq->y1 = y1;
+    eq->y2 = y2;
+
+    double trace = jac[0][0] + jac[1][1];
+    double det = jac[0][0]*jac[1][1] - jac[0][1]*jac[1][0];
+    double half = trace / 2;
+    double disc = half*half - det;
+    if (disc >= 0.0) {
+        double root = sqrt(disc);
+        eq->re[0] = half + root;
+        eq->re[1] = half - root;
+        eq->im[0] = eq->im[1] = 0.0;
+    } else {
+        eq->re[0] = eq->re[1] = half;
+        eq->im[0] = sqrt(-disc);
+        eq->im[1] = -eq->im[0];
+    }
+
+    /* zero, to rounding against the size of the Jacobian's entries */
+    double size = std::max(std::max(fabs(jac[0][0]), fabs(jac[0][1])), std::max(fabs(jac[1][0]), fabs(jac[1][1])));
+    double eps = 1e-12 * size;
+    if (fabs(det) <= eps * size) eq->stability = STABILITY_DEGENERATE;
+    else if (det < 0.0) eq->stability = STABILITY_SADDLE;
+    else if (fabs(trace) <= eps) eq->stability = STABILITY_DEGENERATE;
+    else if (trace < 0.0) eq->stability = disc >= 0.0 ? STABILITY_STABLE_NODE : STABILITY_STABLE_FOCUS;
+    else eq->stability = disc >= 0.0 ? STABILITY_UNSTABLE_NODE : STABILITY_UNSTABLE_FOCUS;
+
+    eq->feasible = 1;
+    double population;
+    if (model_get_param(m, params, "population", &population) == 0) {
+        double slack = 1e-9 * population;
+        eq->feasible = y1 >= -slack && y2 >= -slack && y1 + y2 <= population + slack;
+    }
+}
+
+int model_equilibria(model_t m, const void *params, equilibrium_t *eq, int max) {
+    const double scale = state_scale(m, params);
+
+    /* start from the initial condition, then from a grid over [0, scale] squared */
+    std::vector<double> starts;
+    double y1_0 = 0., y2_0 = 0.;
+    model_get_param(m, params, "y1_0", &y1_0);
+    model_get_param(m, params, "y2_0", &y2_0);
+    starts.push_back(y1_0);
+    starts.push_back(y2_0);
+    for (int i=0; i<EQUILIBRIUM_GRID; i++) {
+        for (int j=0; j<EQUILIBRIUM_GRID; j++) {
+            starts.push_back(scale * i / (EQUILIBRIUM_GRID-1));
+            starts.push_back(scale * j / (EQUILIBRIUM_GRID-1));
+        }
+    }
+
+    std::vector<std::pair<double, double> > found;
+    for (size_t k=0; k<starts.size(); k+=2) {
+        double y1 = starts[k], y2 = starts[k+1];
+        if (equilibrium_newton(m, params, &y1, &y2) < 0) continue;
+        bool known = false;
+        for (const auto &e : found) {
+            if (fabs(e.first - y1) <= EQUILIBRIUM_SAME * scale && fabs(e.second - y2) <= EQUILIBRIUM_SAME * scale) known = true;
+        }
+        if (!known) found.push_back(std::make_pair(y1, y2));
+    }
+    std::sort(found.begin(), found.end());
+
+    int n = std::min((int)found.size(), max);
+    for (int k=0; k<n; k++) equilibrium_classify(m, params, found[k].first, found[k].second, &eq[k]);
+    return n;
+}
+
+/*****************************************************************************
+ *
+ * Continuation
+ *
+ * A branch is traced in scaled coordinates z = (y1, y2, value) with the
+ * state divided by its size and the parameter mapped from [lo, hi] to
+ * [0, 1], so the arclength weighs the two alike. Each step predicts along
+ * the branch's tangent, the null vector of the 2 x 3 derivative of the
+ * right-hand side, and corrects back onto the branch by Newton's method on
+ * the right-hand side plus the constraint that the correction stays
+ * perpendicular to the tangent. The derivative in the parameter is taken by
+ * central differences.
+ *
+ *****************************************************************************/
+
+typedef struct tracer_s {
+    const continuation_t *c;
+    std::vector<char> params;   /* a copy, the parameter set as each point needs */
+    double scale;               /* of the state */
+    double range;               /* hi - lo */
+    double max_step;
+    int max_points;
+} tracer_t;
+
+/* where a traced branch left the range */
+typedef struct branch_end_s {
+    double z[3];
+} branch_end_t;
+
+static void tracer_set(tracer_t *t, double z2) {
+    model_set_param_value(t->c->m, t->params.data(), t->c->name, t->c->lo + z2 * t->range);
+}
+
+/* the scaled right-hand side g at z and its derivative a */
+static void tracer_eval(tracer_t *t, const double z[3], double g[2], double a[2][3]) {
+    const model_t m = t->c->m;
+    const void *p = t->params.data();
+    const double value = t->c->lo + z[2] * t->range;
+    const double y1 = z[0] * t->scale, y2 = z[1] * t->scale;
+    const double delta = 1e-6 * std::max(1.0, fabs(value));
+    double f[2], jac[2][2], f_up[2], f_down[2], unused[2][2];
+
+    model_set_param_value(m, t->params.data(), t->c->name, value + delta);
+    model_jacobian(m, p, y1, y2, f_up, unused);
+    model_set_param_value(m, t->params.data(), t->c->name, value - delta);
+    model_jacobian(m, p, y1, y2, f_down, unused);
+    model_set_param_value(m, t->params.data(), t->c->name, value);
+    model_jacobian(m, p, y1, y2, f, jac);
+
+    for (int i=0; i<2; i++) {
+        g[i] = f[i] / t->scale;
+        a[i][0] = jac[i][0];
+        a[i][1] = jac[i][1];
+        a[i][2] = (f_up[i] - f_down[i]) / (2 * delta) * t->range / t->scale;
+    }
+}
+
+/* the unit null vector of a: the cross product of its rows. false if a is singular */
+static bool branch_tangent(const double a[2][3], double tangent[3]) {
+    tangent[0] = a[0][1]*a[1][2] - a[0][2]*a[1][1];
+    tangent[1] = a[0][2]*a[1][0] - a[0][0]*a[1][2];
+    tangent[2] = a[0][0]*a[1][1] - a[0][1]*a[1][0];
+    double norm = sqrt(tangent[0]*tangent[0] + tangent[1]*tangent[1] + tangent[2]*tangent[2]);
+    if (norm == 0.0 || !std::isfinite(norm)) return false;
+    for (int k=0; k<3; k++) tangent[k] /= norm;
+    return true;
+}
+
+static double det3(const double m[3][3]) {
+    return m[0][0] * (m[1][1]*m[2][2] - m[1][2]*m[2][1])
+         - m[0][1] * (m[1][0]*m[2][2] - m[1][2]*m[2][0])
+         + m[0][2] * (m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+}
+
+/* solve m x = b by Cramer's rule, false if m is singular */
+static bool solve3(const double m[3][3], const double b[3], double x[3]) {
+    double det = det3(m);
+    if (det == 0.0 || !std::isfinite(det)) return false;
+    for (int k=0; k<3; k++) {
+        double mk[3][3];
+        memcpy(mk, m, sizeof(mk));
+        for (int i=0; i<3; i++) mk[i][k] = b[i];
+        x[k] = det3(mk) / det;
+    }
+    return true;
+}
+
+/*
+ * correct the prediction x back onto the branch, perpendicular to tangent.
+ * returns the iterations taken, or -1 if it did not converge
+ */
+static int branch_correct(tracer_t *t, const double tangent[3], double x[3]) {
+    const double predicted[3] = {x[0], x[1], x[2]};
+    for (int iteration=1; iteration<=CONTINUATION_CORRECTOR_ITERATIONS; iteration++) {
+        double g[2], a[2][3];
+        tracer_eval(t, x, g, a);
+        double m[3][3], r[3], dx[3];
+        for (int k=0; k<3; k++) {
+            m[0][k] = a[0][k];
+            m[1][k] = a[1][k];
+            m[2][k] = tangent[k];
+        }
+        r[0] = -g[0];
+        r[1] = -g[1];
+        r[2] = -(tangent[0]*(x[0]-predicted[0]) + tangent[1]*(x[1]-predicted[1]) + tangent[2]*(x[2]-predicted[2]));
+        if (!solve3(m, r, dx)) return -1;
+        for (int k=0; k<3; k++) x[k] += dx[k];
+        if (!std::isfinite(x[0] + x[1] + x[2])) return -1;
+        if (fabs(dx[0]) + fabs(dx[1]) + fabs(dx[2]) <= NEWTON_TOLERANCE) return iteration;
+    }
+    return -1;
+}
+
+/* the branch point at z, of kind REGULAR */
+static void branch_point_at(tracer_t *t, int branch, int index, const double z[3], branch_point_t *point) {
+    tracer_set(t, z[2]);
+    point->branch = branch;
+    point->index = index;
+    point->value = t->c->lo + z[2] * t->range;
+    equilibrium_classify(t->c->m, t->params.data(), z[0] * t->scale, z[1] * t->scale, &point->eq);
+    point->kind = BRANCH_POINT_REGULAR;
+}
+
+/* what happened between two neighbouring points, with their tangents */
+static branch_point_kind_t branch_point_kind(const branch_point_t *last, const double last_tangent[3],
+                                             const branch_point_t *point, const double tangent[3]) {
+    if (last_tangent[2] * tangent[2] < 0.0) return BRANCH_POINT_FOLD;
+    const equilibrium_t *a = &last->eq, *b = &point->eq;
+    double det_a = a->re[0]*a->re[1] - a->im[0]*a->im[1];
+    double det_b = b->re[0]*b->re[1] - b->im[0]*b->im[1];
+    if (det_a * det_b < 0.0) return BRANCH_POINT_BIFURCATION;
+    double trace_a = a->re[0] + a->re[1];
+    double trace_b = b->re[0] + b->re[1];
+    if (det_a > 0.0 && det_b > 0.0 && trace_a * trace_b < 0.0) return BRANCH_POINT_HOPF;
+    return BRANCH_POINT_REGULAR;
+}
+
+/*
+ * follow a branch from the equilibrium at z, the parameter moving in
+ * direction dir (1 or -1) to start with, adding where it leaves the range
+ * to ends. each point is emitted once the next is found, so the last can
+ * be marked as the end
+ */
+static int trace_branch(tracer_t *t, int branch, const double start[3], int dir,
+                        std::vector<branch_end_t> *ends, continuation_emit_t emit, void *user) {
+    double z[3] = {start[0], start[1], start[2]};
+    double g[2], a[2][3], tangent[3];
+    tracer_eval(t, z, g, a);
+    if (!branch_tangent(a, tangent)) {
+        tangent[0] = tangent[1] = 0.0;
+        tangent[2] = 1.0;
+    }
+    if (tangent[2] * dir < 0.0) {
+        for (int k=0; k<3; k++) tangent[k] = -tangent[k];
+    }
+
+    branch_point_t pending;
+    branch_point_at(t, branch, 0, z, &pending);
+    pending.kind = BRANCH_POINT_START;
+
+    double step = t->max_step / 4;
+    for (int index=1; index<t->max_points; index++) {
+        /* predict along the tangent and correct, shortening the step until that works */
+        double x[3];
+        int iterations = -1;
+        while (step >= CONTINUATION_MIN_STEP) {
+            for (int k=0; k<3; k++) x[k] = z[k] + step * tangent[k];
+            iterations = branch_correct(t, tangent, x);
+            if (iterations >= 0) break;
+            step /= 2;
+        }
+        if (iterations < 0) break;
+        if (fabs(x[0] - start[0]) > CONTINUATION_MAX_STATE || fabs(x[1] - start[1]) > CONTINUATION_MAX_STATE) break;
+
+        /* past an end of the range: stop on it, from where the step crossed it */
+        bool leaving = x[2] < 0.0 || x[2] > 1.0;
+        if (leaving) {
+            double bound = x[2] < 0.0 ? 0.0 : 1.0;
+            double frac = (bound - z[2]) / (x[2] - z[2]);
+            for (int k=0; k<2; k++) x[k] = z[k] + frac * (x[k] - z[k]);
+            x[2] = bound;
+            tracer_set(t, bound);
+            double y1 = x[0] * t->scale, y2 = x[1] * t->scale;
+            if (equilibrium_newton(t->c->m, t->params.data(), &y1, &y2) >= 0) {
+                x[0] = y1 / t->scale;
+                x[1] = y2 / t->scale;
+            }
+        }
+
+        double next_tangent[3];
+        tracer_eval(t, x, g, a);
+        if (!branch_tangent(a, next_tangent)) memcpy(next_tangent, tangent, sizeof(next_tangent));
+        if (next_tangent[0]*tangent[0] + next_tangent[1]*tangent[1] + next_tangent[2]*tangent[2] < 0.0) {
+            for (int k=0; k<3; k++) next_tangent[k] = -next_tangent[k];
+        }
+
+        branch_point_t point;
+        branch_point_at(t, branch, index, x, &point);
+        point.kind = branch_point_kind(&pending, tangent, &point, next_tangent);
+        int status = emit(&pending, user);
+        if (status != 0) return status;
+        pending = point;
+
+        if (leaving) {
+            branch_end_t end = {{x[0], x[1], x[2]}};
+            ends->push_back(end);
+            break;
+        }
+        memcpy(z, x, sizeof(z));
+        memcpy(tangent, next_tangent, sizeof(tangent));
+        if (iterations <= CONTINUATION_EASY_ITERATIONS) step = std::min(step * CONTINUATION_GROWTH, t->max_step);
+    }
+
+    if (pending.index > 0) pending.kind = BRANCH_POINT_END;
+    return emit(&pending, user);
+}
+
+int run_continuation(const continuation_t *c, continuation_emit_t emit, void *user, int *branches) {
+    *branches = 0;
+    int count;
+    const param_info_t *info = model_param_info(c->m, &count);
+    bool found = false;
+    for (int i=0; i<count; i++) {
+        if (strcmp(info[i].name, c->name) == 0) found = info[i].type == PARAM_DOUBLE;
+    }
+    if (!found || !(c->hi > c->lo)) return -1;
+
+    tracer_t t;
+    t.c = c;
+    t.params.resize(model_params_size(c->m));
+    memcpy(t.params.data(), c->params, t.params.size());
+    t.scale = state_scale(c->m, c->params);
+    t.range = c->hi - c->lo;
+    t.max_step = c->max_step > 0.0 ? c->max_step : CONTINUATION_MAX_STEP;
+    t.max_points = c->max_points > 0 ? c->max_points : CONTINUATION_MAX_POINTS;
+
+    /* the equilibria at lo, continued upwards, then those at hi no branch has reached, downwards */
+    std::vector<branch_end_t> ends;
+    for (int side=0; side<2; side++) {
+        tracer_set(&t, side);
+        equilibrium_t eq[EQUILIBRIUM_MAX];
+        int n = model_equilibria(c->m, t.params.data(), eq, EQUILIBRIUM_MAX);
+        for (int k=0; k<n; k++) {
+            double z[3] = {eq[k].y1 / t.scale, eq[k].y2 / t.scale, (double)side};
+            bool reached = false;
+            for (const branch_end_t &end : ends) {
+                if (end.z[2] == z[2] && fabs(end.z[0] - z[0]) <= EQUILIBRIUM_SAME && fabs(end.z[1] - z[1]) <= EQUILIBRIUM_SAME) reached = true;
+            }
+            if (reached) continue;
+
+            int status = trace_branch(&t, *branches, z, side == 0 ? 1 : -1, &ends, emit, user);
+            if (status != 0) return status;
+            (*branches)++;
+        }
+    }
+    return 0;
+}
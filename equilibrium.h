@@ -0,0 +1,99 @@
+#ifndef EQUILIBRIUM_H
+#define EQUILIBRIUM_H
+
+#include "simulation.h"
+
+/*
+ * Steady states of the noise-free models, and how they move as a parameter
+ * changes: whether a configuration settles on a decision or in deadlock,
+ * without integrating a long transient to find out.
+ *
+ * Equilibria are found by Newton's method on the analytic Jacobians of
+ * model_jacobian, started from a grid over the state space, and classified
+ * by the eigenvalues of the Jacobian there. Branches of equilibria are
+ * traced through a parameter range by pseudo-arclength continuation, which
+ * follows a branch around its folds: the equilibria found at each end of
+ * the range are continued into it, so every branch that reaches either end
+ * is traced once (a closed branch that reaches neither is not found).
+ */
+
+/* most equilibria model_equilibria reports */
+#define EQUILIBRIUM_MAX 16
+
+typedef enum {
+    STABILITY_STABLE_NODE = 0,
+    STABILITY_STABLE_FOCUS,
+    STABILITY_SADDLE,
+    STABILITY_UNSTABLE_NODE,
+    STABILITY_UNSTABLE_FOCUS,
+    STABILITY_DEGENERATE,       /* a zero eigenvalue, or a centre: undecided at first order */
+    STABILITY_COUNT
+} stability_t;
+
+typedef struct equilibrium_s {
+    double y1;
+    double y2;
+    double re[2];               /* eigenvalues of the Jacobian, re[0] >= re[1] */
+    double im[2];
+    stability_t stability;
+    int feasible;               /* 0 if past the population of an ant model (see *_jacobian) */
+} equilibrium_t;
+
+/* stability names as printed ("stable_node", "saddle", ...) */
+const char *stability_name(stability_t stability);
+
+/*
+ * Newton's method from (*y1, *y2), which are set to the equilibrium.
+ * returns the iterations taken, or -1 if it did not converge
+ */
+int equilibrium_newton(model_t m, const void *params, double *y1, double *y2);
+
+/* fill eq with the stability of the model at (y1, y2) */
+void equilibrium_classify(model_t m, const void *params, double y1, double y2, equilibrium_t *eq);
+
+/* the distinct equilibria found, up to max of them in order of y1 then y2; returns how many */
+int model_equilibria(model_t m, const void *params, equilibrium_t *eq, int max);
+
+/* what is special about a point of a branch */
+typedef enum {
+    BRANCH_POINT_REGULAR = 0,
+    BRANCH_POINT_START,         /* an equilibrium at an end of the range */
+    BRANCH_POINT_END,           /* where the branch leaves the range, or could be followed no further */
+    BRANCH_POINT_FOLD,          /* the branch turned back in the parameter since the last point */
+    BRANCH_POINT_BIFURCATION,   /* a real eigenvalue crossed 0 since the last point, without a fold */
+    BRANCH_POINT_HOPF,          /* a complex pair crossed the imaginary axis since the last point */
+    BRANCH_POINT_COUNT
+} branch_point_kind_t;
+
+/* branch point names as printed ("start", "fold", ...) */
+const char *branch_point_name(branch_point_kind_t kind);
+
+typedef struct continuation_s {
+    model_t m;
+    const void *params;         /* every other parameter */
+    const char *name;           /* the parameter continued in, a double one */
+    double lo;
+    double hi;
+    double max_step;            /* longest step along a branch, as a fraction of the range; 0 for 0.02 */
+    int max_points;             /* most points a branch, 0 for 10000 */
+} continuation_t;
+
+typedef struct branch_point_s {
+    int branch;                 /* 0 for the first */
+    int index;                  /* along the branch */
+    double value;               /* of the parameter */
+    equilibrium_t eq;
+    branch_point_kind_t kind;
+} branch_point_t;
+
+/* receives each point in turn, branch by branch; a nonzero return stops the continuation */
+typedef int (*continuation_emit_t)(const branch_point_t *point, void *user);
+
+/*
+ * trace the branches through [lo, hi], setting branches to how many there
+ * were. returns 0, -1 if the parameter is not a double parameter of the
+ * model, or the nonzero status emit stopped with
+ */
+int run_continuation(const continuation_t *c, continuation_emit_t emit, void *user, int *branches);
+
+#endif // EQUILIBRIUM_H
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "buffer_pool.h"
+#include "fit.h"
+#include "models_batch.h"
+
+/* candidates handed to a worker at a time */
+#define FIT_CHUNK 64
+
+/* steps simulated between checks of a candidate's distance so far */
+#define FIT_BLOCK 32
+
+/* random stream of the prior draws, clear of the models' noise channels */
+#define FIT_STREAM_PRIOR 0x200
+
+/* an observation at time t falls between results step and step+1, frac of the way along */
+static void observation_position(double t, double h, int *step, double *frac) {
+    double pos = t / h;
+    *step = (int)floor(pos);
+    *frac = pos - *step;
+    if (*frac < 1e-9) *frac = 0.0;
+}
+
+/* orders samples closest first, ties by candidate */
+static bool sample_closer(const fit_sample_t &a, const fit_sample_t &b) {
+    if (a.distance != b.distance) return a.distance < b.distance;
+    return a.candidate < b.candidate;
+}
+
+/* the state of a fit shared by its workers */
+typedef struct fitter_s {
+    const fit_t *fit;
+    std::mutex lock;
+    std::vector<fit_sample_t> heap;     /* the closest so far, furthest on top */
+    std::atomic<double> threshold;      /* distance a candidate must stay within to be kept */
+    std::atomic<long> next_chunk;
+    std::atomic<long> simulated;
+    std::atomic<long> rejected_early;
+} fitter_t;
+
+static void fitter_offer(fitter_t *f, const fit_sample_t *sample) {
+    const fit_t *fit = f->fit;
+    std::lock_guard<std::mutex> guard(f->lock);
+    if ((int)f->heap.size() < fit->n_accept) {
+        f->heap.push_back(*sample);
+        std::push_heap(f->heap.begin(), f->heap.end(), sample_closer);
+    } else if (sample_closer(*sample, f->heap.front())) {
+        std::pop_heap(f->heap.begin(), f->heap.end(), sample_closer);
+        f->heap.back() = *sample;
+        std::push_heap(f->heap.begin(), f->heap.end(), sample_closer);
+    } else {
+        return;
+    }
+    if ((int)f->heap.size() == fit->n_accept && f->heap.front().distance < f->threshold.load()) {
+        f->threshold.store(f->heap.front().distance);
+    }
+}
+
+/* per thread buffers, reused across candidates (and, through the buffer pool, across fits) */
+typedef struct fit_workspace_s {
+    std::vector<char> params;
+    buffer_vector_t noise;
+    std::vector<double *> channels;
+    buffer_vector_t results_y1;
+    buffer_vector_t results_y2;
+} fit_workspace_t;
+
+/*
+ * simulate candidate k; sets the sample and returns true if it stayed
+ * within the threshold to the end
+ */
+static bool run_candidate(fitter_t *f, fit_workspace_t *ws, long k, fit_sample_t *sample) {
+    const fit_t *fit = f->fit;
+    const model_t m = fit->m;
+    double seed;
+    model_get_param(m, fit->params, "seed", &seed);
+    noise_key_t key = noise_key((int)seed, (uint32_t)k);
+
+    void *p = ws->params.data();
+    memcpy(p, fit->params, ws->params.size());
+    sample->candidate = k;
+    for (int v=0; v<fit->n_vars; v++) {
+        const fit_prior_t *prior = &fit->priors[v];
+        double u = rng_uniform(&key, FIT_STREAM_PRIOR + v, 0);
+        model_set_param_value(m, p, prior->name, prior->lo + (prior->hi - prior->lo) * u);
+        model_get_param(m, p, prior->name, &sample->values[v]);
+    }
+
+    int length = model_params_length(m, p);
+    double h, y1_0, y2_0;
+    model_get_param(m, p, "h", &h);
+    model_get_param(m, p, "y1_0", &y1_0);
+    model_get_param(m, p, "y2_0", &y2_0);
+    if (fit->t[fit->n_obs-1] > (length-1) * h * (1 + 1e-9)) return false;
+    if (ws->results_y1.size() < (size_t)length) {
+        ws->results_y1.resize(length);
+        ws->results_y2.resize(length);
+    }
+    double *results_y1 = ws->results_y1.data();
+    double *results_y2 = ws->results_y2.data();
+    results_y1[0] = y1_0;
+    results_y2[0] = y2_0;
+
+    double threshold = f->threshold.load(std::memory_order_relaxed);
+    double limit = threshold * threshold * 2 * fit->n_obs;
+    double sse = 0.;
+    int next = 0;
+    for (int done=0; ; ) {
+        /* add the observations the results so far reach */
+        for (; next < fit->n_obs; next++) {
+            int step;
+            double frac;
+            observation_position(fit->t[next], h, &step, &frac);
+            if (step + (frac > 0.0) > done) break;
+            double s1 = results_y1[step], s2 = results_y2[step];
+            if (frac > 0.0) {
+                s1 += frac * (results_y1[step+1] - results_y1[step]);
+                s2 += frac * (results_y2[step+1] - results_y2[step]);
+            }
+            sse += (s1 - fit->y1[next]) * (s1 - fit->y1[next]) + (s2 - fit->y2[next]) * (s2 - fit->y2[next]);
+        }
+        if (sse > limit) {
+            if (next < fit->n_obs) f->rejected_early++;
+            return false;
+        }
+        if (next >= fit->n_obs) break;
+
+        if (done >= length-1) return false;
+        int count = std::min(length-1-done, FIT_BLOCK);
+        model_fill_noise(m, p, &key, done, count, ws->channels.data());
+        model_rk4_batch_steps(m, p, 1, done, count, (const double *const *)ws->channels.data(), results_y1 + done, results_y2 + done);
+        done += count;
+
+        threshold = f->threshold.load(std::memory_order_relaxed);
+        limit = threshold * threshold * 2 * fit->n_obs;
+    }
+
+    sample->distance = sqrt(sse / (2 * fit->n_obs));
+    return true;
+}
+
+int run_fit(const fit_t *fit, fit_sample_t *samples, fit_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    if (fit->n_obs <= 0 || fit->n_accept <= 0) return 0;
+
+    /* the observations must lie, in order, within the run */
+    double h;
+    model_get_param(fit->m, fit->params, "h", &h);
+    double duration = (model_params_length(fit->m, fit->params) - 1) * h;
+    for (int o=0; o<fit->n_obs; o++) {
+        if (fit->t[o] < 0.0 || fit->t[o] > duration * (1 + 1e-9)) return -1;
+        if (o > 0 && fit->t[o] < fit->t[o-1]) return -1;
+    }
+
+    fitter_t f;
+    f.fit = fit;
+    f.threshold.store(fit->tolerance > 0.0 ? fit->tolerance : std::numeric_limits<double>::infinity());
+    f.next_chunk.store(0);
+    f.simulated.store(0);
+    f.rejected_early.store(0);
+
+    const long n_chunks = (fit->n_candidates + FIT_CHUNK - 1) / FIT_CHUNK;
+    int threads = fit->threads > 0 ? fit->threads : ensemble_default_threads();
+    if (threads > n_chunks) threads = (int)std::max(1L, n_chunks);
+
+    auto worker = [&]() {
+        fit_workspace_t ws;
+        int channels = model_noise_channels(fit->m);
+        ws.params.resize(model_params_size(fit->m));
+        ws.noise.resize((size_t)channels * FIT_BLOCK);
+        ws.channels.resize(channels);
+        for (int c=0; c<channels; c++) ws.channels[c] = ws.noise.data() + (size_t)c * FIT_BLOCK;
+
+        for (;;) {
+            long chunk = f.next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= n_chunks) break;
+            long first = chunk * FIT_CHUNK;
+            long last = std::min(fit->n_candidates, first + FIT_CHUNK);
+            for (long k=first; k<last; k++) {
+                fit_sample_t sample;
+                f.simulated++;
+                if (run_candidate(&f, &ws, k, &sample)) fitter_offer(&f, &sample);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i=1; i<threads; i++) pool.push_back(std::thread(worker));
+    worker();
+    for (auto &t : pool) t.join();
+
+    std::sort(f.heap.begin(), f.heap.end(), sample_closer);
+    for (size_t i=0; i<f.heap.size(); i++) samples[i] = f.heap[i];
+    result->simulated = f.simulated.load();
+    result->rejected_early = f.rejected_early.load();
+    result->n_accepted = (int)f.heap.size();
+    result->max_distance = f.heap.empty() ? -1. : f.heap.back().distance;
+    return 0;
+}
+
+void fit_summarise(const fit_sample_t *samples, int n, int var, fit_summary_t *summary) {
+    memset(summary, 0, sizeof(*summary));
+    if (n <= 0) return;
+
+    std::vector<double> values(n);
+    double sum = 0.;
+    for (int i=0; i<n; i++) {
+        values[i] = samples[i].values[var];
+        sum += values[i];
+    }
+    summary->mean = sum / n;
+    double ss = 0.;
+    for (int i=0; i<n; i++) ss += (values[i] - summary->mean) * (values[i] - summary->mean);
+    summary->sd = n > 1 ? sqrt(ss / (n - 1)) : 0.;
+
+    std::sort(values.begin(), values.end());
+    auto quantile = [&](double q) {
+        double pos = q * (n - 1);
+        int below = (int)pos;
+        if (below + 1 >= n) return values[n-1];
+        double frac = pos - below;
+        return (1 - frac) * values[below] + frac * values[below+1];
+    };
+    summary->q05 = quantile(0.05);
+    summary->median = quantile(0.5);
+    summary->q95 = quantile(0.95);
+}
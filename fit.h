@@ -0,0 +1,78 @@
+#ifndef FIT_H
+#define FIT_H
+
+#include "ensemble.h"
+
+/*
+ * Fitting parameters to an observed trajectory by approximate Bayesian
+ * computation (rejection ABC).
+ *
+ * Candidate k draws its parameters from the prior, uniform over each
+ * range, and its noise from trial k of the seed, so the whole fit is a
+ * pure function of the seed however it is spread over threads. Each
+ * candidate is simulated by the rk4 batch kernels a block of steps at a
+ * time and scored by the rms distance between its trajectory and the
+ * observations, the simulation being linearly interpolated to the observed
+ * times. The closest n_accept candidates are kept as the posterior sample.
+ * A candidate is dropped as soon as its distance so far can no longer get
+ * it into the sample, so bad candidates cost only the steps that show it.
+ */
+
+/* most parameters fitted at once */
+#define FIT_MAX_VARS 8
+
+/* one fitted parameter, with a uniform prior over [lo, hi] */
+typedef struct fit_prior_s {
+    const char *name;       /* parameter name, as for model_set_param */
+    double lo;
+    double hi;
+} fit_prior_t;
+
+typedef struct fit_s {
+    model_t m;
+    const void *params;         /* every other parameter, and the seed */
+    int n_vars;
+    fit_prior_t priors[FIT_MAX_VARS];
+    int n_obs;                  /* observations, in increasing time within the run */
+    const double *t;
+    const double *y1;
+    const double *y2;
+    long n_candidates;          /* drawn from the prior */
+    int n_accept;               /* size of the posterior sample */
+    double tolerance;           /* largest distance accepted, 0 for no limit */
+    int threads;                /* 0 for one per core */
+} fit_t;
+
+/* an accepted candidate */
+typedef struct fit_sample_s {
+    long candidate;
+    double values[FIT_MAX_VARS];    /* as set (int parameters rounded) */
+    double distance;                /* rms over both series and all observations */
+} fit_sample_t;
+
+typedef struct fit_result_s {
+    long simulated;         /* candidates run */
+    long rejected_early;    /* of which stopped before the end of the run */
+    int n_accepted;         /* samples written, closest first */
+    double max_distance;    /* of the furthest accepted */
+} fit_result_t;
+
+/* the posterior of one parameter from the sample */
+typedef struct fit_summary_s {
+    double mean;
+    double sd;
+    double q05;             /* 5%, 50% and 95% quantiles */
+    double median;
+    double q95;
+} fit_summary_t;
+
+/*
+ * run the fit, writing up to fit->n_accept samples, closest first, to
+ * samples. returns -1 if an observation is outside the run or out of order
+ */
+int run_fit(const fit_t *fit, fit_sample_t *samples, fit_result_t *result);
+
+/* the posterior summary of parameter `var` over n samples */
+void fit_summarise(const fit_sample_t *samples, int n, int var, fit_summary_t *summary);
+
+#endif // FIT_H
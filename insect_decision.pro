@@ -1,27 +1,13 @@
-TEMPLATE = app
-TARGET = insect_decision
+TEMPLATE = subdirs
 
-QT = core gui
-QT += charts
-QT += printsupport
+# models:   headless static library (no Qt dependency)
+# gui:      the Qt charting application
+# cli:      command line front end for batch runs on headless machines
+SUBDIRS = models gui cli
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+models.file = insect_decision_models.pro
+gui.file = insect_decision_gui.pro
+cli.file = insect_decision_cli.pro
 
-SOURCES += \
-    main.cpp \
-    mainwindow.cpp \
-    models.cpp \
-    chart_um.cpp \
-    chart_pratt.cpp \
-    chart_indirect_britton.cpp \
-    chart_direct_britton.cpp \
-    chart_gaze.cpp
-
-HEADERS += \
-    mainwindow.h \
-    models.h \
-    chart_um.h \
-    chart_pratt.h \
-    chart_indirect_britton.h \
-    chart_direct_britton.h \
-    chart_gaze.h
+gui.depends = models
+cli.depends = models
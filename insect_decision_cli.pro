@@ -0,0 +1,10 @@
+TEMPLATE = app
+TARGET = insect_decision_cli
+
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+include(insect_decision_models.pri)
+
+SOURCES += \
+    cli.cpp
@@ -0,0 +1,37 @@
+TEMPLATE = app
+TARGET = insect_decision
+
+QT = core gui
+QT += charts
+QT += printsupport
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++11
+
+include(insect_decision_models.pri)
+
+SOURCES += \
+    main.cpp \
+    mainwindow.cpp \
+    chart_lod.cpp \
+    simulation_run.cpp \
+    simulation_job.cpp \
+    chart_model.cpp \
+    chart_um.cpp \
+    chart_pratt.cpp \
+    chart_indirect_britton.cpp \
+    chart_direct_britton.cpp \
+    chart_gaze.cpp
+
+HEADERS += \
+    mainwindow.h \
+    chart_lod.h \
+    simulation_run.h \
+    simulation_job.h \
+    chart_model.h \
+    chart_um.h \
+    chart_pratt.h \
+    chart_indirect_britton.h \
+    chart_direct_britton.h \
+    chart_gaze.h
@@ -0,0 +1,16 @@
+# link against the headless models library built by insect_decision_models.pro
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+# the ensemble runner uses std::thread
+CONFIG += thread
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/release/ -linsect_decision_models
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/debug/ -linsect_decision_models
+else:unix: LIBS += -L$$OUT_PWD/ -linsect_decision_models
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/release/libinsect_decision_models.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/debug/libinsect_decision_models.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/release/insect_decision_models.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/debug/insect_decision_models.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/libinsect_decision_models.a
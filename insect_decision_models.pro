@@ -0,0 +1,50 @@
+TEMPLATE = lib
+TARGET = insect_decision_models
+
+CONFIG += staticlib c++11
+CONFIG -= qt
+
+# no fused multiply-add contraction: the batch kernels must round exactly
+# like the scalar code, and the noise generator the same on every compiler
+gcc|clang: QMAKE_CXXFLAGS += -ffp-contract=off
+
+SOURCES += \
+    rng.cpp \
+    buffer_pool.cpp \
+    models.cpp \
+    model_registry.cpp \
+    simulation.cpp \
+    ensemble.cpp \
+    ou.cpp \
+    sweep.cpp \
+    optimize.cpp \
+    fit.cpp \
+    equilibrium.cpp \
+    result_cache.cpp \
+    trajectory_file.cpp \
+    lod.cpp \
+    models_batch.cpp \
+    benchmark.cpp
+
+HEADERS += \
+    rng.h \
+    buffer_pool.h \
+    rng_philox.inc \
+    models.h \
+    simulation.h \
+    model_registry.h \
+    ensemble.h \
+    sweep.h \
+    optimize.h \
+    fit.h \
+    equilibrium.h \
+    result_cache.h \
+    trajectory_file.h \
+    lod.h \
+    models_batch.h \
+    benchmark.h \
+    stepper.h \
+    adaptive.h \
+    sde.h \
+    ou.h \
+    models_batch_kernels.inc
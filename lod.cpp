@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <vector>
+#include "lod.h"
+
+struct lod_pyramid_s {
+    std::vector<double> values;
+    /* levels 1 and up: node k of level l covers values k*2^l .. (k+1)*2^l - 1 */
+    std::vector<std::vector<int> > min_index;
+    std::vector<std::vector<int> > max_index;
+};
+
+lod_pyramid_t *lod_pyramid_create(const double *values, int length) {
+    lod_pyramid_t *p = new lod_pyramid_t;
+    lod_pyramid_append(p, values, length);
+    return p;
+}
+
+void lod_pyramid_append(lod_pyramid_t *p, const double *values, int count) {
+    if (count <= 0) return;
+    p->values.insert(p->values.end(), values, values + count);
+
+    /* the nodes each level gains, from the level below, until one node is left */
+    const std::vector<double> &v = p->values;
+    int below = (int)v.size();
+    for (int level=1; below > 1; level++) {
+        int n = below / 2;
+        if ((int)p->min_index.size() < level) {
+            p->min_index.push_back(std::vector<int>());
+            p->max_index.push_back(std::vector<int>());
+        }
+        std::vector<int> &mins = p->min_index[level-1];
+        std::vector<int> &maxs = p->max_index[level-1];
+        int done = (int)mins.size();
+        mins.resize(n);
+        maxs.resize(n);
+        for (int k=done; k<n; k++) {
+            int a_min, b_min, a_max, b_max;
+            if (level == 1) {
+                a_min = a_max = 2*k;
+                b_min = b_max = 2*k + 1;
+            } else {
+                const std::vector<int> &lower_min = p->min_index[level-2];
+                const std::vector<int> &lower_max = p->max_index[level-2];
+                a_min = lower_min[2*k];
+                b_min = lower_min[2*k + 1];
+                a_max = lower_max[2*k];
+                b_max = lower_max[2*k + 1];
+            }
+            mins[k] = v[b_min] < v[a_min] ? b_min : a_min;
+            maxs[k] = v[b_max] > v[a_max] ? b_max : a_max;
+        }
+        below = n;
+    }
+}
+
+void lod_pyramid_destroy(lod_pyramid_t *p) {
+    delete p;
+}
+
+int lod_pyramid_length(const lod_pyramid_t *p) {
+    return (int)p->values.size();
+}
+
+double lod_pyramid_value(const lod_pyramid_t *p, int i) {
+    return p->values[i];
+}
+
+void lod_pyramid_extrema(const lod_pyramid_t *p, int from, int to, int *i_min, int *i_max) {
+    const std::vector<double> &v = p->values;
+    int lo = from, hi = from;
+
+    /* climb: take the odd node at either end of the range, then halve it */
+    int a = from, b = to;
+    for (int level=0; a < b; level++) {
+        if (a & 1) {
+            int node_min = level == 0 ? a : p->min_index[level-1][a];
+            int node_max = level == 0 ? a : p->max_index[level-1][a];
+            if (v[node_min] < v[lo]) lo = node_min;
+            if (v[node_max] > v[hi]) hi = node_max;
+            a++;
+        }
+        if (b & 1) {
+            b--;
+            int node_min = level == 0 ? b : p->min_index[level-1][b];
+            int node_max = level == 0 ? b : p->max_index[level-1][b];
+            if (v[node_min] < v[lo]) lo = node_min;
+            if (v[node_max] > v[hi]) hi = node_max;
+        }
+        a /= 2;
+        b /= 2;
+    }
+    *i_min = lo;
+    *i_max = hi;
+}
+
+int lod_decimate(const lod_pyramid_t *p, int from, int to, int buckets, int *indices) {
+    int length = lod_pyramid_length(p);
+    from = std::max(from, 0);
+    to = std::min(to, length);
+    if (to <= from || buckets < 1) return 0;
+
+    int n = 0;
+    long count = to - from;
+    if (count <= (long)LOD_POINTS_PER_BUCKET * buckets) {
+        for (int i=from; i<to; i++) indices[n++] = i;
+        return n;
+    }
+
+    for (int k=0; k<buckets; k++) {
+        int first = from + (int)(count * k / buckets);
+        int last = from + (int)(count * (k + 1) / buckets) - 1;
+        int i_min, i_max;
+        lod_pyramid_extrema(p, first, last + 1, &i_min, &i_max);
+
+        int picked[LOD_POINTS_PER_BUCKET] = {first, std::min(i_min, i_max), std::max(i_min, i_max), last};
+        for (int j=0; j<LOD_POINTS_PER_BUCKET; j++) {
+            if (n == 0 || picked[j] > indices[n-1]) indices[n++] = picked[j];
+        }
+    }
+    return n;
+}
@@ -0,0 +1,44 @@
+#ifndef LOD_H
+#define LOD_H
+
+/*
+ * Level of detail for drawing long trajectories: a min/max pyramid over a
+ * series of values, from which just enough points are picked to draw any
+ * range of it at a given width without losing a peak.
+ *
+ * Level 0 is the values themselves; each level above holds, for every pair
+ * of nodes below it, the index of the smaller and of the larger value. The
+ * extrema of any range are then found among O(log n) nodes, so decimating a
+ * range into buckets costs O(buckets log n) whatever its length. Each
+ * bucket gives its first, smallest, largest and last values, in order,
+ * which drawn as a polyline covers exactly the same pixels as every value
+ * in it would.
+ */
+
+/* the most points lod_decimate writes per bucket */
+#define LOD_POINTS_PER_BUCKET 4
+
+typedef struct lod_pyramid_s lod_pyramid_t;
+
+/* a pyramid over a copy of length values (none to start empty) */
+lod_pyramid_t *lod_pyramid_create(const double *values, int length);
+void lod_pyramid_destroy(lod_pyramid_t *p);
+
+/* add count more values at the end, as a run brings them: O(count) */
+void lod_pyramid_append(lod_pyramid_t *p, const double *values, int count);
+
+int lod_pyramid_length(const lod_pyramid_t *p);
+double lod_pyramid_value(const lod_pyramid_t *p, int i);
+
+/* indices of the smallest and largest of values from .. to-1 (from < to) */
+void lod_pyramid_extrema(const lod_pyramid_t *p, int from, int to, int *i_min, int *i_max);
+
+/*
+ * pick the values from .. to-1 to draw in buckets columns: all of them if
+ * there are few enough, else up to LOD_POINTS_PER_BUCKET per bucket.
+ * indices must have room for LOD_POINTS_PER_BUCKET * buckets; they are
+ * written in increasing order. returns how many were written
+ */
+int lod_decimate(const lod_pyramid_t *p, int from, int to, int buckets, int *indices);
+
+#endif // LOD_H
@@ -1,23 +1,36 @@
-#include "chart_um.h"
-#include "chart_pratt.h"
-#include "chart_indirect_britton.h"
-#include "chart_direct_britton.h"
-#include "chart_gaze.h"
+#include "chart_model.h"
 #include "mainwindow.h"
-#include "models.h"
+#include "simulation.h"
 
-/* for debugging */
-#include <iostream>
+#include <QThreadPool>
+#include <vector>
+
+/* memory the result cache may hold */
+#define RESULT_CACHE_BYTES ((size_t)256 << 20)
+
+/* how often running models are shown, in milliseconds: at most 30 frames a second of live charts */
+#define FRAME_INTERVAL 33
+
+/* how long edits must pause before the model is run again, in milliseconds */
+#define RERUN_DELAY 40
+
+/* the most memory kept for noise to rerun with (see run_noise_create) */
+#define NOISE_BYTES ((size_t)256 << 20)
 
 MainWindow::MainWindow(QWidget *parent)
     : QWidget(parent)
 {
     /* set default paramters */
-    um_set_defaults(&params_um);
-    pratt_set_defaults(&params_pratt);
-    indirect_britton_set_defaults(&params_indirect_britton);
-    direct_britton_set_defaults(&params_direct_britton);
-    gaze_set_defaults(&params_gaze);
+    params_of[MODEL_UM] = &params_um;
+    params_of[MODEL_PRATT] = &params_pratt;
+    params_of[MODEL_INDIRECT_BRITTON] = &params_indirect_britton;
+    params_of[MODEL_DIRECT_BRITTON] = &params_direct_britton;
+    params_of[MODEL_GAZE] = &params_gaze;
+    for (int m=0; m<MODEL_COUNT; m++) model_set_defaults((model_t)m, params_of[m]);
+    result_cache = result_cache_create(RESULT_CACHE_BYTES);
+    rerun_job = nullptr;
+    rerun_from = 0;
+    for (int i=0; i<MODEL_COUNT; i++) chart_hash[i] = 0;
 
     /* set default window size */
     setFixedWidth(700);
@@ -27,6 +40,8 @@ MainWindow::MainWindow(QWidget *parent)
     create_combo_menu_box();
     create_action_box();
     create_model_box();
+    create_debug_box();
+    create_runs_box();
 
     /* main layout */
     QVBoxLayout * main_layout = new QVBoxLayout;
@@ -36,6 +51,8 @@ MainWindow::MainWindow(QWidget *parent)
     main_layout->addWidget(combo_menu_box);
     main_layout->addWidget(model_box);
     main_layout->addWidget(action_box);
+    main_layout->addWidget(runs_box);
+    main_layout->addWidget(debug_box);
 
     /* stick the layout in this widget (i.e., this window) and make it appear */
     setLayout(main_layout);
@@ -43,6 +60,15 @@ MainWindow::MainWindow(QWidget *parent)
     show();
 }
 
+MainWindow::~MainWindow()
+{
+    /* the runs write into their jobs, which go with this window */
+    for (int i=0; i<runs.size(); i++) runs[i].job->cancel();
+    if (rerun_job != nullptr) rerun_job->cancel();
+    QThreadPool::globalInstance()->waitForDone();
+    result_cache_destroy(result_cache);
+}
+
 /* create the menu bar.
  * Note: on mac osx creating an exit action for a file menu apparently defaults to the
  * mac way of doing it (no File menu is created)
@@ -52,8 +78,24 @@ void MainWindow::create_menu_bar() {
     fileMenu = new QMenu(tr("&File"), this);
     exitAction = fileMenu->addAction(tr("E&xit"));
 
+    viewMenu = new QMenu(tr("&View"), this);
+    debugAction = viewMenu->addAction(tr("&Debug panel"));
+    debugAction->setCheckable(true);
+    liveAction = viewMenu->addAction(tr("&Live charts"));
+    liveAction->setCheckable(true);
+    liveAction->setChecked(true);
+    autoAction = viewMenu->addAction(tr("&Auto rerun"));
+    autoAction->setCheckable(true);
+
+    rerun_timer = new QTimer(this);
+    rerun_timer->setSingleShot(true);
+    rerun_timer->setInterval(RERUN_DELAY);
+    connect(rerun_timer, SIGNAL(timeout()), this, SLOT(slot_rerun()));
+
     menuBar->addMenu(fileMenu);
+    menuBar->addMenu(viewMenu);
     connect(exitAction, SIGNAL (triggered(bool)), QApplication::instance(), SLOT (quit()));
+    connect(debugAction, SIGNAL (toggled(bool)), this, SLOT (slot_debug_toggled(bool)));
 }
 
 void MainWindow::create_combo_menu_box()
@@ -61,23 +103,9 @@ void MainWindow::create_combo_menu_box()
     combo_menu_box = new QGroupBox(tr("Model:"));
     QVBoxLayout *layout = new QVBoxLayout;
 
-    action_um = new QAction(this);
-    action_um->setText("Usher-McClelland model");
-    action_pratt = new QAction(this);
-    action_pratt->setText("Simplified Pratt model");
-    action_indirect_britton = new QAction(this);
-    action_indirect_britton->setText("Simplified indirect Britton model");
-    action_direct_britton = new QAction(this);
-    action_direct_britton->setText("Simplified direct Britton model");
-    action_gaze = new QAction(this);
-    action_gaze->setText("Gaze model");
-
+    /* the models in model_t order, so the index is the model */
     combo_menu = new QComboBox(this);
-    combo_menu->addItem(action_um->text(), QVariant::fromValue(action_um));
-    combo_menu->addItem(action_pratt->text(), QVariant::fromValue(action_pratt));
-    combo_menu->addItem(action_indirect_britton->text(), QVariant::fromValue(action_indirect_britton));
-    combo_menu->addItem(action_direct_britton->text(), QVariant::fromValue(action_direct_britton));
-    combo_menu->addItem(action_gaze->text(), QVariant::fromValue(action_gaze));
+    for (int m=0; m<MODEL_COUNT; m++) combo_menu->addItem(model_long_name((model_t)m));
 
     layout->addWidget(combo_menu);
     combo_menu_box->setLayout(layout);
@@ -102,7 +130,52 @@ void MainWindow::create_action_box()
 
     /* wire the signals */
     connect(m_button_quit, SIGNAL (clicked()), QApplication::instance(), SLOT (quit()));
-    connect(m_button_go, SIGNAL(clicked(bool)), this, SLOT(slot_go_um()));
+    connect(m_button_go, SIGNAL(clicked(bool)), this, SLOT(slot_go()));
+}
+
+void MainWindow::create_debug_box()
+{
+    debug_box = new QGroupBox(tr("Result cache:"));
+    QHBoxLayout *layout = new QHBoxLayout;
+
+    debug_cache_label = new QLabel;
+    m_button_clear_cache = new QPushButton("clear", this);
+
+    layout->addWidget(debug_cache_label, 1);
+    layout->addWidget(m_button_clear_cache);
+    debug_box->setLayout(layout);
+    debug_box->setVisible(false);
+    update_debug_box();
+
+    /* wire the signals */
+    connect(m_button_clear_cache, SIGNAL(clicked(bool)), this, SLOT(slot_clear_cache()));
+}
+
+void MainWindow::update_debug_box()
+{
+    result_cache_stats_t stats;
+    result_cache_get_stats(result_cache, &stats);
+    debug_cache_label->setText(QString("%1 runs, %2 of %3 MiB | %4 hits, %5 misses, %6 evicted")
+                               .arg(stats.entries)
+                               .arg(stats.bytes / 1048576.0, 0, 'f', 1)
+                               .arg(stats.max_bytes / 1048576.0, 0, 'f', 0)
+                               .arg(stats.hits)
+                               .arg(stats.misses)
+                               .arg(stats.evictions));
+}
+
+void MainWindow::create_runs_box()
+{
+    runs_box = new QGroupBox(tr("Running:"));
+    runs_layout = new QVBoxLayout;
+    runs_box->setLayout(runs_layout);
+    runs_box->setVisible(false);
+
+    progress_timer = new QTimer(this);
+    progress_timer->setInterval(FRAME_INTERVAL);
+
+    /* wire the signals */
+    connect(progress_timer, SIGNAL(timeout()), this, SLOT(slot_update_progress()));
 }
 
 void MainWindow::create_model_box()
@@ -120,6 +193,16 @@ void MainWindow::create_model_box()
     model_box->addWidget(model_box_indirect_britton);
     model_box->addWidget(model_box_direct_britton);
     model_box->addWidget(model_box_gaze);
+
+    /* any edit may rerun the model (the spin boxes set the parameters through their own slots first) */
+    QList<QDoubleSpinBox *> double_boxes = model_box->findChildren<QDoubleSpinBox *>();
+    for (int i=0; i<double_boxes.size(); i++) {
+        connect(double_boxes[i], SIGNAL(valueChanged(double)), this, SLOT(slot_params_edited()));
+    }
+    QList<QSpinBox *> int_boxes = model_box->findChildren<QSpinBox *>();
+    for (int i=0; i<int_boxes.size(); i++) {
+        connect(int_boxes[i], SIGNAL(valueChanged(int)), this, SLOT(slot_params_edited()));
+    }
 }
 
 /**************************************************************
@@ -1207,61 +1290,236 @@ void MainWindow::slot_g_g_std_dev_changed(double v) {
  *
  **************************************************************/
 
-void MainWindow::slot_go_um() {
-    ChartUM *chart = new ChartUM(&params_um);
-    chart->show();
+void MainWindow::start_run(model_t m, const void *params)
+{
+    SimulationRunPtr cached = cached_run(m, params);
+    if (!cached.isNull()) {
+        show_chart(cached, cached->length());
+        update_debug_box();
+        return;
+    }
+
+    /* a row for the run: what it is, how far it has got, and a way to stop it */
+    run_row_t run;
+    SimulationRunPtr sim = create_run(m, params, nullptr);
+    run.job = new SimulationJob(sim, this);
+    run.row = new QWidget;
+    QHBoxLayout *layout = new QHBoxLayout;
+    layout->setContentsMargins(0, 0, 0, 0);
+    run.bar = new QProgressBar;
+    run.bar->setRange(0, sim->length());
+    run.bar->setValue(0);
+    QPushButton *cancel = new QPushButton("cancel", run.row);
+    layout->addWidget(new QLabel(model_long_name(m)));
+    layout->addWidget(run.bar, 1);
+    layout->addWidget(cancel);
+    run.row->setLayout(layout);
+    runs_layout->addWidget(run.row);
+    run.charted = sim->resumed();
+    run.live = liveAction->isChecked();
+    if (run.live) run.chart = show_chart(sim, run.charted);
+    runs.append(run);
+    runs_box->setVisible(true);
+    progress_timer->start();
+
+    /* wire the signals */
+    connect(cancel, SIGNAL(clicked(bool)), run.job, SLOT(cancel()));
+    connect(run.job, SIGNAL(finished()), this, SLOT(slot_run_finished()), Qt::QueuedConnection);
+
+    QThreadPool::globalInstance()->start(run.job);
 }
 
-void MainWindow::slot_go_pratt() {
-    ChartPratt *chart = new ChartPratt(&params_pratt);
+ChartModel *MainWindow::show_chart(SimulationRunPtr run, int available)
+{
+    model_t m = run->model();
+    ChartModel *chart = chart_create(run, available);
+    if (chart == nullptr) return nullptr;
     chart->show();
+    last_chart[m] = chart;
+    chart_hash[m] = model_params_hash(m, METHOD_RK4, run->params());
+    return chart;
 }
 
-void MainWindow::slot_go_indirect_britton() {
-    ChartIndirectBritton *chart = new ChartIndirectBritton(&params_indirect_britton);
-    chart->show();
+void MainWindow::set_chart(ChartModel *chart, SimulationRunPtr run, int available)
+{
+    chart->set_results(run, available);
+    chart_hash[run->model()] = model_params_hash(run->model(), METHOD_RK4, run->params());
 }
 
-void MainWindow::slot_go_direct_britton() {
-    ChartDirectBritton *chart = new ChartDirectBritton(&params_direct_britton);
-    chart->show();
+void MainWindow::extend_chart(ChartModel *chart, SimulationRunPtr run, int available)
+{
+    chart->extend_results(run, available);
+    chart_hash[run->model()] = model_params_hash(run->model(), METHOD_RK4, run->params());
 }
 
-void MainWindow::slot_go_gaze() {
-    ChartGaze *chart = new ChartGaze(&params_gaze);
-    chart->show();
+QSharedPointer<run_noise_t> MainWindow::noise_for(model_t m, const void *params)
+{
+    if (!noise.isNull() && run_noise_matches(noise.data(), m, params)) return noise;
+    if (run_noise_size(m, params) > NOISE_BYTES) return QSharedPointer<run_noise_t>();
+    return QSharedPointer<run_noise_t>(run_noise_extend(noise.data(), m, params), run_noise_destroy);
+}
+
+SimulationRunPtr MainWindow::create_run(model_t m, const void *params, uint64_t *resumed_hash)
+{
+    SimulationRunPtr run(new SimulationRun(m, METHOD_RK4, params, noise_for(m, params)));
+
+    /* a longer d only adds steps to the end: the run goes on from the shorter one */
+    int d;
+    const double *start_y1, *start_y2;
+    int count = result_cache_lookup_shorter(result_cache, m, METHOD_RK4, params, &d, &start_y1, &start_y2);
+    if (count > 0) {
+        run->resume_from(start_y1, start_y2, count);
+        if (resumed_hash != nullptr) {
+            std::vector<char> shorter((const char *)params, (const char *)params + model_params_size(m));
+            model_set_param_value(m, shorter.data(), "d", d);
+            *resumed_hash = model_params_hash(m, METHOD_RK4, shorter.data());
+        }
+    }
+    return run;
+}
+
+SimulationRunPtr MainWindow::cached_run(model_t m, const void *params)
+{
+    const double *results_y1, *results_y2;
+    int length = result_cache_lookup(result_cache, m, METHOD_RK4, params, &results_y1, &results_y2);
+    if (length == 0) return SimulationRunPtr();
+
+    /* a run already done: all of it given to start with */
+    SimulationRunPtr run(new SimulationRun(m, METHOD_RK4, params, QSharedPointer<run_noise_t>()));
+    run->resume_from(results_y1, results_y2, length);
+    return run;
+}
+
+void MainWindow::slot_go()
+{
+    model_t m = (model_t)combo_menu->currentIndex();
+    if ((unsigned)m < MODEL_COUNT) start_run(m, params_of[m]);
 }
 
 void MainWindow::slot_model_changed(int index)
 {
-    switch (index) {
-        case MODEL_UM:
-            model_box->setCurrentWidget(model_box_um);
-            disconnect(m_button_go, SIGNAL(clicked(bool)), 0, 0);
-            connect(m_button_go, SIGNAL(clicked(bool)), this, SLOT(slot_go_um()));
+    /* the boxes are stacked in model_t order too */
+    model_box->setCurrentIndex(index);
+}
+
+void MainWindow::slot_debug_toggled(bool checked)
+{
+    debug_box->setVisible(checked);
+}
+
+void MainWindow::slot_clear_cache()
+{
+    result_cache_clear(result_cache);
+    update_debug_box();
+}
+
+void MainWindow::slot_run_finished()
+{
+    SimulationJob *job = qobject_cast<SimulationJob *>(sender());
+    SimulationRunPtr sim = job->simulation();
+    ChartModel *chart = nullptr;
+    bool live = false;
+    int charted = 0;
+    for (int i=0; i<runs.size(); i++) {
+        if (runs[i].job != job) continue;
+        chart = runs[i].chart.data();
+        live = runs[i].live;
+        charted = runs[i].charted;
+        delete runs[i].row;
+        runs.removeAt(i);
         break;
-        case MODEL_PRATT:
-            model_box->setCurrentWidget(model_box_pratt);
-            disconnect(m_button_go, SIGNAL(clicked(bool)), 0, 0);
-            connect(m_button_go, SIGNAL(clicked(bool)), this, SLOT(slot_go_pratt()));
-            break;
-        case MODEL_INDIRECT_BRITTON:
-            model_box->setCurrentWidget(model_box_indirect_britton);
-            disconnect(m_button_go, SIGNAL(clicked(bool)), 0, 0);
-            connect(m_button_go, SIGNAL(clicked(bool)), this, SLOT(slot_go_indirect_britton()));
-            break;
-        case MODEL_DIRECT_BRITTON:
-            model_box->setCurrentWidget(model_box_direct_britton);
-            disconnect(m_button_go, SIGNAL(clicked(bool)), 0, 0);
-            connect(m_button_go, SIGNAL(clicked(bool)), this, SLOT(slot_go_direct_britton()));
-            break;
-        case MODEL_GAZE:
-            model_box->setCurrentWidget(model_box_gaze);
-            disconnect(m_button_go, SIGNAL(clicked(bool)), 0, 0);
-            connect(m_button_go, SIGNAL(clicked(bool)), this, SLOT(slot_go_gaze()));
-            break;
-        default:
-            // TODO: Handle this in GUI
-            std::cout << "Unknown model" << std::endl;
     }
+    if (runs.isEmpty()) {
+        progress_timer->stop();
+        runs_box->setVisible(false);
+    }
+
+    /* a live chart gets the rest of the run, or of as much as ran before it was cancelled */
+    if (chart != nullptr) chart->append_results(charted, sim->steps_done());
+    if (chart != nullptr && sim->cancelled() && chart == last_chart[sim->model()]) chart_hash[sim->model()] = 0;
+
+    /* the results go to the cache, and the noise is kept for reruns */
+    if (!sim->cancelled()) {
+        result_cache_insert(result_cache, sim->model(), sim->method(), sim->params(), sim->y1(), sim->y2(), sim->length());
+        if (!live) show_chart(sim, sim->length());
+        if (!sim->noise().isNull()) noise = sim->noise();
+        update_debug_box();
+    }
+    job->deleteLater();
+
+    /* edits made while it ran are charted now */
+    if (autoAction->isChecked()) rerun_timer->start();
+}
+
+void MainWindow::slot_update_progress()
+{
+    for (int i=0; i<runs.size(); i++) {
+        run_row_t &run = runs[i];
+        SimulationRunPtr sim = run.job->simulation();
+        int steps = sim->steps_done();
+        run.bar->setValue(steps);
+
+        /* a closed chart is gone, and no longer fed */
+        if (!run.chart.isNull() && steps > run.charted) {
+            run.chart->append_results(run.charted, steps);
+            run.charted = steps;
+        }
+    }
+}
+
+void MainWindow::slot_params_edited()
+{
+    if (autoAction->isChecked()) rerun_timer->start();
+}
+
+void MainWindow::slot_rerun()
+{
+    model_t m = (model_t)combo_menu->currentIndex();
+    const void *params = (unsigned)m < MODEL_COUNT ? params_of[m] : nullptr;
+    ChartModel *chart = params != nullptr ? last_chart[m].data() : nullptr;
+    if (chart == nullptr) return;
+
+    /* a chart still fed by a run is left to it: its end starts the timer again */
+    for (int i=0; i<runs.size(); i++) {
+        if (runs[i].chart == chart) return;
+    }
+
+    SimulationRunPtr cached = cached_run(m, params);
+    if (!cached.isNull()) {
+        if (rerun_job != nullptr) rerun_job->cancel();
+        rerun_job = nullptr;
+        set_chart(chart, cached, cached->length());
+        update_debug_box();
+        return;
+    }
+
+    /* only the latest edit matters: the rerun before it stops where it is */
+    if (rerun_job != nullptr) rerun_job->cancel();
+    rerun_from = 0;
+    rerun_job = new SimulationJob(create_run(m, params, &rerun_from), this);
+    connect(rerun_job, SIGNAL(finished()), this, SLOT(slot_rerun_finished()), Qt::QueuedConnection);
+    QThreadPool::globalInstance()->start(rerun_job);
+}
+
+void MainWindow::slot_rerun_finished()
+{
+    SimulationJob *job = qobject_cast<SimulationJob *>(sender());
+    SimulationRunPtr sim = job->simulation();
+    bool current = job == rerun_job;
+    if (current) rerun_job = nullptr;
+
+    /* a rerun overtaken by another edit still goes to the cache, but not to the chart */
+    if (!sim->cancelled()) {
+        model_t m = sim->model();
+        result_cache_insert(result_cache, m, sim->method(), sim->params(), sim->y1(), sim->y2(), sim->length());
+        if (!sim->noise().isNull()) noise = sim->noise();
+        ChartModel *chart = last_chart[m].data();
+        if (current && chart != nullptr) {
+            /* a chart showing the run this one went on from only needs the new steps */
+            if (rerun_from != 0 && rerun_from == chart_hash[m]) extend_chart(chart, sim, sim->length());
+            else set_chart(chart, sim, sim->length());
+        }
+        update_debug_box();
+    }
+    job->deleteLater();
 }
@@ -7,23 +7,35 @@
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QList>
 #include <QMenuBar>
+#include <QPointer>
+#include <QProgressBar>
 #include <QPushButton>
+#include <QSharedPointer>
 #include <QStackedWidget>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
-#include "models.h"
+#include "chart_model.h"
+#include "result_cache.h"
+#include "simulation.h"
+#include "simulation_job.h"
 
 class MainWindow : public QWidget
 {
     Q_OBJECT
 public:
     explicit MainWindow(QWidget *parent = 0);
+    ~MainWindow();
 
 private:
     void create_menu_bar();         /* dropdown menu */
     void create_combo_menu_box();   /* select which model to use */
     void create_action_box();       /* for graph and exit buttons */
+    void create_debug_box();        /* result cache statistics, hidden until asked for */
+    void update_debug_box();
+    void create_runs_box();         /* runs in progress, hidden while there are none */
     void create_model_box();
     void create_model_box_um();
     void create_model_box_pratt();
@@ -31,25 +43,68 @@ private:
     void create_model_box_direct_britton();
     void create_model_box_gaze();
 
+    /* chart a model from the cache, or start a run of it that charts it as it goes or when done */
+    void start_run(model_t m, const void *params);
+    ChartModel *show_chart(SimulationRunPtr run, int available);
+    void set_chart(ChartModel *chart, SimulationRunPtr run, int available);
+    void extend_chart(ChartModel *chart, SimulationRunPtr run, int available);
+
+    /* the noise a run of m with params should draw into or reuse, null if too large to keep */
+    QSharedPointer<run_noise_t> noise_for(model_t m, const void *params);
+
+    /* a run of m with params, taking up a cached run of it with a shorter d if there is one, whose hash is then set */
+    SimulationRunPtr create_run(model_t m, const void *params, uint64_t *resumed_hash);
+
+    /* the cached run of m with params, null if there is none */
+    SimulationRunPtr cached_run(model_t m, const void *params);
+
     /* window component: menu bar */
     QMenuBar *menuBar;  /* note: apparently on mac/osx the quit action always defaults to the name of the program */
     QMenu *fileMenu;
     QAction *exitAction;
+    QMenu *viewMenu;
+    QAction *debugAction;
+    QAction *liveAction;    /* chart runs as they go, not only when done */
+    QAction *autoAction;    /* run the model again as its parameters are edited */
 
-    /* window component: combo menu box for selecting model */
-    enum {MODEL_UM = 0, MODEL_PRATT, MODEL_INDIRECT_BRITTON, MODEL_DIRECT_BRITTON, MODEL_GAZE};
+    /* window component: combo menu box for selecting model (indexed by model_t) */
     QGroupBox *combo_menu_box;
     QComboBox *combo_menu;
-    QAction *action_um;
-    QAction *action_pratt;
-    QAction *action_indirect_britton;
-    QAction *action_direct_britton;
-    QAction *action_gaze;
 
     /* window component: button box for actions such as graph or quit */
     QGroupBox *action_box;
 
-    /* window component: stacked widget to hold the boxes for each model */
+    /* window component: debug panel */
+    QGroupBox *debug_box;
+    QLabel *debug_cache_label;
+    QPushButton *m_button_clear_cache;
+
+    /* window component: runs in progress, a progress bar and cancel button each */
+    typedef struct run_row_s {
+        SimulationJob *job;
+        QWidget *row;
+        QProgressBar *bar;
+        bool live;          /* charted as it goes */
+        QPointer<ChartModel> chart; /* the live chart, null if none or closed */
+        int charted;        /* results given to it so far */
+    } run_row_t;
+    QGroupBox *runs_box;
+    QVBoxLayout *runs_layout;
+    QList<run_row_t> runs;
+    QTimer *progress_timer;     /* updates the progress bars and live charts while anything runs */
+
+    /* runs already done, so an unchanged model is charted without running it again */
+    result_cache_t *result_cache;
+
+    /* auto rerun: edits restart the timer, so a model runs once they pause, into its last chart */
+    QTimer *rerun_timer;
+    QPointer<ChartModel> last_chart[MODEL_COUNT];
+    uint64_t chart_hash[MODEL_COUNT];   /* model_params_hash of the whole run last_chart shows, 0 if none */
+    SimulationJob *rerun_job;           /* the rerun going, null if none */
+    uint64_t rerun_from;                /* the hash of the run it goes on from, 0 if it starts afresh */
+    QSharedPointer<run_noise_t> noise;  /* the noise of the last run, kept while only other parameters change */
+
+    /* window component: stacked widget to hold the boxes for each model, in model_t order */
     QStackedWidget *model_box;
     /* the boxes */
     QGroupBox *model_box_um;    /* the um model box */
@@ -64,6 +119,7 @@ private:
     params_indirect_britton_t params_indirect_britton;
     params_direct_britton_t params_direct_britton;
     params_gaze_t params_gaze;
+    void *params_of[MODEL_COUNT];   /* the params struct of each model, for the code that takes any */
 
     /* buttons */
     /* Q: should these be defined here or in the action box?
@@ -160,13 +216,19 @@ private slots:
     void slot_g_seed_changed(int v);
 
     /* slots for handling the charting of the different models */
-    void slot_go_um();
-    void slot_go_pratt();
-    void slot_go_indirect_britton();
-    void slot_go_direct_britton();
-    void slot_go_gaze();
+    void slot_go();
 
     void slot_model_changed(int);
+
+    void slot_debug_toggled(bool checked);
+    void slot_clear_cache();
+
+    void slot_run_finished();
+    void slot_update_progress();
+
+    void slot_params_edited();
+    void slot_rerun();
+    void slot_rerun_finished();
 };
 
 #endif // MAINWINDOW_H
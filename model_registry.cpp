@@ -0,0 +1,276 @@
+#include "model_registry.h"
+#include "models_batch.h"
+
+#define TABLE_SIZE(t) ((int)(sizeof(t)/sizeof((t)[0])))
+
+/*****************************************************************************
+ *
+ * Parameter tables
+ *
+ *****************************************************************************/
+
+#define PARAM_D(type, field, desc) { #field, PARAM_DOUBLE, offsetof(type, field), desc }
+#define PARAM_I(type, field, desc) { #field, PARAM_INT, offsetof(type, field), desc }
+
+static const param_info_t um_param_info[] = {
+    PARAM_D(params_um_t, h, "step size"),
+    PARAM_I(params_um_t, d, "duration"),
+    PARAM_D(params_um_t, y1_0, "y1 initial condition"),
+    PARAM_D(params_um_t, y2_0, "y2 initial condition"),
+    PARAM_D(params_um_t, I1, "input signal to y1"),
+    PARAM_D(params_um_t, I2, "input signal to y2"),
+    PARAM_D(params_um_t, w1, "weight from y1 to y2"),
+    PARAM_D(params_um_t, w2, "weight from y2 to y1"),
+    PARAM_D(params_um_t, l1, "leak (decay) term for y1"),
+    PARAM_D(params_um_t, l2, "leak (decay) term for y2"),
+    PARAM_D(params_um_t, std_dev, "standard deviation for noise"),
+    PARAM_I(params_um_t, seed, "noise seed"),
+};
+
+static const param_info_t pratt_param_info[] = {
+    PARAM_D(params_pratt_t, h, "step size"),
+    PARAM_I(params_pratt_t, d, "duration"),
+    PARAM_D(params_pratt_t, population, "total population of ants"),
+    PARAM_D(params_pratt_t, y1_0, "nest 1 initial size"),
+    PARAM_D(params_pratt_t, y2_0, "nest 2 initial size"),
+    PARAM_D(params_pratt_t, q1, "quality of nest 1"),
+    PARAM_D(params_pratt_t, q2, "quality of nest 2"),
+    PARAM_D(params_pratt_t, r1, "rate of directly switching from nest 1 to nest 2"),
+    PARAM_D(params_pratt_t, r2, "rate of directly switching from nest 2 to nest 1"),
+    PARAM_D(params_pratt_t, r1_prime, "rate of recruitment from S to nest 1"),
+    PARAM_D(params_pratt_t, r2_prime, "rate of recruitment from S to nest 2"),
+    PARAM_D(params_pratt_t, l1, "rate of leaking to S from nest 1"),
+    PARAM_D(params_pratt_t, l2, "rate of leaking to S from nest 2"),
+    PARAM_D(params_pratt_t, std_dev, "standard deviation for noise"),
+    PARAM_I(params_pratt_t, seed, "noise seed"),
+};
+
+static const param_info_t indirect_britton_param_info[] = {
+    PARAM_D(params_indirect_britton_t, h, "step size"),
+    PARAM_I(params_indirect_britton_t, d, "duration"),
+    PARAM_D(params_indirect_britton_t, population, "total population of ants"),
+    PARAM_D(params_indirect_britton_t, y1_0, "nest 1 initial size"),
+    PARAM_D(params_indirect_britton_t, y2_0, "nest 2 initial size"),
+    PARAM_D(params_indirect_britton_t, q1, "quality of nest 1"),
+    PARAM_D(params_indirect_britton_t, q2, "quality of nest 2"),
+    PARAM_D(params_indirect_britton_t, r1_prime, "rate of recruitment from S to nest 1"),
+    PARAM_D(params_indirect_britton_t, r2_prime, "rate of recruitment from S to nest 2"),
+    PARAM_D(params_indirect_britton_t, l1, "rate of leaking to S from nest 1"),
+    PARAM_D(params_indirect_britton_t, l2, "rate of leaking to S from nest 2"),
+    PARAM_D(params_indirect_britton_t, std_dev, "standard deviation for noise"),
+    PARAM_I(params_indirect_britton_t, seed, "noise seed"),
+};
+
+static const param_info_t direct_britton_param_info[] = {
+    PARAM_D(params_direct_britton_t, h, "step size"),
+    PARAM_I(params_direct_britton_t, d, "duration"),
+    PARAM_D(params_direct_britton_t, population, "total population of ants"),
+    PARAM_D(params_direct_britton_t, y1_0, "nest 1 initial size"),
+    PARAM_D(params_direct_britton_t, y2_0, "nest 2 initial size"),
+    PARAM_D(params_direct_britton_t, q1, "quality of nest 1"),
+    PARAM_D(params_direct_britton_t, q2, "quality of nest 2"),
+    PARAM_D(params_direct_britton_t, r1, "rate of directly switching from nest 1 to nest 2"),
+    PARAM_D(params_direct_britton_t, r2, "rate of directly switching from nest 2 to nest 1"),
+    PARAM_D(params_direct_britton_t, r1_prime, "rate of recruitment from S to nest 1"),
+    PARAM_D(params_direct_britton_t, r2_prime, "rate of recruitment from S to nest 2"),
+    PARAM_D(params_direct_britton_t, l1, "rate of leaking to S from nest 1"),
+    PARAM_D(params_direct_britton_t, l2, "rate of leaking to S from nest 2"),
+    PARAM_D(params_direct_britton_t, std_dev, "standard deviation for noise"),
+    PARAM_I(params_direct_britton_t, seed, "noise seed"),
+};
+
+static const param_info_t gaze_param_info[] = {
+    PARAM_D(params_gaze_t, h, "step size"),
+    PARAM_I(params_gaze_t, d, "duration"),
+    PARAM_D(params_gaze_t, y1_0, "y1 initial condition (priming)"),
+    PARAM_D(params_gaze_t, y2_0, "y2 initial condition (priming)"),
+    PARAM_D(params_gaze_t, I1, "input to y1"),
+    PARAM_D(params_gaze_t, I2, "input to y2"),
+    PARAM_D(params_gaze_t, g, "maximum gaze input"),
+    PARAM_D(params_gaze_t, gaze_start, "start time for gaze"),
+    PARAM_D(params_gaze_t, gaze_end, "end time for gaze"),
+    PARAM_D(params_gaze_t, a, "y-intercept for linear gaze activation"),
+    PARAM_D(params_gaze_t, l1, "decay (leak) for y1"),
+    PARAM_D(params_gaze_t, l2, "decay (leak) for y2"),
+    PARAM_D(params_gaze_t, w1, "inhibition weight from y1 to y2"),
+    PARAM_D(params_gaze_t, w2, "inhibition weight from y2 to y1"),
+    PARAM_D(params_gaze_t, t1, "location of target 1"),
+    PARAM_D(params_gaze_t, t2, "location of target 2"),
+    PARAM_D(params_gaze_t, tg, "location of gaze"),
+    PARAM_D(params_gaze_t, n_std_dev, "standard deviation for noise"),
+    PARAM_D(params_gaze_t, g_std_dev, "standard deviation for gaze"),
+    PARAM_I(params_gaze_t, seed, "noise seed"),
+};
+
+#undef PARAM_D
+#undef PARAM_I
+
+/*****************************************************************************
+ *
+ * Noise channels
+ *
+ *****************************************************************************/
+
+static const char *const um_noise_params[] = {"seed", "h", "std_dev"};
+
+static void um_fill_noise(const void *params, const noise_key_t *key, int first, int length, double *const *noise) {
+    const params_um_t *p = (const params_um_t *)params;
+    um_set_noise(key, first, 0.0, p->std_dev, length, noise[0], noise[1]);
+}
+
+static void um_noise_arrays(void *params, double *const *noise) {
+    params_um_t *p = (params_um_t *)params;
+    p->cn1 = noise[0];
+    p->cn2 = noise[1];
+}
+
+static const char *const pratt_noise_params[] = {"seed", "h", "std_dev"};
+
+static void pratt_fill_noise(const void *params, const noise_key_t *key, int first, int length, double *const *noise) {
+    const params_pratt_t *p = (const params_pratt_t *)params;
+    pratt_set_noise(key, first, 0.0, p->std_dev, length,
+                    noise[0], noise[1], noise[2], noise[3], noise[4], noise[5], noise[6], noise[7]);
+}
+
+static void pratt_noise_arrays(void *params, double *const *noise) {
+    params_pratt_t *p = (params_pratt_t *)params;
+    p->cn_q1 = noise[0];
+    p->cn_q2 = noise[1];
+    p->cn_r1 = noise[2];
+    p->cn_r2 = noise[3];
+    p->cn_r1_prime = noise[4];
+    p->cn_r2_prime = noise[5];
+    p->cn_l1 = noise[6];
+    p->cn_l2 = noise[7];
+}
+
+static const char *const indirect_britton_noise_params[] = {"seed", "h", "std_dev"};
+
+static void indirect_britton_fill_noise(const void *params, const noise_key_t *key, int first, int length, double *const *noise) {
+    const params_indirect_britton_t *p = (const params_indirect_britton_t *)params;
+    indirect_britton_set_noise(key, first, 0.0, p->std_dev, length,
+                               noise[0], noise[1], noise[2], noise[3], noise[4], noise[5]);
+}
+
+static void indirect_britton_noise_arrays(void *params, double *const *noise) {
+    params_indirect_britton_t *p = (params_indirect_britton_t *)params;
+    p->cn_q1 = noise[0];
+    p->cn_q2 = noise[1];
+    p->cn_r1_prime = noise[2];
+    p->cn_r2_prime = noise[3];
+    p->cn_l1 = noise[4];
+    p->cn_l2 = noise[5];
+}
+
+static const char *const direct_britton_noise_params[] = {"seed", "h", "std_dev"};
+
+static void direct_britton_fill_noise(const void *params, const noise_key_t *key, int first, int length, double *const *noise) {
+    const params_direct_britton_t *p = (const params_direct_britton_t *)params;
+    direct_britton_set_noise(key, first, 0.0, p->std_dev, length,
+                             noise[0], noise[1], noise[2], noise[3], noise[4], noise[5], noise[6], noise[7]);
+}
+
+static void direct_britton_noise_arrays(void *params, double *const *noise) {
+    params_direct_britton_t *p = (params_direct_britton_t *)params;
+    p->cn_q1 = noise[0];
+    p->cn_q2 = noise[1];
+    p->cn_r1 = noise[2];
+    p->cn_r2 = noise[3];
+    p->cn_r1_prime = noise[4];
+    p->cn_r2_prime = noise[5];
+    p->cn_l1 = noise[6];
+    p->cn_l2 = noise[7];
+}
+
+static const char *const gaze_noise_params[] = {"seed", "h", "n_std_dev", "g_std_dev"};
+
+static void gaze_fill_noise(const void *params, const noise_key_t *key, int first, int length, double *const *noise) {
+    const params_gaze_t *p = (const params_gaze_t *)params;
+    gaze_set_noise(key, first, 0.0, p->n_std_dev, p->g_std_dev, length,
+                   noise[0], noise[1], noise[2], noise[3], noise[4], noise[5], noise[6], noise[7], noise[8]);
+}
+
+static void gaze_noise_arrays(void *params, double *const *noise) {
+    params_gaze_t *p = (params_gaze_t *)params;
+    p->n_I1 = noise[0];
+    p->n_I2 = noise[1];
+    p->n_w1 = noise[2];
+    p->n_w2 = noise[3];
+    p->n_g1 = noise[4];
+    p->n_g2 = noise[5];
+    p->n_l1 = noise[6];
+    p->n_l2 = noise[7];
+    p->n_gaze = noise[8];
+}
+
+/*****************************************************************************
+ *
+ * Kernels
+ *
+ * The typed kernels of models.h and models_batch.h behind the void pointer
+ * signatures of model_desc_t: defaults names the *_set_defaults function,
+ * kernels the rest, type the params struct.
+ *
+ *****************************************************************************/
+
+#define MODEL_KERNELS(defaults, kernels, type) \
+    static void defaults##_desc_set_defaults(void *params) { \
+        defaults##_set_defaults((type *)params); \
+    } \
+    static void defaults##_desc_rk4_steps(void *params, int first, int count, double *results_y1, double *results_y2) { \
+        kernels##_rk4_steps((type *)params, first, count, results_y1, results_y2); \
+    } \
+    static void defaults##_desc_rk4_streamed(const void *params, const noise_key_t *key, double *results_y1, double *results_y2) { \
+        kernels##_rk4_streamed((const type *)params, key, results_y1, results_y2); \
+    } \
+    static void defaults##_desc_integrate_until(const void *params, method_t method, const noise_key_t *key, const boundary_t *boundary, \
+                                                double *results_y1, double *results_y2, decision_t *decision) { \
+        kernels##_integrate_until((const type *)params, method, key, boundary, results_y1, results_y2, decision); \
+    } \
+    static void defaults##_desc_adaptive(const void *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats) { \
+        kernels##_adaptive((const type *)params, tol, results_y1, results_y2, stats); \
+    } \
+    static void defaults##_desc_jacobian(const void *params, double y1, double y2, double f[2], double jac[2][2]) { \
+        kernels##_jacobian((const type *)params, y1, y2, f, jac); \
+    } \
+    static void defaults##_desc_rk4_batch_steps(const void *params, int n, int first, int count, const double *const *noise, \
+                                                double *results_y1, double *results_y2) { \
+        kernels##_rk4_batch_steps((const type *)params, n, first, count, noise, results_y1, results_y2); \
+    }
+
+MODEL_KERNELS(um, usher_mcclelland, params_um_t)
+MODEL_KERNELS(pratt, pratt, params_pratt_t)
+MODEL_KERNELS(indirect_britton, indirect_britton, params_indirect_britton_t)
+MODEL_KERNELS(direct_britton, direct_britton, params_direct_britton_t)
+MODEL_KERNELS(gaze, gaze, params_gaze_t)
+
+#undef MODEL_KERNELS
+
+/*****************************************************************************
+ *
+ * Registry
+ *
+ *****************************************************************************/
+
+#define MODEL_DESC(defaults, type, name, long_name, channels) { \
+    name, long_name, sizeof(type), defaults##_param_info, TABLE_SIZE(defaults##_param_info), 2, channels, \
+    defaults##_noise_params, TABLE_SIZE(defaults##_noise_params), \
+    defaults##_desc_set_defaults, defaults##_fill_noise, defaults##_noise_arrays, \
+    defaults##_desc_rk4_steps, defaults##_desc_rk4_streamed, defaults##_desc_integrate_until, \
+    defaults##_desc_adaptive, defaults##_desc_jacobian, defaults##_desc_rk4_batch_steps }
+
+/* in model_t order */
+static const model_desc_t model_descs[MODEL_COUNT] = {
+    MODEL_DESC(um, params_um_t, "um", "Usher-McClelland model", 2),
+    MODEL_DESC(pratt, params_pratt_t, "pratt", "Simplified Pratt model", 8),
+    MODEL_DESC(indirect_britton, params_indirect_britton_t, "indirect_britton", "Simplified indirect Britton model", 6),
+    MODEL_DESC(direct_britton, params_direct_britton_t, "direct_britton", "Simplified direct Britton model", 8),
+    MODEL_DESC(gaze, params_gaze_t, "gaze", "Gaze model", 9),
+};
+
+#undef MODEL_DESC
+
+const model_desc_t *model_desc(model_t m) {
+    if ((unsigned)m >= MODEL_COUNT) return nullptr;
+    return &model_descs[m];
+}
@@ -0,0 +1,66 @@
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include "simulation.h"
+
+/*
+ * Everything the rest of the code needs to know about a model, in one
+ * place: its names, its parameter table and params struct, its noise
+ * channels and the kernels that run it, each taking the params struct as
+ * a void pointer. The model_* functions of simulation.h, the batch engine
+ * (models_batch.h) and so the ensembles, sweeps, fits, caches and the GUI
+ * run any model through its descriptor, so adding one takes its kernels
+ * in models.cpp, a descriptor here and its MODEL_ enum value.
+ *
+ * The state is two variables throughout (y1, y2: the results arrays, the
+ * trajectory file format and the boundaries all assume it), recorded as
+ * dimension for what is to come.
+ */
+
+/* most parameters any model's noise depends on */
+#define MODEL_MAX_NOISE_PARAMS 4
+
+typedef struct model_desc_s {
+    const char *name;               /* short name, as used on the command line */
+    const char *long_name;
+    size_t params_size;             /* sizeof the params struct */
+    const param_info_t *param_info; /* user settable parameters; every model has h, d, y1_0, y2_0 and seed */
+    int param_count;
+    int dimension;                  /* state variables */
+    int noise_channels;             /* noise arrays read each step, in *_set_noise order */
+    const char *const *noise_params;    /* the parameters the noise drawn depends on; d only sets how much */
+    int noise_param_count;          /* at most MODEL_MAX_NOISE_PARAMS */
+
+    void (*set_defaults)(void *params);
+
+    /* steps first .. first+length-1 of a trajectory's noise into the channels (see model_fill_noise) */
+    void (*fill_noise)(const void *params, const noise_key_t *key, int first, int length, double *const *noise);
+
+    /* point the noise arrays of params at noise[0 ..], in *_set_noise order */
+    void (*set_noise_arrays)(void *params, double *const *noise);
+
+    /* the rk4 kernel over steps first .. first+count-1, reading the noise arrays of params */
+    void (*rk4_steps)(void *params, int first, int count, double *results_y1, double *results_y2);
+
+    /* the whole rk4 run, drawing the noise as it goes */
+    void (*rk4_streamed)(const void *params, const noise_key_t *key, double *results_y1, double *results_y2);
+
+    /* any method, stopping at a boundary if given (see *_integrate_until) */
+    void (*integrate_until)(const void *params, method_t method, const noise_key_t *key, const boundary_t *boundary,
+                            double *results_y1, double *results_y2, decision_t *decision);
+
+    /* the noise-free model with adaptive steps */
+    void (*adaptive)(const void *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats);
+
+    /* the noise-free right-hand side at (y1, y2) and its Jacobian */
+    void (*jacobian)(const void *params, double y1, double y2, double f[2], double jac[2][2]);
+
+    /* n trials in lock step, interleaved by trial (see *_rk4_batch_steps in models_batch.h) */
+    void (*rk4_batch_steps)(const void *params, int n, int first, int count, const double *const *noise,
+                            double *results_y1, double *results_y2);
+} model_desc_t;
+
+/* the descriptor of a model, null for one out of range */
+const model_desc_t *model_desc(model_t m);
+
+#endif // MODEL_REGISTRY_H
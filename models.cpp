@@ -1,4 +1,86 @@
+#include <cstring>
 #include "models.h"
+#include "stepper.h"
+#include "adaptive.h"
+#include "sde.h"
+#include "ou.h"
+
+/*
+ * steps of noise generated at a time by the streamed integrators: at most
+ * nine channels of 256 doubles, 18 KiB, which stays in a 32 KiB L1 cache
+ */
+#define NOISE_BLOCK 256
+
+void adaptive_default_tol(adaptive_tol_t *tol) {
+    tol->rtol = 1e-6;
+    tol->atol = 1e-6;
+    tol->min_step = 0.0;
+}
+
+/* the tolerances to use, the defaults (held in `defaults`) if tol is null; clears stats */
+static const adaptive_tol_t *adaptive_setup(const adaptive_tol_t *tol, adaptive_tol_t *defaults, adaptive_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (tol != nullptr) return tol;
+    adaptive_default_tol(defaults);
+    return defaults;
+}
+
+/* signed distances of each side from the boundary, >= 0 once it has crossed */
+static inline void boundary_distance(const boundary_t *boundary, double level, double y1, double y2, double *g1, double *g2) {
+    if (boundary->kind == BOUNDARY_DIFFERENCE) {
+        *g1 = (y1 - y2) - level;
+        *g2 = (y2 - y1) - level;
+    } else {
+        *g1 = y1 - level;
+        *g2 = y2 - level;
+    }
+}
+
+int boundary_scan(const boundary_t *boundary, double h, int from, int to, const double *results_y1, const double *results_y2, int stride, decision_t *decision) {
+    return boundary_scan_block(boundary, h, 0, from, to, results_y1, results_y2, stride, decision);
+}
+
+int boundary_scan_block(const boundary_t *boundary, double h, int first, int from, int to,
+                        const double *results_y1, const double *results_y2, int stride, decision_t *decision) {
+    double level = boundary->kind == BOUNDARY_QUORUM ? boundary->threshold * boundary->population : boundary->threshold;
+    for (int i=from; i<=to; i++) {
+        double g1, g2;
+        size_t row = (size_t)(i-first)*stride;
+        boundary_distance(boundary, level, results_y1[row], results_y2[row], &g1, &g2);
+        if (g1 < 0.0 && g2 < 0.0) continue;
+
+        decision->choice = g1 >= g2 ? 1 : 2;
+        decision->time = i * h;
+        decision->steps = i + 1;
+        if (i > 0) {
+            /* linear interpolation of the crossing side's distance */
+            double p1, p2;
+            boundary_distance(boundary, level, results_y1[row-stride], results_y2[row-stride], &p1, &p2);
+            double g = decision->choice == 1 ? g1 : g2;
+            double prev = decision->choice == 1 ? p1 : p2;
+            if (prev < 0.0) decision->time = ((i - 1) + prev / (prev - g)) * h;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* after steps first .. first+count-1 of a run: has it crossed its boundary? */
+static inline bool boundary_reached(const boundary_t *boundary, double h, int first, int count,
+                                    const double *results_y1, const double *results_y2, decision_t *decision) {
+    if (boundary == nullptr || boundary->kind == BOUNDARY_NONE) return false;
+    if (boundary_scan(boundary, h, first == 0 ? 0 : first + 1, first + count, results_y1, results_y2, 1, decision) == 0) return false;
+    decision->written = first + count + 1;
+    return true;
+}
+
+/* no crossing yet: the whole run */
+static inline void decision_clear(decision_t *decision, int length) {
+    decision->choice = 0;
+    decision->time = -1.;
+    decision->steps = length;
+    decision->written = length;
+}
 
 /*****************************************************************************
  *
@@ -25,14 +107,31 @@ void um_set_defaults(params_um_t *p) {
 }
 
 /* Fill the noise arrays for the UM model */
-void um_set_noise(std::default_random_engine *g, double mean, double std_dev, int length, double *cn1, double *cn2) {
-    std::normal_distribution<double> distribution(mean,std_dev);
-    for (int i=0; i<length; i++) {
-        cn1[i] = distribution(*g);
-        cn2[i] = distribution(*g);
-    }
+void um_set_noise(const noise_key_t *key, int first, double mean, double std_dev, int length, double *cn1, double *cn2) {
+    rng_normal_block(key, 0, first, length, mean, std_dev, cn1);
+    rng_normal_block(key, 1, first, length, mean, std_dev, cn2);
 }
 
+/* right-hand side of the UM model for stepper.h */
+struct um_rhs_t {
+    const params_um_t *p;
+    int first;      /* step held at index 0 of the noise arrays */
+    double I1, I2;  /* input plus noise, fixed over a step */
+
+    um_rhs_t(const params_um_t *params, int first_step) : p(params), first(first_step) {}
+
+    inline void begin(int i, double, double) {
+        int j = i - first;
+        I1 = p->I1 + p->cn1[j];
+        I2 = p->I2 + p->cn2[j];
+    }
+
+    inline void operator()(double y1, double y2, double *dy1, double *dy2) const {
+        *dy1 = I1 - (p->l1 * y1) - (p->w2 * y2);
+        *dy2 = I2 - (p->l2 * y2) - (p->w1 * y1);
+    }
+};
+
 void usher_mcclelland_eulers(params_um_t *params, double *results_y1, double *results_y2) {
     int length = ceil(params->d/params->h);
 
@@ -40,68 +139,189 @@ void usher_mcclelland_eulers(params_um_t *params, double *results_y1, double *re
     results_y1[0] = params->y1_0;
     results_y2[0] = params->y2_0;
 
-    int i;
-    for (i=0;i<length-1;i++) {
-        double y1_k1 = params->I1
-                + params->cn1[i]
-                - (params->l1 * results_y1[i])
-                - (params->w2 * results_y2[i]);
-        double y2_k1 = params->I2
-                + params->cn2[i]
-                - (params->l2 * results_y2[i])
-                - (params->w1 * results_y1[i]);
-        results_y1[i+1] = results_y1[i] + (y1_k1 * params->h);
-        results_y2[i+1] = results_y2[i] + (y2_k1 * params->h);
-    }
+    um_rhs_t f(params, 0);
+    Stepper<euler_method_t, um_rhs_t>::run(f, params->h, 0, length-1, results_y1, results_y2);
 }
 
-void usher_mcclelland_rk4(params_um_t *params, double * results_y1, double * results_y2) {
+void usher_mcclelland_rk4_steps(params_um_t *params, int first, int count, double *results_y1, double *results_y2) {
+    um_rhs_t f(params, first);
+    Stepper<rk4_method_t, um_rhs_t>::run(f, params->h, first, count, results_y1, results_y2);
+}
 
+void usher_mcclelland_jacobian(const params_um_t *params, double y1, double y2, double f[2], double jac[2][2]) {
+    f[0] = params->I1 - (params->l1 * y1) - (params->w2 * y2);
+    f[1] = params->I2 - (params->l2 * y2) - (params->w1 * y1);
+    jac[0][0] = -params->l1;
+    jac[0][1] = -params->w2;
+    jac[1][0] = -params->w1;
+    jac[1][1] = -params->l2;
+}
+
+void usher_mcclelland_rk4(params_um_t *params, double *results_y1, double *results_y2) {
     int length = ceil(params->d/params->h);
 
     /* set initial conditions */
     results_y1[0] = params->y1_0;
     results_y2[0] = params->y2_0;
 
-    int i;
-    for (i=0;i<length-1;i++) {
-        double y1_k1 = params->I1
-                + params->cn1[i]
-                - (params->l1 * results_y1[i])
-                - (params->w2 * results_y2[i]);
-        double y2_k1 = params->I2
-                + params->cn2[i]
-                - (params->l2 * results_y2[i])
-                - (params->w1 * results_y1[i]);
-        double y1_k2 = params->I1
-                + params->cn1[i]
-                - (params->l1 * (results_y1[i] + (y1_k1 * params->h/2)))
-                - (params->w2 * (results_y2[i] + (y2_k1 * params->h/2)));
-        double y2_k2 = params->I2
-                + params->cn2[i]
-                - (params->l2 * (results_y2[i] + (y2_k1 * params->h/2)))
-                - (params->w1 * (results_y1[i] + (y1_k1 * params->h/2)));
-        double y1_k3 = params->I1
-                + params->cn1[i]
-                - (params->l1 * (results_y1[i] + (y1_k2 * params->h/2)))
-                - (params->w2 * (results_y2[i] + (y2_k2 * params->h/2)));
-        double y2_k3 = params->I2
-                + params->cn2[i]
-                - (params->l2 * (results_y2[i] + (y2_k2 * params->h/2)))
-                - (params->w1 * (results_y1[i] + (y1_k2 * params->h/2)));
-        double y1_k4 = params->I1
-                + params->cn1[i]
-                - (params->l1 * (results_y1[i] + (y1_k3 * params->h)))
-                - (params->w2 * (results_y2[i] + (y2_k3 * params->h)));
-        double y2_k4 = params->I2
-                + params->cn2[i]
-                - (params->l2 * (results_y2[i] + (y2_k3 * params->h)))
-                - (params->w1 * (results_y1[i] + (y1_k3 * params->h)));
-        results_y1[i+1] = results_y1[i] + (((y1_k1 + 2*y1_k2 + 2*y1_k3 + y1_k4)/6)*params->h);
-        results_y2[i+1] = results_y2[i] + (((y2_k1 + 2*y2_k2 + 2*y2_k3 + y2_k4)/6)*params->h);
+    usher_mcclelland_rk4_steps(params, 0, length-1, results_y1, results_y2);
+}
+
+template <class Method>
+static void usher_mcclelland_streamed(const params_um_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    /* a copy of the parameters with the noise arrays pointing at the block buffers */
+    double noise[2][NOISE_BLOCK];
+    params_um_t p = *params;
+    p.cn1 = noise[0];
+    p.cn2 = noise[1];
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        um_set_noise(key,
+                     first,
+                     0.0,
+                     p.std_dev,
+                     count,
+                     p.cn1,
+                     p.cn2);
+        um_rhs_t f(&p, first);
+        Stepper<Method, um_rhs_t>::run(f, p.h, first, count, results_y1, results_y2);
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
     }
 }
 
+void usher_mcclelland_adaptive(const params_um_t *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats) {
+    int length = ceil(params->d/params->h);
+    adaptive_tol_t defaults;
+    adaptive_stats_t local_stats;
+    if (stats == nullptr) stats = &local_stats;
+    tol = adaptive_setup(tol, &defaults, stats);
+
+    /* a copy of the parameters with every noise array reading 0 */
+    double zero = 0.0;
+    params_um_t p = *params;
+    p.cn1 = &zero;
+    p.cn2 = &zero;
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    um_rhs_t f(&p, 0);
+    Dopri5<um_rhs_t>(f, 0, tol, stats).run(p.h, length-1, results_y1, results_y2);
+}
+
+template <class Method>
+static void usher_mcclelland_sde(const params_um_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    /* a copy of the parameters reading the noise of the step being taken from w */
+    double w[2];
+    params_um_t p = *params;
+    p.cn1 = &w[0];
+    p.cn2 = &w[1];
+    double sd[2];
+    for (int c=0; c<2; c++) sd[c] = p.std_dev;
+    sde_system_t<um_rhs_t, params_um_t> s = {&p, w, 2, sd};
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    double noise[2][NOISE_BLOCK];
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        um_set_noise(key,
+                     first,
+                     0.0,
+                     p.std_dev,
+                     count,
+                     noise[0],
+                     noise[1]);
+        SdeStepper<Method, sde_system_t<um_rhs_t, params_um_t> >::run(s, p.h, first, count, noise[0], NOISE_BLOCK, results_y1, results_y2);
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
+    }
+}
+
+/*
+ * the UM model read as an Ito SDE, as by usher_mcclelland_sde, advanced by
+ * its exact transition: the model is linear, with additive noise
+ */
+static void usher_mcclelland_exact(const params_um_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    double w[2];
+    params_um_t p = *params;
+    p.cn1 = &w[0];
+    p.cn2 = &w[1];
+    double sd[2];
+    for (int c=0; c<2; c++) sd[c] = p.std_dev;
+    sde_system_t<um_rhs_t, params_um_t> s = {&p, w, 2, sd};
+
+    ou_system_t system;
+    ou_transition_t step;
+    ou_linearise(s, 0, &system);
+    ou_transition(&system, p.h, &step);
+
+    /* set initial conditions */
+    double y1 = p.y1_0;
+    double y2 = p.y2_0;
+    results_y1[0] = y1;
+    results_y2[0] = y2;
+
+    double z[2][NOISE_BLOCK];
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        um_set_noise(key,
+                     first,
+                     0.0,
+                     1.0,
+                     count,
+                     z[0],
+                     z[1]);
+        for (int k=0; k<count; k++) {
+            ou_step(&step, z[0][k], z[1][k], &y1, &y2);
+            results_y1[first+k+1] = y1;
+            results_y2[first+k+1] = y2;
+        }
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
+    }
+}
+
+void usher_mcclelland_integrate_until(const params_um_t *params, method_t method, const noise_key_t *key, const boundary_t *boundary,
+                                       double *results_y1, double *results_y2, decision_t *decision) {
+    decision_t local_decision;
+    if (decision == nullptr) decision = &local_decision;
+    decision_clear(decision, ceil(params->d/params->h));
+
+    switch (method) {
+        case METHOD_EULER: usher_mcclelland_streamed<euler_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+        case METHOD_DOPRI5:
+            usher_mcclelland_adaptive(params, nullptr, results_y1, results_y2, nullptr);
+            if (boundary != nullptr && boundary->kind != BOUNDARY_NONE)
+                boundary_scan(boundary, params->h, 0, decision->steps-1, results_y1, results_y2, 1, decision);
+            break;
+        case METHOD_EM:
+        case METHOD_MILSTEIN: usher_mcclelland_sde<em_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+        case METHOD_EXACT: usher_mcclelland_exact(params, key, boundary, results_y1, results_y2, decision); break;
+        default: usher_mcclelland_streamed<rk4_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+    }
+}
+
+void usher_mcclelland_integrate(const params_um_t *params, method_t method, const noise_key_t *key, double *results_y1, double *results_y2) {
+    usher_mcclelland_integrate_until(params, method, key, nullptr, results_y1, results_y2, nullptr);
+}
+
+void usher_mcclelland_rk4_streamed(const params_um_t *params, const noise_key_t *key, double *results_y1, double *results_y2) {
+    usher_mcclelland_integrate(params, METHOD_RK4, key, results_y1, results_y2);
+}
+
 /*****************************************************************************
  *
  * Simplified Pratt Model
@@ -137,7 +357,8 @@ void pratt_set_defaults(params_pratt_t *p) {
 }
 
 /* Fill the noise arrays for the simplified pratt model */
-void pratt_set_noise(std::default_random_engine *g,
+void pratt_set_noise(const noise_key_t *key,
+                     int first,
                      double mean,
                      double std_dev,
                      int length,
@@ -150,18 +371,14 @@ void pratt_set_noise(std::default_random_engine *g,
                      double *cn_l1,
                      double *cn_l2) {
 
-    std::normal_distribution<double> distribution(mean,std_dev);
-
-    for (int i=0; i<length; i++) {
-        cn_q1[i] = distribution(*g);
-        cn_q2[i] = distribution(*g);
-        cn_r1[i] = distribution(*g);
-        cn_r2[i] = distribution(*g);
-        cn_r1_prime[i] = distribution(*g);
-        cn_r2_prime[i] = distribution(*g);
-        cn_l1[i] = distribution(*g);
-        cn_l2[i] = distribution(*g);
-    }
+    rng_normal_block(key, 0, first, length, mean, std_dev, cn_q1);
+    rng_normal_block(key, 1, first, length, mean, std_dev, cn_q2);
+    rng_normal_block(key, 2, first, length, mean, std_dev, cn_r1);
+    rng_normal_block(key, 3, first, length, mean, std_dev, cn_r2);
+    rng_normal_block(key, 4, first, length, mean, std_dev, cn_r1_prime);
+    rng_normal_block(key, 5, first, length, mean, std_dev, cn_r2_prime);
+    rng_normal_block(key, 6, first, length, mean, std_dev, cn_l1);
+    rng_normal_block(key, 7, first, length, mean, std_dev, cn_l2);
 }
 
 /*
@@ -193,79 +410,227 @@ double pratt_s(double total_population, double y1, double y2) {
     else return (total_population-y1-y2);
 }
 
-void pratt_rk4(params_pratt_t *params, double * results_y1, double * results_y2) {
+/* right-hand side of the simplified pratt model for stepper.h */
+struct pratt_rhs_t {
+    const params_pratt_t *p;
+    int first;      /* step held at index 0 of the noise arrays */
+
+    /* fixed over a step: s is taken at the start of the step, rates include their noise */
+    double sq1, sq2, r1_prime, r2_prime, r1, r2, l1, l2;
 
+    pratt_rhs_t(const params_pratt_t *params, int first_step) : p(params), first(first_step) {}
+
+    inline void begin(int i, double y1, double y2) {
+        int j = i - first;
+        double s = pratt_s(p->population, y1, y2);
+        sq1 = s*(p->q1 + p->cn_q1[j]);
+        sq2 = s*(p->q2 + p->cn_q2[j]);
+        r1_prime = pratt_r_prime(s, p->r1_prime, p->cn_r1_prime[j]);
+        r2_prime = pratt_r_prime(s, p->r2_prime, p->cn_r2_prime[j]);
+        r1 = p->r1 + p->cn_r1[j];
+        r2 = p->r2 + p->cn_r2[j];
+        l1 = p->l1 + p->cn_l1[j];
+        l2 = p->l2 + p->cn_l2[j];
+    }
+
+    inline void operator()(double y1, double y2, double *dy1, double *dy2) const {
+        *dy1 = sq1 + (y1 * r1_prime) + (y2 * r2) - (y1 * r1) - (y1 * l1);
+        *dy2 = sq2 + (y2 * r2_prime) + (y1 * r1) - (y2 * r2) - (y2 * l2);
+    }
+};
+
+/*
+ * the simplified pratt model for the adaptive method. recruitment stops
+ * dead when the source empties, so once it outpaces the leak back to the
+ * source the fixed step kernels chatter across s = 0 and an error controlled
+ * step would shrink to nothing there. here, at and past s = 0, recruitment
+ * is instead cut to what leaks back, which holds y1 + y2 at the population:
+ * the limit the fixed step results approach as h shrinks.
+ */
+struct pratt_sliding_rhs_t : pratt_rhs_t {
+    pratt_sliding_rhs_t(const params_pratt_t *params, int first_step) : pratt_rhs_t(params, first_step) {}
+
+    inline void begin(int i, double y1, double y2) {
+        pratt_rhs_t::begin(i, y1, y2);
+        if (p->population - y1 - y2 > 0) return;
+
+        int j = i - first;
+        double rate1 = p->r1_prime + p->cn_r1_prime[j];
+        double rate2 = p->r2_prime + p->cn_r2_prime[j];
+        double inflow = (y1 * rate1) + (y2 * rate2);
+        double outflow = (y1 * l1) + (y2 * l2);
+        double scale = inflow > outflow ? outflow / inflow : 1.0;
+        r1_prime = scale * rate1;
+        r2_prime = scale * rate2;
+    }
+};
+
+void pratt_rk4_steps(params_pratt_t *params, int first, int count, double *results_y1, double *results_y2) {
+    pratt_rhs_t f(params, first);
+    Stepper<rk4_method_t, pratt_rhs_t>::run(f, params->h, first, count, results_y1, results_y2);
+}
+
+void pratt_jacobian(const params_pratt_t *params, double y1, double y2, double f[2], double jac[2][2]) {
+    const params_pratt_t *p = params;
+    double s = p->population - y1 - y2;
+    f[0] = s*p->q1 + (y1 * p->r1_prime) + (y2 * p->r2) - (y1 * p->r1) - (y1 * p->l1);
+    f[1] = s*p->q2 + (y2 * p->r2_prime) + (y1 * p->r1) - (y2 * p->r2) - (y2 * p->l2);
+    jac[0][0] = -p->q1 + p->r1_prime - p->r1 - p->l1;
+    jac[0][1] = -p->q1 + p->r2;
+    jac[1][0] = -p->q2 + p->r1;
+    jac[1][1] = -p->q2 + p->r2_prime - p->r2 - p->l2;
+}
+
+void pratt_rk4(params_pratt_t *params, double *results_y1, double *results_y2) {
     int length = ceil(params->d/params->h);
 
     /* set initial conditions */
     results_y1[0] = params->y1_0;
     results_y2[0] = params->y2_0;
 
-    int i;
-    for (i=0;i<length-1;i++) {
-        double s = pratt_s(params->population, results_y1[i], results_y2[i]);
-        double y1_k1 = (s*(params->q1 + params->cn_q1[i])
-                + (results_y1[i] * pratt_r_prime(s, params->r1_prime, params->cn_r1_prime[i]))
-                //+ (results_y1[i] * results_y2[i] * (params->r2 + params->cn_r2[i]))
-                //- (results_y2[i] * results_y1[i] * (params->r1 + params->cn_r1[i]))
-                + (results_y2[i] * (params->r2 + params->cn_r2[i]))
-                - (results_y1[i] * (params->r1 + params->cn_r1[i]))
-                - (results_y1[i] * (params->l1 + params->cn_l1[i])));
-        double y2_k1 = (s*(params->q2 + params->cn_q2[i])
-                + (results_y2[i] * pratt_r_prime(s, params->r2_prime, params->cn_r2_prime[i]))
-                //+ (results_y2[i] * results_y1[i] * (params->r1 + params->cn_r1[i]))
-                //- (results_y1[i] * results_y2[i] * (params->r2 + params->cn_r2[i]))
-                + (results_y1[i] * (params->r1 + params->cn_r1[i]))
-                - (results_y2[i] * (params->r2 + params->cn_r2[i]))
-                - (results_y2[i] * (params->l2 + params->cn_l2[i])));
-        double y1_k2 = (s*(params->q1 + params->cn_q1[i])
-                + ((results_y1[i] + (y1_k1 * params->h/2)) * pratt_r_prime(s, params->r1_prime, params->cn_r1_prime[i]))
-                //+ ((results_y1[i] + (y1_k1 * params->h/2)) * (results_y2[i] + (y2_k1 * params->h/2)) * (params->r2 + params->cn_r2[i]))
-                //- ((results_y2[i] + (y2_k1 * params->h/2)) * (results_y1[i] + (y1_k1 * params->h/2)) * (params->r1 + params->cn_r1[i]))
-                + ((results_y2[i] + (y2_k1 * params->h/2)) * (params->r2 + params->cn_r2[i]))
-                - ((results_y1[i] + (y1_k1 * params->h/2)) * (params->r1 + params->cn_r1[i]))
-                - ((results_y1[i] + (y1_k1 * params->h/2)) * (params->l1 + params->cn_l1[i])));
-        double y2_k2 = (s*(params->q2 + params->cn_q2[i])
-                + ((results_y2[i] + (y2_k1 * params->h/2)) * pratt_r_prime(s, params->r2_prime, params->cn_r2_prime[i]))
-                //+ ((results_y2[i] + (y2_k1 * params->h/2)) * (results_y1[i] + (y1_k1 * params->h/2)) * (params->r1 + params->cn_r1[i]))
-                //- ((results_y1[i] + (y1_k1 * params->h/2)) * (results_y2[i] + (y2_k1 * params->h/2)) * (params->r2 + params->cn_r2[i]))
-                + ((results_y1[i] + (y1_k1 * params->h/2)) * (params->r1 + params->cn_r1[i]))
-                - ((results_y2[i] + (y2_k1 * params->h/2)) * (params->r2 + params->cn_r2[i]))
-                - ((results_y2[i] + (y2_k1 * params->h/2)) * (params->l2 + params->cn_l2[i])));
-        double y1_k3 = (s*(params->q1 + params->cn_q1[i])
-                + ((results_y1[i] + (y1_k2 * params->h/2)) * pratt_r_prime(s, params->r1_prime, params->cn_r1_prime[i]))
-                //+ ((results_y1[i] + (y1_k2 * params->h/2)) * (results_y2[i] + (y2_k2 * params->h/2)) * (params->r2 + params->cn_r2[i]))
-                //- ((results_y2[i] + (y2_k2 * params->h/2)) * (results_y1[i] + (y1_k2 * params->h/2)) * (params->r1 + params->cn_r1[i]))
-                + ((results_y2[i] + (y2_k2 * params->h/2)) * (params->r2 + params->cn_r2[i]))
-                - ((results_y1[i] + (y1_k2 * params->h/2)) * (params->r1 + params->cn_r1[i]))
-                - ((results_y1[i] + (y1_k2 * params->h/2)) * (params->l1 + params->cn_l1[i])));
-        double y2_k3 = (s*(params->q2 + params->cn_q2[i])
-                + ((results_y2[i] + (y2_k2 * params->h/2)) * pratt_r_prime(s, params->r2_prime, params->cn_r2_prime[i]))
-                //+ ((results_y2[i] + (y2_k2 * params->h/2)) * (results_y1[i] + (y1_k2 * params->h/2)) * (params->r1 + params->cn_r1[i]))
-                //- ((results_y1[i] + (y1_k2 * params->h/2)) * (results_y2[i] + (y2_k2 * params->h/2)) * (params->r2 + params->cn_r2[i]))
-                + ((results_y1[i] + (y1_k2 * params->h/2)) * (params->r1 + params->cn_r1[i]))
-                - ((results_y2[i] + (y2_k2 * params->h/2)) * (params->r2 + params->cn_r2[i]))
-                - ((results_y2[i] + (y2_k2 * params->h/2)) * (params->l2 + params->cn_l2[i])));
-        double y1_k4 = (s*(params->q1 + params->cn_q1[i])
-                + ((results_y1[i] + (y1_k3 * params->h)) * pratt_r_prime(s, params->r1_prime, params->cn_r1_prime[i]))
-                //+ ((results_y1[i] + (y1_k3 * params->h)) * (results_y2[i] + (y2_k3 * params->h)) * (params->r2 + params->cn_r2[i]))
-                //- ((results_y2[i] + (y2_k3 * params->h)) * (results_y1[i] + (y1_k3 * params->h)) * (params->r1 + params->cn_r1[i]))
-                + ((results_y2[i] + (y2_k3 * params->h)) * (params->r2 + params->cn_r2[i]))
-                - ((results_y1[i] + (y1_k3 * params->h)) * (params->r1 + params->cn_r1[i]))
-                - ((results_y1[i] + (y1_k3 * params->h)) * (params->l1 + params->cn_l1[i])));
-        double y2_k4 = (s*(params->q2 + params->cn_q2[i])
-                + ((results_y2[i] + (y2_k3 * params->h)) * pratt_r_prime(s, params->r2_prime, params->cn_r2_prime[i]))
-                //+ ((results_y2[i] + (y2_k3 * params->h)) * (results_y1[i] + (y1_k3 * params->h)) * (params->r1 + params->cn_r1[i]))
-                //- ((results_y1[i] + (y1_k3 * params->h)) * (results_y2[i] + (y2_k3 * params->h)) * (params->r2 + params->cn_r2[i]))
-                + ((results_y1[i] + (y1_k3 * params->h)) * (params->r1 + params->cn_r1[i]))
-                - ((results_y2[i] + (y2_k3 * params->h)) * (params->r2 + params->cn_r2[i]))
-                - ((results_y2[i] + (y2_k3 * params->h)) * (params->l2 + params->cn_l2[i])));
-        /* RK4 method */
-        results_y1[i+1] = results_y1[i] + (((y1_k1 + 2*y1_k2 + 2*y1_k3 + y1_k4)/6)*params->h);
-        results_y2[i+1] = results_y2[i] + (((y2_k1 + 2*y2_k2 + 2*y2_k3 + y2_k4)/6)*params->h);
+    pratt_rk4_steps(params, 0, length-1, results_y1, results_y2);
+}
+
+template <class Method>
+static void pratt_streamed(const params_pratt_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    /* a copy of the parameters with the noise arrays pointing at the block buffers */
+    double noise[8][NOISE_BLOCK];
+    params_pratt_t p = *params;
+    p.cn_q1 = noise[0];
+    p.cn_q2 = noise[1];
+    p.cn_r1 = noise[2];
+    p.cn_r2 = noise[3];
+    p.cn_r1_prime = noise[4];
+    p.cn_r2_prime = noise[5];
+    p.cn_l1 = noise[6];
+    p.cn_l2 = noise[7];
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        pratt_set_noise(key,
+                        first,
+                        0.0,
+                        p.std_dev,
+                        count,
+                        p.cn_q1,
+                        p.cn_q2,
+                        p.cn_r1,
+                        p.cn_r2,
+                        p.cn_r1_prime,
+                        p.cn_r2_prime,
+                        p.cn_l1,
+                        p.cn_l2);
+        pratt_rhs_t f(&p, first);
+        Stepper<Method, pratt_rhs_t>::run(f, p.h, first, count, results_y1, results_y2);
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
+    }
+}
+
+void pratt_adaptive(const params_pratt_t *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats) {
+    int length = ceil(params->d/params->h);
+    adaptive_tol_t defaults;
+    adaptive_stats_t local_stats;
+    if (stats == nullptr) stats = &local_stats;
+    tol = adaptive_setup(tol, &defaults, stats);
+
+    /* a copy of the parameters with every noise array reading 0 */
+    double zero = 0.0;
+    params_pratt_t p = *params;
+    p.cn_q1 = &zero;
+    p.cn_q2 = &zero;
+    p.cn_r1 = &zero;
+    p.cn_r2 = &zero;
+    p.cn_r1_prime = &zero;
+    p.cn_r2_prime = &zero;
+    p.cn_l1 = &zero;
+    p.cn_l2 = &zero;
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    pratt_sliding_rhs_t f(&p, 0);
+    Dopri5<pratt_sliding_rhs_t>(f, 0, tol, stats).run(p.h, length-1, results_y1, results_y2);
+}
+
+template <class Method>
+static void pratt_sde(const params_pratt_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    /* a copy of the parameters reading the noise of the step being taken from w */
+    double w[8];
+    params_pratt_t p = *params;
+    p.cn_q1 = &w[0];
+    p.cn_q2 = &w[1];
+    p.cn_r1 = &w[2];
+    p.cn_r2 = &w[3];
+    p.cn_r1_prime = &w[4];
+    p.cn_r2_prime = &w[5];
+    p.cn_l1 = &w[6];
+    p.cn_l2 = &w[7];
+    double sd[8];
+    for (int c=0; c<8; c++) sd[c] = p.std_dev;
+    sde_system_t<pratt_rhs_t, params_pratt_t> s = {&p, w, 8, sd};
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    double noise[8][NOISE_BLOCK];
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        pratt_set_noise(key,
+                        first,
+                        0.0,
+                        p.std_dev,
+                        count,
+                        noise[0],
+                        noise[1],
+                        noise[2],
+                        noise[3],
+                        noise[4],
+                        noise[5],
+                        noise[6],
+                        noise[7]);
+        SdeStepper<Method, sde_system_t<pratt_rhs_t, params_pratt_t> >::run(s, p.h, first, count, noise[0], NOISE_BLOCK, results_y1, results_y2);
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
+    }
+}
+
+void pratt_integrate_until(const params_pratt_t *params, method_t method, const noise_key_t *key, const boundary_t *boundary,
+                            double *results_y1, double *results_y2, decision_t *decision) {
+    decision_t local_decision;
+    if (decision == nullptr) decision = &local_decision;
+    decision_clear(decision, ceil(params->d/params->h));
+
+    switch (method) {
+        case METHOD_EULER: pratt_streamed<euler_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+        case METHOD_DOPRI5:
+            pratt_adaptive(params, nullptr, results_y1, results_y2, nullptr);
+            if (boundary != nullptr && boundary->kind != BOUNDARY_NONE)
+                boundary_scan(boundary, params->h, 0, decision->steps-1, results_y1, results_y2, 1, decision);
+            break;
+        case METHOD_EXACT:
+        case METHOD_EM:
+        case METHOD_MILSTEIN: pratt_sde<em_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+        default: pratt_streamed<rk4_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
     }
 }
 
+void pratt_integrate(const params_pratt_t *params, method_t method, const noise_key_t *key, double *results_y1, double *results_y2) {
+    pratt_integrate_until(params, method, key, nullptr, results_y1, results_y2, nullptr);
+}
+
+void pratt_rk4_streamed(const params_pratt_t *params, const noise_key_t *key, double *results_y1, double *results_y2) {
+    pratt_integrate(params, METHOD_RK4, key, results_y1, results_y2);
+}
+
 /*****************************************************************************
  *
  * Simplified Indirect Britton Model
@@ -297,27 +662,24 @@ void indirect_britton_set_defaults(params_indirect_britton_t *p) {
 }
 
 /* Fill the noise arrays for the simplified pratt model */
-void indirect_britton_set_noise(std::default_random_engine *g,
-                     double mean,
-                     double std_dev,
-                     int length,
-                     double *cn_q1,
-                     double *cn_q2,
-                     double *cn_r1_prime,
-                     double *cn_r2_prime,
-                     double *cn_l1,
-                     double *cn_l2) {
-
-    std::normal_distribution<double> distribution(mean,std_dev);
+void indirect_britton_set_noise(const noise_key_t *key,
+                                int first,
+                                double mean,
+                                double std_dev,
+                                int length,
+                                double *cn_q1,
+                                double *cn_q2,
+                                double *cn_r1_prime,
+                                double *cn_r2_prime,
+                                double *cn_l1,
+                                double *cn_l2) {
 
-    for (int i=0; i<length; i++) {
-        cn_q1[i] = distribution(*g);
-        cn_q2[i] = distribution(*g);
-        cn_r1_prime[i] = distribution(*g);
-        cn_r2_prime[i] = distribution(*g);
-        cn_l1[i] = distribution(*g);
-        cn_l2[i] = distribution(*g);
-    }
+    rng_normal_block(key, 0, first, length, mean, std_dev, cn_q1);
+    rng_normal_block(key, 1, first, length, mean, std_dev, cn_q2);
+    rng_normal_block(key, 2, first, length, mean, std_dev, cn_r1_prime);
+    rng_normal_block(key, 3, first, length, mean, std_dev, cn_r2_prime);
+    rng_normal_block(key, 4, first, length, mean, std_dev, cn_l1);
+    rng_normal_block(key, 5, first, length, mean, std_dev, cn_l2);
 }
 
 /*
@@ -334,50 +696,189 @@ double indirect_britton_s(double total_population, double y1, double y2) {
     else return (total_population-y1-y2);
 }
 
-void indirect_britton_rk4(params_indirect_britton_t *params, double * results_y1, double * results_y2) {
+/* right-hand side of the simplified indirect Britton model for stepper.h */
+struct indirect_britton_rhs_t {
+    const params_indirect_britton_t *p;
+    int first;      /* step held at index 0 of the noise arrays */
+
+    /* fixed over a step: s is taken at the start of the step, rates include their noise */
+    double s, sq1, sq2, r1_prime, r2_prime, l1, l2;
+
+    indirect_britton_rhs_t(const params_indirect_britton_t *params, int first_step) : p(params), first(first_step) {}
+
+    inline void begin(int i, double y1, double y2) {
+        int j = i - first;
+        s = indirect_britton_s(p->population, y1, y2);
+        sq1 = s*(p->q1 + p->cn_q1[j]);
+        sq2 = s*(p->q2 + p->cn_q2[j]);
+        r1_prime = p->r1_prime + p->cn_r1_prime[j];
+        r2_prime = p->r2_prime + p->cn_r2_prime[j];
+        l1 = p->l1 + p->cn_l1[j];
+        l2 = p->l2 + p->cn_l2[j];
+    }
+
+    inline void operator()(double y1, double y2, double *dy1, double *dy2) const {
+        *dy1 = sq1 + (y1 * s * r1_prime) - (y1 * l1);
+        *dy2 = sq2 + (y2 * s * r2_prime) - (y2 * l2);
+    }
+};
+
+void indirect_britton_rk4_steps(params_indirect_britton_t *params, int first, int count, double *results_y1, double *results_y2) {
+    indirect_britton_rhs_t f(params, first);
+    Stepper<rk4_method_t, indirect_britton_rhs_t>::run(f, params->h, first, count, results_y1, results_y2);
+}
+
+void indirect_britton_jacobian(const params_indirect_britton_t *params, double y1, double y2, double f[2], double jac[2][2]) {
+    const params_indirect_britton_t *p = params;
+    double s = p->population - y1 - y2;
+    f[0] = s*p->q1 + (y1 * s * p->r1_prime) - (y1 * p->l1);
+    f[1] = s*p->q2 + (y2 * s * p->r2_prime) - (y2 * p->l2);
+    jac[0][0] = -p->q1 + p->r1_prime * (s - y1) - p->l1;
+    jac[0][1] = -p->q1 - p->r1_prime * y1;
+    jac[1][0] = -p->q2 - p->r2_prime * y2;
+    jac[1][1] = -p->q2 + p->r2_prime * (s - y2) - p->l2;
+}
 
+void indirect_britton_rk4(params_indirect_britton_t *params, double *results_y1, double *results_y2) {
     int length = ceil(params->d/params->h);
 
     /* set initial conditions */
     results_y1[0] = params->y1_0;
     results_y2[0] = params->y2_0;
 
-    int i;
-    for (i=0;i<length-1;i++) {
-        double s = indirect_britton_s(params->population, results_y1[i], results_y2[i]);
-        double y1_k1 = (s*(params->q1 + params->cn_q1[i])
-                + (results_y1[i] * s * (params->r1_prime + params->cn_r1_prime[i]))
-                - (results_y1[i] * (params->l1 + params->cn_l1[i])));
-        double y2_k1 = (s*(params->q2 + params->cn_q2[i])
-                + (results_y2[i] * s * (params->r2_prime + params->cn_r2_prime[i]))
-                - (results_y2[i] * (params->l2 + params->cn_l2[i])));
-        double y1_k2 = (s*(params->q1 + params->cn_q1[i])
-                + ((results_y1[i] + (y1_k1 * params->h/2)) * s * (params->r1_prime + params->cn_r1_prime[i]))
-                - ((results_y1[i] + (y1_k1 * params->h/2)) * (params->l1 + params->cn_l1[i])));
-        double y2_k2 = (s*(params->q2 + params->cn_q2[i])
-                + ((results_y2[i] + (y2_k1 * params->h/2)) * s * (params->r2_prime + params->cn_r2_prime[i]))
-                - ((results_y2[i] + (y2_k1 * params->h/2)) * (params->l2 + params->cn_l2[i])));
-        double y1_k3 = (s*(params->q1 + params->cn_q1[i])
-                + ((results_y1[i] + (y1_k2 * params->h/2)) * s * (params->r1_prime + params->cn_r1_prime[i]))
-                - ((results_y1[i] + (y1_k2 * params->h/2)) * (params->l1 + params->cn_l1[i])));
-        double y2_k3 = (s*(params->q2 + params->cn_q2[i])
-                + ((results_y2[i] + (y2_k2 * params->h/2)) * s * (params->r2_prime + params->cn_r2_prime[i]))
-                - ((results_y2[i] + (y2_k2 * params->h/2)) * (params->l2 + params->cn_l2[i])));
-        double y1_k4 = (s*(params->q1 + params->cn_q1[i])
-                + ((results_y1[i] + (y1_k3 * params->h)) * s * (params->r1_prime + params->cn_r1_prime[i]))
-                - ((results_y1[i] + (y1_k3 * params->h)) * (params->l1 + params->cn_l1[i])));
-        double y2_k4 = (s*(params->q2 + params->cn_q2[i])
-                + ((results_y2[i] + (y2_k3 * params->h)) * s * (params->r2_prime + params->cn_r2_prime[i]))
-                - ((results_y2[i] + (y2_k3 * params->h)) * (params->l2 + params->cn_l2[i])));
-        /* Euler's method */
-//        results_y1[i+1] = results_y1[i] + (y1_k1 * params->h);
-//        results_y2[i+1] = results_y2[i] + (y2_k1 * params->h);
-        /* RK4 method */
-        results_y1[i+1] = results_y1[i] + (((y1_k1 + 2*y1_k2 + 2*y1_k3 + y1_k4)/6)*params->h);
-        results_y2[i+1] = results_y2[i] + (((y2_k1 + 2*y2_k2 + 2*y2_k3 + y2_k4)/6)*params->h);
+    indirect_britton_rk4_steps(params, 0, length-1, results_y1, results_y2);
+}
+
+template <class Method>
+static void indirect_britton_streamed(const params_indirect_britton_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    /* a copy of the parameters with the noise arrays pointing at the block buffers */
+    double noise[6][NOISE_BLOCK];
+    params_indirect_britton_t p = *params;
+    p.cn_q1 = noise[0];
+    p.cn_q2 = noise[1];
+    p.cn_r1_prime = noise[2];
+    p.cn_r2_prime = noise[3];
+    p.cn_l1 = noise[4];
+    p.cn_l2 = noise[5];
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        indirect_britton_set_noise(key,
+                                   first,
+                                   0.0,
+                                   p.std_dev,
+                                   count,
+                                   p.cn_q1,
+                                   p.cn_q2,
+                                   p.cn_r1_prime,
+                                   p.cn_r2_prime,
+                                   p.cn_l1,
+                                   p.cn_l2);
+        indirect_britton_rhs_t f(&p, first);
+        Stepper<Method, indirect_britton_rhs_t>::run(f, p.h, first, count, results_y1, results_y2);
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
     }
 }
 
+void indirect_britton_adaptive(const params_indirect_britton_t *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats) {
+    int length = ceil(params->d/params->h);
+    adaptive_tol_t defaults;
+    adaptive_stats_t local_stats;
+    if (stats == nullptr) stats = &local_stats;
+    tol = adaptive_setup(tol, &defaults, stats);
+
+    /* a copy of the parameters with every noise array reading 0 */
+    double zero = 0.0;
+    params_indirect_britton_t p = *params;
+    p.cn_q1 = &zero;
+    p.cn_q2 = &zero;
+    p.cn_r1_prime = &zero;
+    p.cn_r2_prime = &zero;
+    p.cn_l1 = &zero;
+    p.cn_l2 = &zero;
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    indirect_britton_rhs_t f(&p, 0);
+    Dopri5<indirect_britton_rhs_t>(f, 0, tol, stats).run(p.h, length-1, results_y1, results_y2);
+}
+
+template <class Method>
+static void indirect_britton_sde(const params_indirect_britton_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    /* a copy of the parameters reading the noise of the step being taken from w */
+    double w[6];
+    params_indirect_britton_t p = *params;
+    p.cn_q1 = &w[0];
+    p.cn_q2 = &w[1];
+    p.cn_r1_prime = &w[2];
+    p.cn_r2_prime = &w[3];
+    p.cn_l1 = &w[4];
+    p.cn_l2 = &w[5];
+    double sd[6];
+    for (int c=0; c<6; c++) sd[c] = p.std_dev;
+    sde_system_t<indirect_britton_rhs_t, params_indirect_britton_t> s = {&p, w, 6, sd};
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    double noise[6][NOISE_BLOCK];
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        indirect_britton_set_noise(key,
+                                   first,
+                                   0.0,
+                                   p.std_dev,
+                                   count,
+                                   noise[0],
+                                   noise[1],
+                                   noise[2],
+                                   noise[3],
+                                   noise[4],
+                                   noise[5]);
+        SdeStepper<Method, sde_system_t<indirect_britton_rhs_t, params_indirect_britton_t> >::run(s, p.h, first, count, noise[0], NOISE_BLOCK, results_y1, results_y2);
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
+    }
+}
+
+void indirect_britton_integrate_until(const params_indirect_britton_t *params, method_t method, const noise_key_t *key, const boundary_t *boundary,
+                                       double *results_y1, double *results_y2, decision_t *decision) {
+    decision_t local_decision;
+    if (decision == nullptr) decision = &local_decision;
+    decision_clear(decision, ceil(params->d/params->h));
+
+    switch (method) {
+        case METHOD_EULER: indirect_britton_streamed<euler_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+        case METHOD_DOPRI5:
+            indirect_britton_adaptive(params, nullptr, results_y1, results_y2, nullptr);
+            if (boundary != nullptr && boundary->kind != BOUNDARY_NONE)
+                boundary_scan(boundary, params->h, 0, decision->steps-1, results_y1, results_y2, 1, decision);
+            break;
+        case METHOD_EXACT:
+        case METHOD_EM:
+        case METHOD_MILSTEIN: indirect_britton_sde<em_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+        default: indirect_britton_streamed<rk4_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+    }
+}
+
+void indirect_britton_integrate(const params_indirect_britton_t *params, method_t method, const noise_key_t *key, double *results_y1, double *results_y2) {
+    indirect_britton_integrate_until(params, method, key, nullptr, results_y1, results_y2, nullptr);
+}
+
+void indirect_britton_rk4_streamed(const params_indirect_britton_t *params, const noise_key_t *key, double *results_y1, double *results_y2) {
+    indirect_britton_integrate(params, METHOD_RK4, key, results_y1, results_y2);
+}
+
 /*****************************************************************************
  *
  * Simplified Direct Britton Model
@@ -413,31 +914,28 @@ void direct_britton_set_defaults(params_direct_britton_t *p) {
 }
 
 /* Fill the noise arrays for the simplified pratt model */
-void direct_britton_set_noise(std::default_random_engine *g,
-                     double mean,
-                     double std_dev,
-                     int length,
-                     double *cn_q1,
-                     double *cn_q2,
-                     double *cn_r1,
-                     double *cn_r2,
-                     double *cn_r1_prime,
-                     double *cn_r2_prime,
-                     double *cn_l1,
-                     double *cn_l2) {
-
-    std::normal_distribution<double> distribution(mean,std_dev);
+void direct_britton_set_noise(const noise_key_t *key,
+                              int first,
+                              double mean,
+                              double std_dev,
+                              int length,
+                              double *cn_q1,
+                              double *cn_q2,
+                              double *cn_r1,
+                              double *cn_r2,
+                              double *cn_r1_prime,
+                              double *cn_r2_prime,
+                              double *cn_l1,
+                              double *cn_l2) {
 
-    for (int i=0; i<length; i++) {
-        cn_q1[i] = distribution(*g);
-        cn_q2[i] = distribution(*g);
-        cn_r1[i] = distribution(*g);
-        cn_r2[i] = distribution(*g);
-        cn_r1_prime[i] = distribution(*g);
-        cn_r2_prime[i] = distribution(*g);
-        cn_l1[i] = distribution(*g);
-        cn_l2[i] = distribution(*g);
-    }
+    rng_normal_block(key, 0, first, length, mean, std_dev, cn_q1);
+    rng_normal_block(key, 1, first, length, mean, std_dev, cn_q2);
+    rng_normal_block(key, 2, first, length, mean, std_dev, cn_r1);
+    rng_normal_block(key, 3, first, length, mean, std_dev, cn_r2);
+    rng_normal_block(key, 4, first, length, mean, std_dev, cn_r1_prime);
+    rng_normal_block(key, 5, first, length, mean, std_dev, cn_r2_prime);
+    rng_normal_block(key, 6, first, length, mean, std_dev, cn_l1);
+    rng_normal_block(key, 7, first, length, mean, std_dev, cn_l2);
 }
 
 /*
@@ -454,58 +952,201 @@ double direct_britton_s(double total_population, double y1, double y2) {
     else return (total_population-y1-y2);
 }
 
-void direct_britton_rk4(params_direct_britton_t *params, double * results_y1, double * results_y2) {
+/* right-hand side of the simplified direct Britton model for stepper.h */
+struct direct_britton_rhs_t {
+    const params_direct_britton_t *p;
+    int first;      /* step held at index 0 of the noise arrays */
+
+    /* fixed over a step: s is taken at the start of the step, rates include their noise */
+    double s, sq1, sq2, r1_prime, r2_prime, r, l1, l2;
+
+    direct_britton_rhs_t(const params_direct_britton_t *params, int first_step) : p(params), first(first_step) {}
+
+    inline void begin(int i, double y1, double y2) {
+        int j = i - first;
+        s = indirect_britton_s(p->population, y1, y2);
+        sq1 = s*(p->q1 + p->cn_q1[j]);
+        sq2 = s*(p->q2 + p->cn_q2[j]);
+        r1_prime = p->r1_prime + p->cn_r1_prime[j];
+        r2_prime = p->r2_prime + p->cn_r2_prime[j];
+        r = p->r1 - p->r2 + p->cn_r1[j] - p->cn_r2[j];
+        l1 = p->l1 + p->cn_l1[j];
+        l2 = p->l2 + p->cn_l2[j];
+    }
+
+    inline void operator()(double y1, double y2, double *dy1, double *dy2) const {
+        *dy1 = sq1 + (y1 * s * r1_prime) + (y1 * y2 * r) - (y1 * l1);
+        *dy2 = sq2 + (y2 * s * r2_prime) - (y1 * y2 * r) - (y2 * l2);
+    }
+};
+
+void direct_britton_rk4_steps(params_direct_britton_t *params, int first, int count, double *results_y1, double *results_y2) {
+    direct_britton_rhs_t f(params, first);
+    Stepper<rk4_method_t, direct_britton_rhs_t>::run(f, params->h, first, count, results_y1, results_y2);
+}
+
+void direct_britton_jacobian(const params_direct_britton_t *params, double y1, double y2, double f[2], double jac[2][2]) {
+    const params_direct_britton_t *p = params;
+    double s = p->population - y1 - y2;
+    double r = p->r1 - p->r2;
+    f[0] = s*p->q1 + (y1 * s * p->r1_prime) + (y1 * y2 * r) - (y1 * p->l1);
+    f[1] = s*p->q2 + (y2 * s * p->r2_prime) - (y1 * y2 * r) - (y2 * p->l2);
+    jac[0][0] = -p->q1 + p->r1_prime * (s - y1) + (y2 * r) - p->l1;
+    jac[0][1] = -p->q1 - p->r1_prime * y1 + (y1 * r);
+    jac[1][0] = -p->q2 - p->r2_prime * y2 - (y2 * r);
+    jac[1][1] = -p->q2 + p->r2_prime * (s - y2) - (y1 * r) - p->l2;
+}
 
+void direct_britton_rk4(params_direct_britton_t *params, double *results_y1, double *results_y2) {
     int length = ceil(params->d/params->h);
 
     /* set initial conditions */
     results_y1[0] = params->y1_0;
     results_y2[0] = params->y2_0;
 
-    int i;
-    for (i=0;i<length-1;i++) {
-        double s = indirect_britton_s(params->population, results_y1[i], results_y2[i]);
-        double y1_k1 = (s*(params->q1 + params->cn_q1[i])
-                + (results_y1[i] * s * (params->r1_prime + params->cn_r1_prime[i]))
-                + (results_y1[i] * results_y2[i] * (params->r1 - params->r2 + params->cn_r1[i] - params->cn_r2[i]))
-                - (results_y1[i] * (params->l1 + params->cn_l1[i])));
-        double y2_k1 = (s*(params->q2 + params->cn_q2[i])
-                + (results_y2[i] * s * (params->r2_prime + params->cn_r2_prime[i]))
-                - (results_y1[i] * results_y2[i] * (params->r1 - params->r2 + params->cn_r1[i] - params->cn_r2[i]))
-                - (results_y2[i] * (params->l2 + params->cn_l2[i])));
-        double y1_k2 = (s*(params->q1 + params->cn_q1[i])
-                + ((results_y1[i] + (y1_k1 * params->h/2)) * s * (params->r1_prime + params->cn_r1_prime[i]))
-                + ((results_y1[i] + (y1_k1 * params->h/2)) * (results_y2[i] + (y2_k1 * params->h/2)) * (params->r1 - params->r2 + params->cn_r1[i] - params->cn_r2[i]))
-                - ((results_y1[i] + (y1_k1 * params->h/2)) * (params->l1 + params->cn_l1[i])));
-        double y2_k2 = (s*(params->q2 + params->cn_q2[i])
-                + ((results_y2[i] + (y2_k1 * params->h/2)) * s * (params->r2_prime + params->cn_r2_prime[i]))
-                - ((results_y1[i] + (y1_k1 * params->h/2)) * (results_y2[i] + (y2_k1 * params->h/2)) * (params->r1 - params->r2 + params->cn_r1[i] - params->cn_r2[i]))
-                - ((results_y2[i] + (y2_k1 * params->h/2)) * (params->l2 + params->cn_l2[i])));
-        double y1_k3 = (s*(params->q1 + params->cn_q1[i])
-                + ((results_y1[i] + (y1_k2 * params->h/2)) * s * (params->r1_prime + params->cn_r1_prime[i]))
-                + ((results_y1[i] + (y1_k2 * params->h/2)) * (results_y2[i] + (y2_k2 * params->h/2)) * (params->r1 - params->r2 + params->cn_r1[i] - params->cn_r2[i]))
-                - ((results_y1[i] + (y1_k2 * params->h/2)) * (params->l1 + params->cn_l1[i])));
-        double y2_k3 = (s*(params->q2 + params->cn_q2[i])
-                + ((results_y2[i] + (y2_k2 * params->h/2)) * s * (params->r2_prime + params->cn_r2_prime[i]))
-                - ((results_y1[i] + (y1_k2 * params->h/2)) * (results_y2[i] + (y2_k2 * params->h/2)) * (params->r1 - params->r2 + params->cn_r1[i] - params->cn_r2[i]))
-                - ((results_y2[i] + (y2_k2 * params->h/2)) * (params->l2 + params->cn_l2[i])));
-        double y1_k4 = (s*(params->q1 + params->cn_q1[i])
-                + ((results_y1[i] + (y1_k3 * params->h)) * s * (params->r1_prime + params->cn_r1_prime[i]))
-                + ((results_y1[i] + (y1_k3 * params->h)) * (results_y2[i] + (y2_k3 * params->h)) * (params->r1 - params->r2 + params->cn_r1[i] - params->cn_r2[i]))
-                - ((results_y1[i] + (y1_k3 * params->h)) * (params->l1 + params->cn_l1[i])));
-        double y2_k4 = (s*(params->q2 + params->cn_q2[i])
-                + ((results_y2[i] + (y2_k3 * params->h)) * s * (params->r2_prime + params->cn_r2_prime[i]))
-                - ((results_y1[i] + (y1_k3 * params->h)) * (results_y2[i] + (y2_k3 * params->h)) * (params->r1 - params->r2 + params->cn_r1[i] - params->cn_r2[i]))
-                - ((results_y2[i] + (y2_k3 * params->h)) * (params->l2 + params->cn_l2[i])));
-        /* Euler's method */
-//        results_y1[i+1] = results_y1[i] + (y1_k1 * params->h);
-//        results_y2[i+1] = results_y2[i] + (y2_k1 * params->h);
-        /* RK4 method */
-        results_y1[i+1] = results_y1[i] + (((y1_k1 + 2*y1_k2 + 2*y1_k3 + y1_k4)/6)*params->h);
-        results_y2[i+1] = results_y2[i] + (((y2_k1 + 2*y2_k2 + 2*y2_k3 + y2_k4)/6)*params->h);
+    direct_britton_rk4_steps(params, 0, length-1, results_y1, results_y2);
+}
+
+template <class Method>
+static void direct_britton_streamed(const params_direct_britton_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    /* a copy of the parameters with the noise arrays pointing at the block buffers */
+    double noise[8][NOISE_BLOCK];
+    params_direct_britton_t p = *params;
+    p.cn_q1 = noise[0];
+    p.cn_q2 = noise[1];
+    p.cn_r1 = noise[2];
+    p.cn_r2 = noise[3];
+    p.cn_r1_prime = noise[4];
+    p.cn_r2_prime = noise[5];
+    p.cn_l1 = noise[6];
+    p.cn_l2 = noise[7];
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        direct_britton_set_noise(key,
+                                 first,
+                                 0.0,
+                                 p.std_dev,
+                                 count,
+                                 p.cn_q1,
+                                 p.cn_q2,
+                                 p.cn_r1,
+                                 p.cn_r2,
+                                 p.cn_r1_prime,
+                                 p.cn_r2_prime,
+                                 p.cn_l1,
+                                 p.cn_l2);
+        direct_britton_rhs_t f(&p, first);
+        Stepper<Method, direct_britton_rhs_t>::run(f, p.h, first, count, results_y1, results_y2);
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
+    }
+}
+
+void direct_britton_adaptive(const params_direct_britton_t *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats) {
+    int length = ceil(params->d/params->h);
+    adaptive_tol_t defaults;
+    adaptive_stats_t local_stats;
+    if (stats == nullptr) stats = &local_stats;
+    tol = adaptive_setup(tol, &defaults, stats);
+
+    /* a copy of the parameters with every noise array reading 0 */
+    double zero = 0.0;
+    params_direct_britton_t p = *params;
+    p.cn_q1 = &zero;
+    p.cn_q2 = &zero;
+    p.cn_r1 = &zero;
+    p.cn_r2 = &zero;
+    p.cn_r1_prime = &zero;
+    p.cn_r2_prime = &zero;
+    p.cn_l1 = &zero;
+    p.cn_l2 = &zero;
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    direct_britton_rhs_t f(&p, 0);
+    Dopri5<direct_britton_rhs_t>(f, 0, tol, stats).run(p.h, length-1, results_y1, results_y2);
+}
+
+template <class Method>
+static void direct_britton_sde(const params_direct_britton_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    /* a copy of the parameters reading the noise of the step being taken from w */
+    double w[8];
+    params_direct_britton_t p = *params;
+    p.cn_q1 = &w[0];
+    p.cn_q2 = &w[1];
+    p.cn_r1 = &w[2];
+    p.cn_r2 = &w[3];
+    p.cn_r1_prime = &w[4];
+    p.cn_r2_prime = &w[5];
+    p.cn_l1 = &w[6];
+    p.cn_l2 = &w[7];
+    double sd[8];
+    for (int c=0; c<8; c++) sd[c] = p.std_dev;
+    sde_system_t<direct_britton_rhs_t, params_direct_britton_t> s = {&p, w, 8, sd};
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    double noise[8][NOISE_BLOCK];
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        direct_britton_set_noise(key,
+                                 first,
+                                 0.0,
+                                 p.std_dev,
+                                 count,
+                                 noise[0],
+                                 noise[1],
+                                 noise[2],
+                                 noise[3],
+                                 noise[4],
+                                 noise[5],
+                                 noise[6],
+                                 noise[7]);
+        SdeStepper<Method, sde_system_t<direct_britton_rhs_t, params_direct_britton_t> >::run(s, p.h, first, count, noise[0], NOISE_BLOCK, results_y1, results_y2);
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
     }
 }
 
+void direct_britton_integrate_until(const params_direct_britton_t *params, method_t method, const noise_key_t *key, const boundary_t *boundary,
+                                     double *results_y1, double *results_y2, decision_t *decision) {
+    decision_t local_decision;
+    if (decision == nullptr) decision = &local_decision;
+    decision_clear(decision, ceil(params->d/params->h));
+
+    switch (method) {
+        case METHOD_EULER: direct_britton_streamed<euler_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+        case METHOD_DOPRI5:
+            direct_britton_adaptive(params, nullptr, results_y1, results_y2, nullptr);
+            if (boundary != nullptr && boundary->kind != BOUNDARY_NONE)
+                boundary_scan(boundary, params->h, 0, decision->steps-1, results_y1, results_y2, 1, decision);
+            break;
+        case METHOD_EXACT:
+        case METHOD_EM:
+        case METHOD_MILSTEIN: direct_britton_sde<em_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+        default: direct_britton_streamed<rk4_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+    }
+}
+
+void direct_britton_integrate(const params_direct_britton_t *params, method_t method, const noise_key_t *key, double *results_y1, double *results_y2) {
+    direct_britton_integrate_until(params, method, key, nullptr, results_y1, results_y2, nullptr);
+}
+
+void direct_britton_rk4_streamed(const params_direct_britton_t *params, const noise_key_t *key, double *results_y1, double *results_y2) {
+    direct_britton_integrate(params, METHOD_RK4, key, results_y1, results_y2);
+}
+
 /*****************************************************************************
  *
  * Gaze Model
@@ -535,12 +1176,23 @@ void gaze_set_defaults(params_gaze_t *p) {
     p->n_std_dev = 0.1;
     p->g_std_dev = 0.1;
     p->seed = 32;
+    p->n_I1 = nullptr;
+    p->n_I2 = nullptr;
+    p->n_w1 = nullptr;
+    p->n_w2 = nullptr;
+    p->n_g1 = nullptr;
+    p->n_g2 = nullptr;
+    p->n_l1 = nullptr;
+    p->n_l2 = nullptr;
+    p->n_gaze = nullptr;
 }
 
 /* Fill the noise arrays for the UM model */
-void gaze_set_noise(std::default_random_engine *g,
+void gaze_set_noise(const noise_key_t *key,
+                    int first,
                     double mean,
                     double n_std_dev,
+                    double g_std_dev,
                     int length,
                     double *n_I1,
                     double *n_I2,
@@ -549,93 +1201,368 @@ void gaze_set_noise(std::default_random_engine *g,
                     double *n_g1,
                     double *n_g2,
                     double *n_l1,
-                    double *n_l2)
+                    double *n_l2,
+                    double *n_gaze)
 {
-    std::normal_distribution<double> distribution(mean,n_std_dev);
-    for (int i=0; i<length; i++) {
-        n_I1[i] = distribution(*g);
-        n_I2[i] = distribution(*g);
-        n_w1[i] = distribution(*g);
-        n_w2[i] = distribution(*g);
-        n_g1[i] = distribution(*g);
-        n_g2[i] = distribution(*g);
-        n_l1[i] = distribution(*g);
-        n_l2[i] = distribution(*g);
+    rng_normal_block(key, 0, first, length, mean, n_std_dev, n_I1);
+    rng_normal_block(key, 1, first, length, mean, n_std_dev, n_I2);
+    rng_normal_block(key, 2, first, length, mean, n_std_dev, n_w1);
+    rng_normal_block(key, 3, first, length, mean, n_std_dev, n_w2);
+    rng_normal_block(key, 4, first, length, mean, n_std_dev, n_g1);
+    rng_normal_block(key, 5, first, length, mean, n_std_dev, n_g2);
+    rng_normal_block(key, 6, first, length, mean, n_std_dev, n_l1);
+    rng_normal_block(key, 7, first, length, mean, n_std_dev, n_l2);
+    /* gaze location offsets, only read while the gaze is active */
+    rng_normal_block(key, 8, first, length, 0.0, g_std_dev, n_gaze);
+}
+
+/* right-hand side of the gaze model for stepper.h */
+struct gaze_rhs_t {
+    const params_gaze_t *p;
+    int first;      /* step held at index 0 of the noise arrays */
+    int gs, ge;     /* gaze interval in steps */
+    double u1, u2;  /* input and gaze input plus their noise, fixed over a step */
+
+    gaze_rhs_t(const params_gaze_t *params, int first_step) : p(params), first(first_step) {
+        gs = floor(p->gaze_start/p->h);
+        ge = floor(p->gaze_end/p->h);
     }
+
+    /* gaze input to y1 and y2 with the gaze offset from tg, while the gaze is active */
+    inline void gaze_input(double gaze_offset, double *g1, double *g2) const {
+        if(p->tg >= p->t1) {
+            *g1 = (p->g) * (((-1)/p->a * (p->tg - p->t1 + gaze_offset) + 1));
+        } else {
+            *g1 = (p->g) * (((-1)/p->a * (p->t1 - p->tg - gaze_offset) + 1));
+        }
+        if(p->tg >= p->t2) {
+            *g2 = (p->g) * (((-1)/p->a * (p->tg - p->t2 + gaze_offset) + 1));
+        } else {
+            *g2 = (p->g) * (((-1)/p->a * (p->t2 - p->tg - gaze_offset) + 1));
+        }
+        if (*g1 < 0.0) *g1 = 0.0;
+        if (*g2 < 0.0) *g2 = 0.0;
+    }
+
+    inline void begin(int i, double, double) {
+        int j = i - first;
+        double g1 = 0.;
+        double g2 = 0.;
+
+        /* outside of gaze interval, the gaze is directed at nothing */
+        if (i >= gs && i <= ge) {
+            /* gaze is activated */
+            gaze_input(p->n_gaze[j], &g1, &g2);
+        }
+
+        u1 = (p->I1 + p->n_I1[j]) + (g1 + p->n_g1[j]);
+        u2 = (p->I2 + p->n_I2[j]) + (g2 + p->n_g2[j]);
+    }
+
+    inline void operator()(double y1, double y2, double *dy1, double *dy2) const {
+        *dy1 = u1 - (p->l1 * y1) - (p->w2 * y2);
+        *dy2 = u2 - (p->l2 * y2) - (p->w1 * y1);
+    }
+};
+
+/*
+ * the gaze model for sde.h. the gaze offset sits inside the clipped linear
+ * gaze input, so it is not a rate the model is affine in; it is taken to
+ * first order instead, as a jitter on the gaze input while that is above 0
+ */
+struct gaze_sde_rhs_t : gaze_rhs_t {
+    gaze_sde_rhs_t(const params_gaze_t *params, int first_step) : gaze_rhs_t(params, first_step) {}
+
+    inline void begin(int i, double, double) {
+        int j = i - first;
+        double g1 = 0.;
+        double g2 = 0.;
+
+        if (i >= gs && i <= ge) {
+            gaze_input(0.0, &g1, &g2);
+            double slope = p->g / p->a;
+            if (g1 > 0.0) g1 += (p->tg >= p->t1 ? -slope : slope) * p->n_gaze[j];
+            if (g2 > 0.0) g2 += (p->tg >= p->t2 ? -slope : slope) * p->n_gaze[j];
+        }
+
+        u1 = (p->I1 + p->n_I1[j]) + (g1 + p->n_g1[j]);
+        u2 = (p->I2 + p->n_I2[j]) + (g2 + p->n_g2[j]);
+    }
+};
+
+void gaze_rk4_steps(params_gaze_t *params, int first, int count, double *results_y1, double *results_y2) {
+    gaze_rhs_t f(params, first);
+    Stepper<rk4_method_t, gaze_rhs_t>::run(f, params->h, first, count, results_y1, results_y2);
 }
 
-void gaze_rk4(std::default_random_engine *g, params_gaze_t *params, double *results_y1, double *results_y2) {
+void gaze_jacobian(const params_gaze_t *params, double y1, double y2, double f[2], double jac[2][2]) {
     int length = ceil(params->d/params->h);
 
-    /* for generating gaze location */
-    std::normal_distribution<double> distribution(0.0,params->g_std_dev);
-    int gs = floor(params->gaze_start/params->h);
-    int ge = floor(params->gaze_end/params->h);
-    double g1 = 0.;
-    double g2 = 0.;
+    /* a copy of the parameters with every noise array reading 0 */
+    double zero = 0.0;
+    params_gaze_t p = *params;
+    p.n_I1 = &zero;
+    p.n_I2 = &zero;
+    p.n_g1 = &zero;
+    p.n_g2 = &zero;
+    p.n_gaze = &zero;
+
+    /* the inputs in force over the last step of the run */
+    gaze_rhs_t rhs(&p, length-2);
+    rhs.begin(length-2, y1, y2);
+    rhs(y1, y2, &f[0], &f[1]);
+    jac[0][0] = -p.l1;
+    jac[0][1] = -p.w2;
+    jac[1][0] = -p.w1;
+    jac[1][1] = -p.l2;
+}
+
+void gaze_rk4(params_gaze_t *params, double *results_y1, double *results_y2) {
+    int length = ceil(params->d/params->h);
 
     /* set initial conditions */
     results_y1[0] = params->y1_0;
     results_y2[0] = params->y2_0;
 
-    /* outside of gaze interval, the gaze is directed at nothing */
-    int i;
-    for (i=0;i<length-1;i++) {
-        if (i >= gs && i <= ge) {
-            /* gaze is activated */
-            double gaze_offset = distribution(*g);
-            if(params->tg >= params->t1) {
-                g1 = (params->g) * (((-1)/params->a * (params->tg - params->t1 + gaze_offset) + 1));
-            } else {
-                g1 = (params->g) * (((-1)/params->a * (params->t1 - params->tg - gaze_offset) + 1));
-            }
-            if(params->tg >= params->t2) {
-                g2 = (params->g) * (((-1)/params->a * (params->tg - params->t2 + gaze_offset) + 1));
+    gaze_rk4_steps(params, 0, length-1, results_y1, results_y2);
+}
+
+template <class Method>
+static void gaze_streamed(const params_gaze_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    /* a copy of the parameters with the noise arrays pointing at the block buffers */
+    double noise[9][NOISE_BLOCK];
+    params_gaze_t p = *params;
+    p.n_I1 = noise[0];
+    p.n_I2 = noise[1];
+    p.n_w1 = noise[2];
+    p.n_w2 = noise[3];
+    p.n_g1 = noise[4];
+    p.n_g2 = noise[5];
+    p.n_l1 = noise[6];
+    p.n_l2 = noise[7];
+    p.n_gaze = noise[8];
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        gaze_set_noise(key,
+                       first,
+                       0.0,
+                       p.n_std_dev,
+                       p.g_std_dev,
+                       count,
+                       p.n_I1,
+                       p.n_I2,
+                       p.n_w1,
+                       p.n_w2,
+                       p.n_g1,
+                       p.n_g2,
+                       p.n_l1,
+                       p.n_l2,
+                       p.n_gaze);
+        gaze_rhs_t f(&p, first);
+        Stepper<Method, gaze_rhs_t>::run(f, p.h, first, count, results_y1, results_y2);
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
+    }
+}
+
+void gaze_adaptive(const params_gaze_t *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats) {
+    int length = ceil(params->d/params->h);
+    adaptive_tol_t defaults;
+    adaptive_stats_t local_stats;
+    if (stats == nullptr) stats = &local_stats;
+    tol = adaptive_setup(tol, &defaults, stats);
+
+    /* a copy of the parameters with every noise array reading 0 */
+    double zero = 0.0;
+    params_gaze_t p = *params;
+    p.n_I1 = &zero;
+    p.n_I2 = &zero;
+    p.n_w1 = &zero;
+    p.n_w2 = &zero;
+    p.n_g1 = &zero;
+    p.n_g2 = &zero;
+    p.n_l1 = &zero;
+    p.n_l2 = &zero;
+    p.n_gaze = &zero;
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    /* the gaze input switches on and off: integrate each side of the switches on its own */
+    gaze_rhs_t window(&p, 0);
+    int pieces[4] = {0, window.gs, window.ge+1, length-1};
+    for (int k=1; k<4; k++) {
+        if (pieces[k] < pieces[k-1]) pieces[k] = pieces[k-1];
+        if (pieces[k] > length-1) pieces[k] = length-1;
+    }
+    for (int k=0; k<3; k++) {
+        if (pieces[k+1] <= pieces[k]) continue;
+        gaze_rhs_t f(&p, pieces[k]);
+        Dopri5<gaze_rhs_t>(f, pieces[k], tol, stats).run(p.h, pieces[k+1]-pieces[k], results_y1, results_y2);
+    }
+}
+
+template <class Method>
+static void gaze_sde(const params_gaze_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+
+    /* a copy of the parameters reading the noise of the step being taken from w */
+    double w[9];
+    params_gaze_t p = *params;
+    p.n_I1 = &w[0];
+    p.n_I2 = &w[1];
+    p.n_w1 = &w[2];
+    p.n_w2 = &w[3];
+    p.n_g1 = &w[4];
+    p.n_g2 = &w[5];
+    p.n_l1 = &w[6];
+    p.n_l2 = &w[7];
+    p.n_gaze = &w[8];
+    double sd[9];
+    for (int c=0; c<8; c++) sd[c] = p.n_std_dev;
+    sd[8] = p.g_std_dev;
+    sde_system_t<gaze_sde_rhs_t, params_gaze_t> s = {&p, w, 9, sd};
+
+    /* set initial conditions */
+    results_y1[0] = p.y1_0;
+    results_y2[0] = p.y2_0;
+
+    double noise[9][NOISE_BLOCK];
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        gaze_set_noise(key,
+                       first,
+                       0.0,
+                       p.n_std_dev,
+                       p.g_std_dev,
+                       count,
+                       noise[0],
+                       noise[1],
+                       noise[2],
+                       noise[3],
+                       noise[4],
+                       noise[5],
+                       noise[6],
+                       noise[7],
+                       noise[8]);
+        SdeStepper<Method, sde_system_t<gaze_sde_rhs_t, params_gaze_t> >::run(s, p.h, first, count, noise[0], NOISE_BLOCK, results_y1, results_y2);
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
+    }
+}
+
+/*
+ * the gaze model read as an Ito SDE, as by gaze_sde, advanced by its exact
+ * transition. the model is linear with additive noise both with the gaze on
+ * and with it off, so a step that the switch at gaze_start or gaze_end falls
+ * inside is the exact transition up to the switch followed by the one after
+ * it. the switches are at those times, not at the step they fall in as with
+ * the fixed step methods
+ */
+static void gaze_exact(const params_gaze_t *params, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision) {
+    int length = ceil(params->d/params->h);
+    const double h = params->h;
+
+    double w[9];
+    params_gaze_t p = *params;
+    p.n_I1 = &w[0];
+    p.n_I2 = &w[1];
+    p.n_w1 = &w[2];
+    p.n_w2 = &w[3];
+    p.n_g1 = &w[4];
+    p.n_g2 = &w[5];
+    p.n_l1 = &w[6];
+    p.n_l2 = &w[7];
+    p.n_gaze = &w[8];
+    double sd[9];
+    for (int c=0; c<8; c++) sd[c] = p.n_std_dev;
+    sd[8] = p.g_std_dev;
+
+    /* the model with the gaze on, and off, throughout */
+    params_gaze_t on = p, off = p;
+    on.gaze_start = 0.0;
+    on.gaze_end = p.d + h;
+    off.gaze_start = 0.0;
+    off.gaze_end = -h;
+    sde_system_t<gaze_sde_rhs_t, params_gaze_t> s_on = {&on, w, 9, sd};
+    sde_system_t<gaze_sde_rhs_t, params_gaze_t> s_off = {&off, w, 9, sd};
+    ou_system_t system[2];
+    ou_linearise(s_off, 0, &system[0]);
+    ou_linearise(s_on, 0, &system[1]);
+    ou_transition_t step[2];
+    ou_transition(&system[0], h, &step[0]);
+    ou_transition(&system[1], h, &step[1]);
+
+    /* set initial conditions */
+    double y1 = p.y1_0;
+    double y2 = p.y2_0;
+    results_y1[0] = y1;
+    results_y2[0] = y2;
+
+    double z[2][NOISE_BLOCK];
+    for (int first=0; first<length-1; first+=NOISE_BLOCK) {
+        int count = length-1-first < NOISE_BLOCK ? length-1-first : NOISE_BLOCK;
+        rng_normal_block(key, 0, first, count, 0.0, 1.0, z[0]);
+        rng_normal_block(key, 1, first, count, 0.0, 1.0, z[1]);
+        for (int k=0; k<count; k++) {
+            double t0 = (first+k) * h;
+            double t1 = t0 + h;
+            if (t1 <= p.gaze_start || t0 >= p.gaze_end) {
+                ou_step(&step[0], z[0][k], z[1][k], &y1, &y2);
+            } else if (t0 >= p.gaze_start && t1 <= p.gaze_end) {
+                ou_step(&step[1], z[0][k], z[1][k], &y1, &y2);
             } else {
-                g2 = (params->g) * (((-1)/params->a * (params->t2 - params->tg - gaze_offset) + 1));
+                /* a switch falls inside the step: join the pieces either side of it */
+                double cuts[4] = {t0, t0, t1, t1};
+                if (p.gaze_start > t0) cuts[1] = p.gaze_start;
+                if (p.gaze_end < t1) cuts[2] = p.gaze_end;
+                ou_transition_t joined, piece;
+                ou_transition(&system[0], 0.0, &joined);
+                for (int c=0; c<3; c++) {
+                    if (cuts[c+1] <= cuts[c]) continue;
+                    ou_transition(&system[c == 1 ? 1 : 0], cuts[c+1] - cuts[c], &piece);
+                    ou_compose(&joined, &piece, &joined);
+                }
+                ou_step(&joined, z[0][k], z[1][k], &y1, &y2);
             }
-            if (g1 < 0.0) g1 = 0.0;
-            if (g2 < 0.0) g2 = 0.0;
-        } else {
-            /* gaze is not active */
-            g1 = 0.;
-            g2 = 0.;
+            results_y1[first+k+1] = y1;
+            results_y2[first+k+1] = y2;
         }
+        if (boundary_reached(boundary, p.h, first, count, results_y1, results_y2, decision)) return;
+    }
+}
+
+void gaze_integrate_until(const params_gaze_t *params, method_t method, const noise_key_t *key, const boundary_t *boundary,
+                           double *results_y1, double *results_y2, decision_t *decision) {
+    decision_t local_decision;
+    if (decision == nullptr) decision = &local_decision;
+    decision_clear(decision, ceil(params->d/params->h));
 
-        double y1_k1 = (params->I1 + params->n_I1[i])
-                + (g1 + params->n_g1[i])
-                - (params->l1 * results_y1[i])
-                - (params->w2 * results_y2[i]);
-        double y2_k1 = (params->I2 + params->n_I2[i])
-                + (g2 + params->n_g2[i])
-                - (params->l2 * results_y2[i])
-                - (params->w1 * results_y1[i]);
-        double y1_k2 = (params->I1 + params->n_I1[i])
-                + (g1 + params->n_g1[i])
-                - (params->l1 * (results_y1[i] + (y1_k1 * params->h/2)))
-                - (params->w2 * (results_y2[i] + (y2_k1 * params->h/2)));
-        double y2_k2 = (params->I2 + params->n_I2[i])
-                + (g2 + params->n_g2[i])
-                - (params->l2 * (results_y2[i] + (y2_k1 * params->h/2)))
-                - (params->w1 * (results_y1[i] + (y1_k1 * params->h/2)));
-        double y1_k3 = (params->I1 + params->n_I1[i])
-                + (g1 + params->n_g1[i])
-                - (params->l1 * (results_y1[i] + (y1_k2 * params->h/2)))
-                - (params->w2 * (results_y2[i] + (y2_k2 * params->h/2)));
-        double y2_k3 = (params->I2 + params->n_I2[i])
-                + (g2 + params->n_g2[i])
-                - (params->l2 * (results_y2[i] + (y2_k2 * params->h/2)))
-                - (params->w1 * (results_y1[i] + (y1_k2 * params->h/2)));
-        double y1_k4 = (params->I1 + params->n_I1[i])
-                + (g1 + params->n_g1[i])
-                - (params->l1 * (results_y1[i] + (y1_k3 * params->h)))
-                - (params->w2 * (results_y2[i] + (y2_k3 * params->h)));
-        double y2_k4 = (params->I2 + params->n_I2[i])
-                + (g2 + params->n_g2[i])
-                - (params->l2 * (results_y2[i] + (y2_k3 * params->h)))
-                - (params->w1 * (results_y1[i] + (y1_k3 * params->h)));
-        results_y1[i+1] = results_y1[i] + (((y1_k1 + 2*y1_k2 + 2*y1_k3 + y1_k4)/6)*params->h);
-        results_y2[i+1] = results_y2[i] + (((y2_k1 + 2*y2_k2 + 2*y2_k3 + y2_k4)/6)*params->h);
+    switch (method) {
+        case METHOD_EULER: gaze_streamed<euler_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+        case METHOD_DOPRI5:
+            gaze_adaptive(params, nullptr, results_y1, results_y2, nullptr);
+            if (boundary != nullptr && boundary->kind != BOUNDARY_NONE)
+                boundary_scan(boundary, params->h, 0, decision->steps-1, results_y1, results_y2, 1, decision);
+            break;
+        case METHOD_EM:
+        case METHOD_MILSTEIN: gaze_sde<em_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
+        case METHOD_EXACT: gaze_exact(params, key, boundary, results_y1, results_y2, decision); break;
+        default: gaze_streamed<rk4_method_t>(params, key, boundary, results_y1, results_y2, decision); break;
     }
 }
 
+void gaze_integrate(const params_gaze_t *params, method_t method, const noise_key_t *key, double *results_y1, double *results_y2) {
+    gaze_integrate_until(params, method, key, nullptr, results_y1, results_y2, nullptr);
+}
+
+void gaze_rk4_streamed(const params_gaze_t *params, const noise_key_t *key, double *results_y1, double *results_y2) {
+    gaze_integrate(params, METHOD_RK4, key, results_y1, results_y2);
+}
+
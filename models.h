@@ -1,8 +1,8 @@
 #ifndef MODELS_H
 #define MODELS_H
 
-#include <iostream> // debug
-#include <random>
+#include <cmath>
+#include "rng.h"
 
 /* parameters for usher_mclelland model */
 typedef struct params_um_s {
@@ -143,6 +143,7 @@ typedef struct params_gaze_s {
     double *n_g2;   /* noise on gaze input to y2 */
     double *n_l1;   /* noise on decay from y1 */
     double *n_l2;   /* noise on decay from y2 */
+    double *n_gaze; /* gaze location offset, standard deviation g_std_dev */
 } params_gaze_t;
 
 /* set default parameters */
@@ -152,10 +153,15 @@ void indirect_britton_set_defaults(params_indirect_britton_t *p);
 void direct_britton_set_defaults(params_direct_britton_t *p);
 void gaze_set_defaults(params_gaze_t *p);
 
-/* given a seeded random engine, fill arrays with random noise */
-void um_set_noise(std::default_random_engine *g, double mean, double std_dev, int length, double *cn1, double *cn2);
+/*
+ * fill noise arrays with steps first .. first+length-1 of the trajectory's
+ * noise. each array is its own stream (numbered in argument order) of the
+ * counter-based generator, so any block can be filled on its own.
+ */
+void um_set_noise(const noise_key_t *key, int first, double mean, double std_dev, int length, double *cn1, double *cn2);
 
-void pratt_set_noise(std::default_random_engine *g,
+void pratt_set_noise(const noise_key_t *key,
+                     int first,
                      double mean,
                      double std_dev,
                      int length,
@@ -168,7 +174,8 @@ void pratt_set_noise(std::default_random_engine *g,
                      double *cn_l1,
                      double *cn_l2);
 
-void indirect_britton_set_noise(std::default_random_engine *g,
+void indirect_britton_set_noise(const noise_key_t *key,
+                     int first,
                      double mean,
                      double std_dev,
                      int length,
@@ -179,7 +186,8 @@ void indirect_britton_set_noise(std::default_random_engine *g,
                      double *cn_l1,
                      double *cn_l2);
 
-void direct_britton_set_noise(std::default_random_engine *g,
+void direct_britton_set_noise(const noise_key_t *key,
+                     int first,
                      double mean,
                      double std_dev,
                      int length,
@@ -192,9 +200,11 @@ void direct_britton_set_noise(std::default_random_engine *g,
                      double *cn_l1,
                      double *cn_l2);
 
-void gaze_set_noise(std::default_random_engine *g,
+void gaze_set_noise(const noise_key_t *key,
+                    int first,
                     double mean,
                     double n_std_dev,
+                    double g_std_dev,
                     int length,
                     double *n_I1,
                     double *n_I2,
@@ -203,22 +213,157 @@ void gaze_set_noise(std::default_random_engine *g,
                     double *n_g1,
                     double *n_g2,
                     double *n_l1,
-                    double *n_l2);
+                    double *n_l2,
+                    double *n_gaze);
 
-/* the numerical approximations */
+/*
+ * integration methods: fixed step (see stepper.h), adaptive (see adaptive.h)
+ * and stochastic, with the noise as Brownian increments (see sde.h, ou.h)
+ */
+typedef enum {
+    METHOD_RK4 = 0,
+    METHOD_EULER,
+    METHOD_DOPRI5,
+    METHOD_EM,          /* Euler-Maruyama */
+    METHOD_MILSTEIN,    /* Milstein, which is Euler-Maruyama for the additive noise of um and gaze; not offered for the others (see sde.h), which run Euler-Maruyama */
+    METHOD_EXACT,       /* exact transitions of the linear um and gaze models (see ou.h); Euler-Maruyama for the others */
+    METHOD_COUNT
+} method_t;
+
+/*
+ * error tolerances for the adaptive method: per step, |error| <= atol + rtol*|y|
+ * in the rms over y1, y2. a step that would have to be shorter than min_step
+ * is taken at min_step whatever its error
+ */
+typedef struct adaptive_tol_s {
+    double rtol;        /* relative tolerance */
+    double atol;        /* absolute tolerance */
+    double min_step;    /* shortest step, 0 for none */
+} adaptive_tol_t;
+
+/* work done by an adaptive run */
+typedef struct adaptive_stats_s {
+    long rhs_evaluations;   /* right-hand side evaluations, including rejected steps */
+    long accepted;          /* accepted steps */
+    long rejected;          /* rejected steps */
+    double min_step;        /* smallest accepted step */
+    double max_step;        /* largest accepted step */
+} adaptive_stats_t;
+
+void adaptive_default_tol(adaptive_tol_t *tol);
+
+/* first passage boundaries a run can stop at */
+typedef enum {
+    BOUNDARY_NONE = 0,
+    BOUNDARY_DIFFERENCE,    /* |y1 - y2| reaches threshold */
+    BOUNDARY_NEST,          /* y1 or y2 reaches threshold */
+    BOUNDARY_QUORUM,        /* y1 or y2 reaches threshold * population */
+    BOUNDARY_COUNT
+} boundary_kind_t;
+
+typedef struct boundary_s {
+    boundary_kind_t kind;
+    double threshold;
+    double population;      /* the total a quorum is a fraction of */
+} boundary_t;
+
+/* where a run crossed its boundary */
+typedef struct decision_s {
+    int choice;             /* 1 or 2 for the side that crossed, 0 if none did */
+    double time;            /* crossing time, interpolated between steps; -1 if none */
+    int steps;              /* results that count: the step at or just past the crossing is steps-1 */
+    int written;            /* results the run wrote, steps or more: it stops at the end of a block */
+} decision_t;
+
+/*
+ * look for the first crossing among results from .. to (stride apart), the
+ * results before `from` being known not to cross. returns 1 and fills
+ * decision if found
+ */
+int boundary_scan(const boundary_t *boundary, double h, int from, int to, const double *results_y1, const double *results_y2, int stride, decision_t *decision);
+
+/*
+ * as boundary_scan, for results that hold just the steps from `first` on
+ * (row 0 being step first, which must be at most from-1 unless from is 0);
+ * the decision is in whole run steps all the same
+ */
+int boundary_scan_block(const boundary_t *boundary, double h, int first, int from, int to,
+                        const double *results_y1, const double *results_y2, int stride, decision_t *decision);
+
+/*
+ * the numerical approximations
+ *
+ * *_rk4 integrate the whole trajectory from the noise arrays in params.
+ * *_rk4_steps advance steps first .. first+count-1 of a trajectory whose
+ * results up to step `first` are already in place; the noise arrays then
+ * hold just those steps (index 0 is step `first`).
+ * *_integrate need no noise arrays: they generate the noise of `key` a
+ * small block at a time as they go and, for METHOD_RK4, give the same
+ * results as *_rk4 with arrays filled by *_set_noise. *_rk4_streamed is
+ * *_integrate with METHOD_RK4.
+ * *_adaptive integrate the noise-free model with adaptive steps to the
+ * given tolerances (the defaults if tol is null), writing the results on
+ * the same grid of step h; stats, if not null, is set to the work done.
+ * *_integrate with METHOD_DOPRI5 is *_adaptive with the default tolerances.
+ * With METHOD_EM and METHOD_MILSTEIN the noise of `key` is scaled by sqrt(h)
+ * as Brownian increments, so the results converge as h shrinks. METHOD_EXACT
+ * samples the limit they converge to directly, for the models it can (um
+ * and gaze): the results have the same distribution at any h.
+ * *_integrate_until is *_integrate that stops a block of steps after the
+ * first crossing of `boundary` (if not null) and reports it in decision;
+ * only decision->steps results are meaningful then. adaptive runs are
+ * scanned once they are done.
+ * *_jacobian set f to the noise-free right-hand side at (y1, y2) and jac to
+ * its Jacobian, jac[i][j] = d f[i] / d y[j], for the solvers in
+ * equilibrium.h. the ant models take the source as population - y1 - y2
+ * even below 0, where the integrators hold it at 0 (and the pratt model
+ * stops recruiting): the smooth system the integrators follow while any
+ * ants are left. the gaze model takes the inputs in force at the end of
+ * the run
+ */
 void usher_mcclelland_eulers(params_um_t *params, double *results_y1, double *results_y2);
 void usher_mcclelland_rk4(params_um_t *params, double * results_y1, double * results_y2);
+void usher_mcclelland_rk4_steps(params_um_t *params, int first, int count, double *results_y1, double *results_y2);
+void usher_mcclelland_rk4_streamed(const params_um_t *params, const noise_key_t *key, double *results_y1, double *results_y2);
+void usher_mcclelland_integrate(const params_um_t *params, method_t method, const noise_key_t *key, double *results_y1, double *results_y2);
+void usher_mcclelland_integrate_until(const params_um_t *params, method_t method, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision);
+void usher_mcclelland_adaptive(const params_um_t *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats);
+void usher_mcclelland_jacobian(const params_um_t *params, double y1, double y2, double f[2], double jac[2][2]);
 
 void pratt_rk4(params_pratt_t *params, double * results_y1, double * results_y2);
+void pratt_rk4_steps(params_pratt_t *params, int first, int count, double *results_y1, double *results_y2);
+void pratt_rk4_streamed(const params_pratt_t *params, const noise_key_t *key, double *results_y1, double *results_y2);
+void pratt_integrate(const params_pratt_t *params, method_t method, const noise_key_t *key, double *results_y1, double *results_y2);
+void pratt_integrate_until(const params_pratt_t *params, method_t method, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision);
+void pratt_adaptive(const params_pratt_t *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats);
+void pratt_jacobian(const params_pratt_t *params, double y1, double y2, double f[2], double jac[2][2]);
 double pratt_r_prime(double r_prime, double s, double cn);
 double pratt_s(double s, double y1, double y2);
 
 void indirect_britton_rk4(params_indirect_britton_t *params, double * results_y1, double * results_y2);
+void indirect_britton_rk4_steps(params_indirect_britton_t *params, int first, int count, double *results_y1, double *results_y2);
+void indirect_britton_rk4_streamed(const params_indirect_britton_t *params, const noise_key_t *key, double *results_y1, double *results_y2);
+void indirect_britton_integrate(const params_indirect_britton_t *params, method_t method, const noise_key_t *key, double *results_y1, double *results_y2);
+void indirect_britton_integrate_until(const params_indirect_britton_t *params, method_t method, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision);
+void indirect_britton_adaptive(const params_indirect_britton_t *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats);
+void indirect_britton_jacobian(const params_indirect_britton_t *params, double y1, double y2, double f[2], double jac[2][2]);
 double indirect_britton_s(double s, double y1, double y2);
 
 void direct_britton_rk4(params_direct_britton_t *params, double * results_y1, double * results_y2);
+void direct_britton_rk4_steps(params_direct_britton_t *params, int first, int count, double *results_y1, double *results_y2);
+void direct_britton_rk4_streamed(const params_direct_britton_t *params, const noise_key_t *key, double *results_y1, double *results_y2);
+void direct_britton_integrate(const params_direct_britton_t *params, method_t method, const noise_key_t *key, double *results_y1, double *results_y2);
+void direct_britton_integrate_until(const params_direct_britton_t *params, method_t method, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision);
+void direct_britton_adaptive(const params_direct_britton_t *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats);
+void direct_britton_jacobian(const params_direct_britton_t *params, double y1, double y2, double f[2], double jac[2][2]);
 double direct_britton_s(double s, double y1, double y2);
 
-void gaze_rk4(std::default_random_engine *g, params_gaze_t * params, double *results_y1, double *results_y2);
+void gaze_rk4(params_gaze_t * params, double *results_y1, double *results_y2);
+void gaze_rk4_steps(params_gaze_t *params, int first, int count, double *results_y1, double *results_y2);
+void gaze_rk4_streamed(const params_gaze_t *params, const noise_key_t *key, double *results_y1, double *results_y2);
+void gaze_integrate(const params_gaze_t *params, method_t method, const noise_key_t *key, double *results_y1, double *results_y2);
+void gaze_integrate_until(const params_gaze_t *params, method_t method, const noise_key_t *key, const boundary_t *boundary, double *results_y1, double *results_y2, decision_t *decision);
+void gaze_adaptive(const params_gaze_t *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats);
+void gaze_jacobian(const params_gaze_t *params, double y1, double y2, double f[2], double jac[2][2]);
 
 #endif // MODELS_H
@@ -0,0 +1,211 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include "model_registry.h"
+#include "models_batch.h"
+
+/*
+ * The lane kernels are written once (models_batch_kernels.inc) and compiled
+ * for each instruction set with the gcc/clang target pragma, so no special
+ * compiler flags are needed and the binary still runs on any x86-64 cpu;
+ * the widest supported set is picked at runtime. Other compilers and
+ * architectures get the scalar build only.
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_HAVE_X86
+#endif
+
+/* one lane, plain doubles: the fallback and the tail of odd sized batches */
+namespace batch_scalar {
+typedef double vd;
+static inline vd vload(const double *p) { return *p; }
+static inline void vstore(double *p, vd v) { *p = v; }
+static inline vd vset1(double x) { return x; }
+#include "models_batch_kernels.inc"
+}
+
+#ifdef BATCH_HAVE_X86
+
+#define BATCH_VECTOR_HELPERS(width) \
+    typedef double vd __attribute__((vector_size(8*(width)))); \
+    static inline vd vload(const double *p) { vd v; memcpy(&v, p, sizeof(v)); return v; } \
+    static inline void vstore(double *p, vd v) { memcpy(p, &v, sizeof(v)); } \
+    static inline vd vset1(double x) { vd v = {}; return v + x; }
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+namespace batch_sse2 {
+BATCH_VECTOR_HELPERS(2)
+#include "models_batch_kernels.inc"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace batch_avx2 {
+BATCH_VECTOR_HELPERS(4)
+#include "models_batch_kernels.inc"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace batch_avx512 {
+BATCH_VECTOR_HELPERS(8)
+#include "models_batch_kernels.inc"
+}
+#pragma GCC pop_options
+
+#endif // BATCH_HAVE_X86
+
+/*****************************************************************************
+ *
+ * Instruction set selection
+ *
+ *****************************************************************************/
+
+static batch_isa_t best_isa() {
+#ifdef BATCH_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return BATCH_AVX512;
+    if (__builtin_cpu_supports("avx2")) return BATCH_AVX2;
+    return BATCH_SSE2;
+#else
+    return BATCH_SCALAR;
+#endif
+}
+
+/*
+ * atomic, as -S or a benchmark may set it while other threads run kernels;
+ * relaxed, as it orders nothing else: a kernel reads it once and runs on
+ * whichever set it got, all of which give the same results
+ */
+static std::atomic<int> &current_isa() {
+    static std::atomic<int> isa(best_isa());
+    return isa;
+}
+
+batch_isa_t batch_isa() {
+    return (batch_isa_t)current_isa().load(std::memory_order_relaxed);
+}
+
+void batch_set_isa(batch_isa_t isa) {
+    batch_isa_t best = best_isa();
+    current_isa().store(isa > best ? best : isa, std::memory_order_relaxed);
+}
+
+const char *batch_isa_name(batch_isa_t isa) {
+    switch (isa) {
+        case BATCH_SSE2: return "sse2";
+        case BATCH_AVX2: return "avx2";
+        case BATCH_AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+int batch_isa_lanes(batch_isa_t isa) {
+    switch (isa) {
+        case BATCH_SSE2: return 2;
+        case BATCH_AVX2: return 4;
+        case BATCH_AVX512: return 8;
+        default: return 1;
+    }
+}
+
+/*****************************************************************************
+ *
+ * Batch kernels: full vectors first, then the remaining lanes one at a time
+ *
+ *****************************************************************************/
+
+#ifdef BATCH_HAVE_X86
+#define BATCH_DISPATCH(kernel, params, n, first, count, noise, results_y1, results_y2) \
+    do { \
+        batch_isa_t isa = batch_isa(); \
+        int width = batch_isa_lanes(isa); \
+        int lane = 0; \
+        for (; lane + width <= (n); lane += width) { \
+            switch (isa) { \
+                case BATCH_AVX512: batch_avx512::kernel(params, n, lane, first, count, noise, results_y1, results_y2); break; \
+                case BATCH_AVX2: batch_avx2::kernel(params, n, lane, first, count, noise, results_y1, results_y2); break; \
+                case BATCH_SSE2: batch_sse2::kernel(params, n, lane, first, count, noise, results_y1, results_y2); break; \
+                default: batch_scalar::kernel(params, n, lane, first, count, noise, results_y1, results_y2); break; \
+            } \
+        } \
+        for (; lane < (n); lane++) batch_scalar::kernel(params, n, lane, first, count, noise, results_y1, results_y2); \
+    } while (0)
+#else
+#define BATCH_DISPATCH(kernel, params, n, first, count, noise, results_y1, results_y2) \
+    do { \
+        for (int lane = 0; lane < (n); lane++) batch_scalar::kernel(params, n, lane, first, count, noise, results_y1, results_y2); \
+    } while (0)
+#endif
+
+/* step 0 of every trial from the initial conditions, then all the steps */
+#define BATCH_RUN(steps, params, n, noise, results_y1, results_y2) \
+    do { \
+        for (int lane = 0; lane < (n); lane++) { \
+            (results_y1)[lane] = (params)->y1_0; \
+            (results_y2)[lane] = (params)->y2_0; \
+        } \
+        steps(params, n, 0, model_length((params)->d, (params)->h) - 1, noise, results_y1, results_y2); \
+    } while (0)
+
+void usher_mcclelland_rk4_batch_steps(const params_um_t *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2) {
+    BATCH_DISPATCH(um_lanes, params, n, first, count, noise, results_y1, results_y2);
+}
+
+void usher_mcclelland_rk4_batch(const params_um_t *params, int n, const double *const *noise, double *results_y1, double *results_y2) {
+    BATCH_RUN(usher_mcclelland_rk4_batch_steps, params, n, noise, results_y1, results_y2);
+}
+
+void pratt_rk4_batch_steps(const params_pratt_t *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2) {
+    BATCH_DISPATCH(pratt_lanes, params, n, first, count, noise, results_y1, results_y2);
+}
+
+void pratt_rk4_batch(const params_pratt_t *params, int n, const double *const *noise, double *results_y1, double *results_y2) {
+    BATCH_RUN(pratt_rk4_batch_steps, params, n, noise, results_y1, results_y2);
+}
+
+void indirect_britton_rk4_batch_steps(const params_indirect_britton_t *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2) {
+    BATCH_DISPATCH(indirect_britton_lanes, params, n, first, count, noise, results_y1, results_y2);
+}
+
+void indirect_britton_rk4_batch(const params_indirect_britton_t *params, int n, const double *const *noise, double *results_y1, double *results_y2) {
+    BATCH_RUN(indirect_britton_rk4_batch_steps, params, n, noise, results_y1, results_y2);
+}
+
+void direct_britton_rk4_batch_steps(const params_direct_britton_t *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2) {
+    BATCH_DISPATCH(direct_britton_lanes, params, n, first, count, noise, results_y1, results_y2);
+}
+
+void direct_britton_rk4_batch(const params_direct_britton_t *params, int n, const double *const *noise, double *results_y1, double *results_y2) {
+    BATCH_RUN(direct_britton_rk4_batch_steps, params, n, noise, results_y1, results_y2);
+}
+
+void gaze_rk4_batch_steps(const params_gaze_t *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2) {
+    BATCH_DISPATCH(gaze_lanes, params, n, first, count, noise, results_y1, results_y2);
+}
+
+void gaze_rk4_batch(const params_gaze_t *params, int n, const double *const *noise, double *results_y1, double *results_y2) {
+    BATCH_RUN(gaze_rk4_batch_steps, params, n, noise, results_y1, results_y2);
+}
+
+void model_rk4_batch(model_t m, const void *params, int n, const double *const *noise, double *results_y1, double *results_y2) {
+    const model_desc_t *desc = model_desc(m);
+    if (desc == nullptr) return;
+    double y1_0 = 0., y2_0 = 0.;
+    model_get_param(m, params, "y1_0", &y1_0);
+    model_get_param(m, params, "y2_0", &y2_0);
+    for (int lane = 0; lane < n; lane++) {
+        results_y1[lane] = y1_0;
+        results_y2[lane] = y2_0;
+    }
+    desc->rk4_batch_steps(params, n, 0, model_params_length(m, params) - 1, noise, results_y1, results_y2);
+}
+
+void model_rk4_batch_steps(model_t m, const void *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2) {
+    const model_desc_t *desc = model_desc(m);
+    if (desc != nullptr) desc->rk4_batch_steps(params, n, first, count, noise, results_y1, results_y2);
+}
@@ -0,0 +1,68 @@
+#ifndef MODELS_BATCH_H
+#define MODELS_BATCH_H
+
+#include "simulation.h"
+
+/*
+ * Batched rk4 kernels: n independent trials of one parameter set advanced in
+ * lock step, one trial per vector lane.
+ *
+ * Data is interleaved by trial: the noise of channel c for trial j at step i
+ * is noise[c][i*n + j] and results are stored the same way. Channels are in
+ * the argument order of the model's *_set_noise function; the gaze model has
+ * a ninth channel holding the gaze offset drawn at each step.
+ * With the buffers from the buffer pool (see buffer_pool.h) and n a
+ * multiple of the widest vector, as a full ensemble chunk is, every row
+ * starts on a cache line, so no vector load or store is split across two.
+ *
+ * The arithmetic is the same, operation for operation, as the scalar
+ * kernels in models.cpp, so a batch reproduces the scalar results exactly.
+ */
+
+/* vector instruction set the batch kernels (and the noise generator) run on */
+typedef enum {
+    BATCH_SCALAR = 0,
+    BATCH_SSE2,
+    BATCH_AVX2,
+    BATCH_AVX512
+} batch_isa_t;
+
+/* the instruction set in use: the best the cpu supports unless overridden */
+batch_isa_t batch_isa();
+
+/*
+ * override the instruction set (e.g. for benchmarking), limited to what the
+ * cpu supports. any thread may call it at any time: a kernel call already
+ * running finishes on the set it started with
+ */
+void batch_set_isa(batch_isa_t isa);
+
+const char *batch_isa_name(batch_isa_t isa);
+
+/* doubles per vector for an instruction set */
+int batch_isa_lanes(batch_isa_t isa);
+
+/*
+ * *_rk4_batch run all the steps of n trials from the initial conditions.
+ * *_rk4_batch_steps advance steps first .. first+count-1 from the results
+ * already in place at step `first`; the noise and the results then hold
+ * just those steps (row 0 is step `first`, and the results rows 1 .. count
+ * are written), so long runs can be fed a block at a time through buffers
+ * of a block.
+ */
+void usher_mcclelland_rk4_batch(const params_um_t *params, int n, const double *const *noise, double *results_y1, double *results_y2);
+void pratt_rk4_batch(const params_pratt_t *params, int n, const double *const *noise, double *results_y1, double *results_y2);
+void indirect_britton_rk4_batch(const params_indirect_britton_t *params, int n, const double *const *noise, double *results_y1, double *results_y2);
+void direct_britton_rk4_batch(const params_direct_britton_t *params, int n, const double *const *noise, double *results_y1, double *results_y2);
+void gaze_rk4_batch(const params_gaze_t *params, int n, const double *const *noise, double *results_y1, double *results_y2);
+
+void usher_mcclelland_rk4_batch_steps(const params_um_t *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2);
+void pratt_rk4_batch_steps(const params_pratt_t *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2);
+void indirect_britton_rk4_batch_steps(const params_indirect_britton_t *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2);
+void direct_britton_rk4_batch_steps(const params_direct_britton_t *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2);
+void gaze_rk4_batch_steps(const params_gaze_t *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2);
+
+void model_rk4_batch(model_t m, const void *params, int n, const double *const *noise, double *results_y1, double *results_y2);
+void model_rk4_batch_steps(model_t m, const void *params, int n, int first, int count, const double *const *noise, double *results_y1, double *results_y2);
+
+#endif // MODELS_BATCH_H
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "optimize.h"
+
+/* Nelder-Mead coefficients: reflection, expansion, contraction, shrink */
+#define NM_REFLECT 1.0
+#define NM_EXPAND 2.0
+#define NM_CONTRACT 0.5
+#define NM_SHRINK 0.5
+
+/* size of the starting simplex, as a fraction of each parameter's range */
+#define NM_INITIAL_STEP 0.1
+
+/* accuracy shortfall that costs a whole run under OBJECTIVE_DECISION_TIME */
+#define OPTIMIZE_PENALTY_STEP 0.01
+
+const char *objective_name(objective_t objective) {
+    switch (objective) {
+        case OBJECTIVE_REWARD_RATE: return "reward_rate";
+        case OBJECTIVE_DECISION_TIME: return "decision_time";
+        default: return "unknown";
+    }
+}
+
+int objective_from_name(const char *name) {
+    for (int objective=0; objective<OBJECTIVE_COUNT; objective++) {
+        if (strcmp(name, objective_name((objective_t)objective)) == 0) return objective;
+    }
+    return -1;
+}
+
+/* the state of a search: the buffers every evaluation reuses */
+typedef struct optimizer_s {
+    const optimize_t *opt;
+    optimize_trace_t trace;
+    void *user;
+    std::vector<char> params;
+    std::vector<trial_outcome_t> outcomes;
+    optimize_eval_t best;
+    int evaluations;
+    bool stopped;
+} optimizer_t;
+
+/*
+ * score the candidate at u (each coordinate in [0, 1] of its range); the
+ * returned cost is minimised
+ */
+static double evaluate(optimizer_t *o, const double *u) {
+    const optimize_t *opt = o->opt;
+    optimize_eval_t eval;
+    eval.evaluation = ++o->evaluations;
+
+    memcpy(o->params.data(), opt->params, o->params.size());
+    void *p = o->params.data();
+    for (int v=0; v<opt->n_vars; v++) {
+        const optimize_var_t *var = &opt->vars[v];
+        model_set_param_value(opt->m, p, var->name, var->lo + (var->hi - var->lo) * u[v]);
+        model_get_param(opt->m, p, var->name, &eval.values[v]);
+    }
+
+    boundary_t boundary;
+    if (opt->boundary != nullptr) {
+        boundary = *opt->boundary;
+        model_get_param(opt->m, p, "population", &boundary.population);
+    }
+    run_ensemble(opt->m, opt->method, p, opt->n_trials, opt->threads,
+                 opt->boundary != nullptr ? &boundary : nullptr, o->outcomes.data(), nullptr);
+
+    double h, duration;
+    model_get_param(opt->m, p, "h", &h);
+    duration = (model_params_length(opt->m, p) - 1) * h;
+    int correct = 0;
+    double total_time = 0.;
+    for (int j=0; j<opt->n_trials; j++) {
+        const trial_outcome_t *t = &o->outcomes[j];
+        if (t->choice == opt->correct) correct++;
+        total_time += t->choice != 0 ? t->decision_time : duration;
+    }
+    eval.accuracy = (double)correct / opt->n_trials;
+    eval.mean_time = total_time / opt->n_trials;
+
+    double cost;
+    if (opt->objective == OBJECTIVE_REWARD_RATE) {
+        eval.objective = eval.accuracy / (eval.mean_time + opt->inter_trial);
+        cost = -eval.objective;
+    } else {
+        double shortfall = opt->target_accuracy - eval.accuracy;
+        eval.objective = eval.mean_time + (shortfall > 0.0 ? shortfall / OPTIMIZE_PENALTY_STEP * duration : 0.0);
+        cost = eval.objective;
+    }
+
+    bool better = o->evaluations == 1 ||
+        (opt->objective == OBJECTIVE_REWARD_RATE ? eval.objective > o->best.objective : eval.objective < o->best.objective);
+    if (better) o->best = eval;
+    if (o->trace != nullptr && o->trace(&eval, o->user) != 0) o->stopped = true;
+    return cost;
+}
+
+optimize_status_t run_optimize(const optimize_t *opt, optimize_trace_t trace, void *user, optimize_eval_t *best) {
+    if (opt->max_evaluations < 1) return OPTIMIZE_EMPTY;
+
+    optimizer_t o;
+    o.opt = opt;
+    o.trace = trace;
+    o.user = user;
+    o.params.resize(model_params_size(opt->m));
+    o.outcomes.resize(opt->n_trials);
+    o.evaluations = 0;
+    o.stopped = false;
+
+    const int n = opt->n_vars;
+    auto done = [&]() { return o.stopped || o.evaluations >= opt->max_evaluations; };
+
+    /* the starting point, in [0, 1] coordinates */
+    std::vector<double> start(n);
+    for (int v=0; v<n; v++) {
+        const optimize_var_t *var = &opt->vars[v];
+        double value = var->lo;
+        model_get_param(opt->m, opt->params, var->name, &value);
+        start[v] = var->hi > var->lo ? (value - var->lo) / (var->hi - var->lo) : 0.0;
+        start[v] = std::min(1.0, std::max(0.0, start[v]));
+    }
+
+    /* the starting simplex: the start and a step along each axis, inwards at a bound */
+    std::vector<std::vector<double> > simplex(n+1, start);
+    std::vector<double> cost(n+1);
+    for (int v=0; v<n; v++) {
+        simplex[v+1][v] += start[v] + NM_INITIAL_STEP <= 1.0 ? NM_INITIAL_STEP : -NM_INITIAL_STEP;
+    }
+    for (int k=0; k<=n && !done(); k++) cost[k] = evaluate(&o, simplex[k].data());
+    if (n == 0) {
+        *best = o.best;
+        return o.stopped ? OPTIMIZE_STOPPED : OPTIMIZE_CONVERGED;
+    }
+
+    std::vector<double> centroid(n), reflected(n), trial(n);
+    auto towards = [&](double t, const std::vector<double> &from, std::vector<double> &out) {
+        /* centroid + t (centroid - from), clamped to the box */
+        for (int v=0; v<n; v++) out[v] = std::min(1.0, std::max(0.0, centroid[v] + t * (centroid[v] - from[v])));
+    };
+
+    optimize_status_t status = OPTIMIZE_EXHAUSTED;
+    while (!done()) {
+        /* order by cost, best first */
+        std::vector<int> order(n+1);
+        for (int k=0; k<=n; k++) order[k] = k;
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return cost[a] < cost[b]; });
+        std::vector<std::vector<double> > sorted_simplex(n+1);
+        std::vector<double> sorted_cost(n+1);
+        for (int k=0; k<=n; k++) {
+            sorted_simplex[k] = simplex[order[k]];
+            sorted_cost[k] = cost[order[k]];
+        }
+        simplex.swap(sorted_simplex);
+        cost.swap(sorted_cost);
+
+        double size = 0.;
+        for (int k=1; k<=n; k++) {
+            for (int v=0; v<n; v++) size = std::max(size, fabs(simplex[k][v] - simplex[0][v]));
+        }
+        if (size <= opt->tolerance) {
+            status = OPTIMIZE_CONVERGED;
+            break;
+        }
+
+        for (int v=0; v<n; v++) {
+            centroid[v] = 0.;
+            for (int k=0; k<n; k++) centroid[v] += simplex[k][v];
+            centroid[v] /= n;
+        }
+
+        towards(NM_REFLECT, simplex[n], reflected);
+        double reflected_cost = evaluate(&o, reflected.data());
+        if (done()) break;
+
+        if (reflected_cost < cost[0]) {
+            towards(NM_EXPAND, simplex[n], trial);
+            double expanded_cost = evaluate(&o, trial.data());
+            if (expanded_cost < reflected_cost) {
+                simplex[n] = trial;
+                cost[n] = expanded_cost;
+            } else {
+                simplex[n] = reflected;
+                cost[n] = reflected_cost;
+            }
+        } else if (reflected_cost < cost[n-1]) {
+            simplex[n] = reflected;
+            cost[n] = reflected_cost;
+        } else {
+            /* contract towards the reflection if it beat the worst, else towards the worst */
+            bool outside = reflected_cost < cost[n];
+            towards(-NM_CONTRACT, outside ? reflected : simplex[n], trial);
+            double contracted_cost = evaluate(&o, trial.data());
+            if (contracted_cost < (outside ? reflected_cost : cost[n])) {
+                simplex[n] = trial;
+                cost[n] = contracted_cost;
+            } else {
+                /* shrink everything towards the best */
+                for (int k=1; k<=n && !done(); k++) {
+                    for (int v=0; v<n; v++) simplex[k][v] = simplex[0][v] + NM_SHRINK * (simplex[k][v] - simplex[0][v]);
+                    cost[k] = evaluate(&o, simplex[k].data());
+                }
+            }
+        }
+    }
+    if (o.stopped) status = OPTIMIZE_STOPPED;
+
+    *best = o.best;
+    return status;
+}
@@ -0,0 +1,87 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include "ensemble.h"
+
+/*
+ * Searching a model's parameters for the best speed-accuracy trade-off.
+ *
+ * Each candidate is scored by a Monte Carlo ensemble (run_ensemble, on all
+ * threads). Every candidate runs the same trials with the same noise, the
+ * trials of the base seed: common random numbers, so two candidates differ
+ * only by their parameters and the search sees a smooth, repeatable
+ * objective rather than one that jitters with the sampling noise. The
+ * search itself is Nelder-Mead over the box the parameters are bounded to,
+ * which needs no gradients.
+ */
+
+/* most parameters searched at once */
+#define OPTIMIZE_MAX_VARS 8
+
+typedef enum {
+    OBJECTIVE_REWARD_RATE = 0,  /* maximise accuracy / (mean decision time + inter-trial interval) */
+    OBJECTIVE_DECISION_TIME,    /* minimise the mean decision time, each 1% of accuracy short of
+                                   the target costing as much as a whole run */
+    OBJECTIVE_COUNT
+} objective_t;
+
+/* one searched parameter, over [lo, hi] */
+typedef struct optimize_var_s {
+    const char *name;       /* parameter name, as for model_set_param */
+    double lo;
+    double hi;
+} optimize_var_t;
+
+typedef struct optimize_s {
+    model_t m;
+    method_t method;
+    const void *params;         /* the starting point, every other parameter and the seed of the trials */
+    int n_vars;
+    optimize_var_t vars[OPTIMIZE_MAX_VARS];
+    objective_t objective;
+    int correct;                /* the choice that is correct, 1 or 2 */
+    double target_accuracy;     /* for OBJECTIVE_DECISION_TIME */
+    double inter_trial;         /* for OBJECTIVE_REWARD_RATE: time from a decision to the next trial */
+    int n_trials;               /* trials per candidate */
+    int threads;                /* 0 for one per core */
+    const boundary_t *boundary; /* a quorum's population is taken from each candidate */
+    int max_evaluations;
+    double tolerance;           /* stop once the simplex is this small, as a fraction of each range */
+} optimize_t;
+
+/*
+ * a scored candidate. accuracy is the fraction of trials choosing the
+ * correct option; undecided trials count as wrong, and as taking the whole
+ * run in the mean decision time
+ */
+typedef struct optimize_eval_s {
+    int evaluation;                     /* 1 for the first */
+    double values[OPTIMIZE_MAX_VARS];   /* as set (int parameters rounded) */
+    double objective;                   /* reward rate, or mean decision time plus the penalty */
+    double accuracy;
+    double mean_time;
+} optimize_eval_t;
+
+/* how a search ended */
+typedef enum {
+    OPTIMIZE_CONVERGED = 0,     /* the simplex shrank to the tolerance */
+    OPTIMIZE_EXHAUSTED,         /* max_evaluations were used up */
+    OPTIMIZE_STOPPED,           /* the trace asked to stop */
+    OPTIMIZE_EMPTY              /* nothing was scored: max_evaluations is below 1 */
+} optimize_status_t;
+
+/* sees every candidate as it is scored; a nonzero return stops the search */
+typedef int (*optimize_trace_t)(const optimize_eval_t *eval, void *user);
+
+/* objective names as used on the command line ("reward_rate", "decision_time") */
+const char *objective_name(objective_t objective);
+int objective_from_name(const char *name); /* -1 if unknown */
+
+/*
+ * run the search from the values in opt->params (clamped to the bounds),
+ * setting best to the best candidate found. trace may be null. with
+ * OPTIMIZE_EMPTY no candidate was scored, and best is left as it was
+ */
+optimize_status_t run_optimize(const optimize_t *opt, optimize_trace_t trace, void *user, optimize_eval_t *best);
+
+#endif // OPTIMIZE_H
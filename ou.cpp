@@ -0,0 +1,154 @@
+#include <cmath>
+#include "ou.h"
+
+/* largest matrix matrix_exp is used on: the 4 x 4 of ou_transition's covariance */
+#define MATRIX_EXP_MAX 4
+
+/* order of the Pade approximant, enough for double precision once the norm is below 1/2 */
+#define MATRIX_EXP_PADE 6
+
+static void matrix_multiply(int n, const double *a, const double *b, double *result) {
+    for (int i=0; i<n; i++) {
+        for (int j=0; j<n; j++) {
+            double sum = 0.;
+            for (int k=0; k<n; k++) sum += a[i*n+k] * b[k*n+j];
+            result[i*n+j] = sum;
+        }
+    }
+}
+
+/* solves d x = nn for x (n x n, row major) by Gaussian elimination with partial pivoting; d and nn are overwritten */
+static void matrix_solve(int n, double *d, double *nn, double *x) {
+    for (int col=0; col<n; col++) {
+        int pivot = col;
+        for (int r=col+1; r<n; r++) {
+            if (fabs(d[r*n+col]) > fabs(d[pivot*n+col])) pivot = r;
+        }
+        if (pivot != col) {
+            for (int k=0; k<n; k++) {
+                double tmp = d[col*n+k]; d[col*n+k] = d[pivot*n+k]; d[pivot*n+k] = tmp;
+                tmp = nn[col*n+k]; nn[col*n+k] = nn[pivot*n+k]; nn[pivot*n+k] = tmp;
+            }
+        }
+        for (int r=col+1; r<n; r++) {
+            double f = d[r*n+col] / d[col*n+col];
+            if (f == 0.0) continue;
+            for (int k=col; k<n; k++) d[r*n+k] -= f * d[col*n+k];
+            for (int k=0; k<n; k++) nn[r*n+k] -= f * nn[col*n+k];
+        }
+    }
+    for (int r=n-1; r>=0; r--) {
+        for (int k=0; k<n; k++) {
+            double sum = nn[r*n+k];
+            for (int c=r+1; c<n; c++) sum -= d[r*n+c] * x[c*n+k];
+            x[r*n+k] = sum / d[r*n+r];
+        }
+    }
+}
+
+/* Golub & Van Loan, Matrix Computations, algorithm 11.3.1 */
+void matrix_exp(int n, const double *a, double *result) {
+    double norm = 0.;
+    for (int i=0; i<n; i++) {
+        double row = 0.;
+        for (int j=0; j<n; j++) row += fabs(a[i*n+j]);
+        if (row > norm) norm = row;
+    }
+
+    /* scale so that the norm is at most 1/2 */
+    int squarings = 0;
+    if (norm > 0.0) {
+        frexp(norm, &squarings);    /* norm < 2^squarings */
+        squarings += 1;
+        if (squarings < 0) squarings = 0;
+    }
+    double scale = ldexp(1.0, -squarings);
+
+    double s[MATRIX_EXP_MAX*MATRIX_EXP_MAX], x[MATRIX_EXP_MAX*MATRIX_EXP_MAX], tmp[MATRIX_EXP_MAX*MATRIX_EXP_MAX];
+    double num[MATRIX_EXP_MAX*MATRIX_EXP_MAX], den[MATRIX_EXP_MAX*MATRIX_EXP_MAX];
+    for (int i=0; i<n*n; i++) {
+        s[i] = a[i] * scale;
+        x[i] = num[i] = den[i] = (i % (n+1) == 0) ? 1.0 : 0.0;
+    }
+
+    const int q = MATRIX_EXP_PADE;
+    double c = 1.0;
+    for (int k=1; k<=q; k++) {
+        c = c * (q-k+1) / (k * (2*q-k+1));
+        matrix_multiply(n, s, x, tmp);
+        for (int i=0; i<n*n; i++) {
+            x[i] = tmp[i];
+            num[i] += c * x[i];
+            den[i] += (k % 2 == 0 ? c : -c) * x[i];
+        }
+    }
+    matrix_solve(n, den, num, result);
+
+    for (int k=0; k<squarings; k++) {
+        matrix_multiply(n, result, result, tmp);
+        for (int i=0; i<n*n; i++) result[i] = tmp[i];
+    }
+}
+
+/* t->l from t->sigma, which may be only semidefinite */
+static void ou_cholesky(ou_transition_t *t) {
+    double s12 = (t->sigma[0][1] + t->sigma[1][0]) / 2;
+    t->sigma[0][1] = t->sigma[1][0] = s12;
+    double l11 = t->sigma[0][0] > 0.0 ? sqrt(t->sigma[0][0]) : 0.0;
+    double l21 = l11 > 0.0 ? s12 / l11 : 0.0;
+    double rest = t->sigma[1][1] - l21 * l21;
+    t->l[0][0] = l11;
+    t->l[0][1] = 0.0;
+    t->l[1][0] = l21;
+    t->l[1][1] = rest > 0.0 ? sqrt(rest) : 0.0;
+}
+
+void ou_transition(const ou_system_t *s, double dt, ou_transition_t *t) {
+    /* exp([a b; 0 0] dt) = [phi c; 0 1] */
+    double m[9] = {s->a[0][0]*dt, s->a[0][1]*dt, s->b[0]*dt,
+                   s->a[1][0]*dt, s->a[1][1]*dt, s->b[1]*dt,
+                   0.0, 0.0, 0.0};
+    double e[9];
+    matrix_exp(3, m, e);
+    t->phi[0][0] = e[0]; t->phi[0][1] = e[1]; t->c[0] = e[2];
+    t->phi[1][0] = e[3]; t->phi[1][1] = e[4]; t->c[1] = e[5];
+
+    /* exp([-a q; 0 a^T] dt) = [. g; 0 phi^T], and sigma = phi g */
+    double v[16] = {-s->a[0][0]*dt, -s->a[0][1]*dt, s->q[0][0]*dt, s->q[0][1]*dt,
+                    -s->a[1][0]*dt, -s->a[1][1]*dt, s->q[1][0]*dt, s->q[1][1]*dt,
+                    0.0, 0.0, s->a[0][0]*dt, s->a[1][0]*dt,
+                    0.0, 0.0, s->a[0][1]*dt, s->a[1][1]*dt};
+    double f[16];
+    matrix_exp(4, v, f);
+    for (int i=0; i<2; i++) {
+        for (int j=0; j<2; j++) {
+            t->sigma[i][j] = t->phi[i][0] * f[0*4 + 2+j] + t->phi[i][1] * f[1*4 + 2+j];
+        }
+    }
+    ou_cholesky(t);
+}
+
+void ou_compose(const ou_transition_t *first, const ou_transition_t *second, ou_transition_t *t) {
+    ou_transition_t r;
+    for (int i=0; i<2; i++) {
+        r.c[i] = second->phi[i][0] * first->c[0] + second->phi[i][1] * first->c[1] + second->c[i];
+        for (int j=0; j<2; j++) {
+            r.phi[i][j] = second->phi[i][0] * first->phi[0][j] + second->phi[i][1] * first->phi[1][j];
+        }
+    }
+
+    /* second->phi first->sigma second->phi^T + second->sigma */
+    double ps[2][2];
+    for (int i=0; i<2; i++) {
+        for (int j=0; j<2; j++) {
+            ps[i][j] = second->phi[i][0] * first->sigma[0][j] + second->phi[i][1] * first->sigma[1][j];
+        }
+    }
+    for (int i=0; i<2; i++) {
+        for (int j=0; j<2; j++) {
+            r.sigma[i][j] = ps[i][0] * second->phi[j][0] + ps[i][1] * second->phi[j][1] + second->sigma[i][j];
+        }
+    }
+    ou_cholesky(&r);
+    *t = r;
+}
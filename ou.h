@@ -0,0 +1,83 @@
+#ifndef OU_H
+#define OU_H
+
+/*
+ * Exact transitions of two variable Ornstein-Uhlenbeck processes,
+ *
+ *   dy = (a y + b) dt + dW,   dW having covariance q dt,
+ *
+ * the linear models (Usher-McClelland, and the gaze model between its gaze
+ * switches) read as Ito SDEs with the noise as Brownian increments, as in
+ * sde.h. Over a time dt the state moves to
+ *
+ *   y(t+dt) = phi y(t) + c + xi,   xi ~ N(0, sigma)
+ *
+ * with phi = exp(a dt), c = int_0^dt exp(a s) ds b and sigma =
+ * int_0^dt exp(a s) q exp(a^T s) ds, all found from matrix exponentials
+ * (Van Loan 1978, "Computing integrals involving the matrix exponential").
+ * Nothing is approximated, so the step can be as long as the spacing of
+ * the results wanted.
+ */
+
+typedef struct ou_system_s {
+    double a[2][2];     /* drift matrix */
+    double b[2];        /* constant drift */
+    double q[2][2];     /* noise covariance per unit time */
+} ou_system_t;
+
+/* y(t+dt) = phi y(t) + c + l z, z a pair of independent standard normals */
+typedef struct ou_transition_s {
+    double phi[2][2];
+    double c[2];
+    double sigma[2][2]; /* covariance of the noise added */
+    double l[2][2];     /* lower triangular, l l^T = sigma */
+} ou_transition_t;
+
+/* exp(a) of the n x n row major matrix a, by scaling and squaring with a (6,6) Pade approximant */
+void matrix_exp(int n, const double *a, double *result);
+
+/* the transition of system s over a time dt */
+void ou_transition(const ou_system_t *s, double dt, ou_transition_t *t);
+
+/* the transition `first` followed by `second` */
+void ou_compose(const ou_transition_t *first, const ou_transition_t *second, ou_transition_t *t);
+
+static inline void ou_step(const ou_transition_t *t, double z1, double z2, double *y1, double *y2) {
+    double n1 = t->phi[0][0] * *y1 + t->phi[0][1] * *y2 + t->c[0] + t->l[0][0] * z1;
+    double n2 = t->phi[1][0] * *y1 + t->phi[1][1] * *y2 + t->c[1] + (t->l[1][0] * z1 + t->l[1][1] * z2);
+    *y1 = n1;
+    *y2 = n2;
+}
+
+/*
+ * the OU system of a model that is affine in its state and noise, read off
+ * a sde.h system at step i: b is the drift at 0, the columns of a the drift
+ * at the unit vectors less b, and q the sum over the noise channels of
+ * std_dev^2 b_c b_c^T. exact for the linear models only
+ */
+template <class System>
+void ou_linearise(const System &s, int i, ou_system_t *o) {
+    double b1, b2, e1, e2;
+    s.eval(i, nullptr, 0.0, 0.0, &b1, &b2);
+    o->b[0] = b1;
+    o->b[1] = b2;
+    s.eval(i, nullptr, 1.0, 0.0, &e1, &e2);
+    o->a[0][0] = e1 - b1;
+    o->a[1][0] = e2 - b2;
+    s.eval(i, nullptr, 0.0, 1.0, &e1, &e2);
+    o->a[0][1] = e1 - b1;
+    o->a[1][1] = e2 - b2;
+
+    o->q[0][0] = o->q[0][1] = o->q[1][0] = o->q[1][1] = 0.;
+    for (int c=0; c<s.channels; c++) {
+        double c1, c2;
+        s.column(i, c, 0.0, 0.0, b1, b2, &c1, &c2);
+        double var = s.std_dev[c] * s.std_dev[c];
+        o->q[0][0] += var * c1 * c1;
+        o->q[0][1] += var * c1 * c2;
+        o->q[1][1] += var * c2 * c2;
+    }
+    o->q[1][0] = o->q[0][1];
+}
+
+#endif // OU_H
@@ -0,0 +1,65 @@
+#!/bin/sh
+# compare the output of insect_decision_cli with the reference output listed in
+# reference/cases, byte for byte, for every model and integration method. also
+# check that an archive of trials stopped at their boundary (-W) stays sparse.
+#
+#   reference/check.sh path/to/insect_decision_cli        check, exit 1 on any difference
+#   reference/check.sh -u path/to/insect_decision_cli     write the reference output anew
+#
+# only rewrite it for a change meant to alter the results, and say so in the commit.
+
+update=0
+if [ "$1" = "-u" ]; then
+    update=1
+    shift
+fi
+if [ $# -ne 1 ]; then
+    echo "usage: $0 [-u] path/to/insect_decision_cli" >&2
+    exit 2
+fi
+cli=$1
+dir=$(dirname "$0")
+out=$(mktemp)
+archive=$(mktemp)
+trap 'rm -f "$out" "$archive"' EXIT
+
+failed=0
+checked=0
+while read -r file args; do
+    case "$file" in
+        ''|'#'*) continue ;;
+    esac
+    # the arguments are split on spaces, as written in cases
+    if ! "$cli" $args > "$out" 2> /dev/null; then
+        echo "FAIL $file: $cli $args exited with an error"
+        failed=$((failed + 1))
+    elif [ $update -eq 1 ]; then
+        cp "$out" "$dir/$file"
+    elif ! cmp -s "$out" "$dir/$file"; then
+        echo "FAIL $file: $cli $args"
+        failed=$((failed + 1))
+    fi
+    checked=$((checked + 1))
+done < "$dir/cases"
+
+if [ $update -eq 1 ]; then
+    echo "wrote $checked reference files"
+    exit 0
+fi
+
+# 100 trials of 500000 steps that decide within a few thousand: only the
+# pages the trials wrote should take space, not the 800 MB of the file
+if ! "$cli" -W "$archive" -n 100 -t 0.3 um d=5000 h=0.01 2> /dev/null; then
+    echo "FAIL sparse archive: $cli -W exited with an error"
+    failed=$((failed + 1))
+else
+    size=$(($(wc -c < "$archive") / 1024))
+    used=$(du -k "$archive" | cut -f 1)
+    if [ $((used * 50)) -gt $size ]; then
+        echo "FAIL sparse archive: $used KB on disk of $size KB"
+        failed=$((failed + 1))
+    fi
+fi
+checked=$((checked + 1))
+echo "$checked checked, $failed different"
+[ $failed -eq 0 ]
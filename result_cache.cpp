@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "result_cache.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+typedef struct cache_entry_s {
+    uint64_t hash;
+    model_t m;
+    method_t method;
+    std::vector<double> values;     /* the parameters, in table order */
+    std::vector<double> results_y1;
+    std::vector<double> results_y2;
+} cache_entry_t;
+
+struct result_cache_s {
+    size_t max_bytes;
+    size_t bytes;
+    std::list<cache_entry_t> entries;   /* most recently used first */
+    std::unordered_map<uint64_t, std::list<cache_entry_t>::iterator> index;
+    long hits;
+    long misses;
+    long evictions;
+};
+
+/* the parameter values in table order, -0 read as 0 so equal values hash alike */
+static void params_values(model_t m, const void *params, std::vector<double> *values) {
+    int count;
+    const param_info_t *info = model_param_info(m, &count);
+    values->resize(count);
+    for (int i=0; i<count; i++) {
+        double v = 0.;
+        model_get_param(m, params, info[i].name, &v);
+        (*values)[i] = v == 0.0 ? 0.0 : v;
+    }
+}
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i=0; i<size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t values_hash(model_t m, method_t method, const std::vector<double> &values) {
+    uint32_t ids[2] = {(uint32_t)m, (uint32_t)method};
+    uint64_t hash = fnv1a(FNV_OFFSET, ids, sizeof(ids));
+    return fnv1a(hash, values.data(), values.size() * sizeof(double));
+}
+
+uint64_t model_params_hash(model_t m, method_t method, const void *params) {
+    std::vector<double> values;
+    params_values(m, params, &values);
+    return values_hash(m, method, values);
+}
+
+static size_t entry_bytes(const cache_entry_t &e) {
+    return (e.results_y1.size() + e.results_y2.size()) * sizeof(double);
+}
+
+result_cache_t *result_cache_create(size_t max_bytes) {
+    result_cache_t *cache = new result_cache_t;
+    cache->max_bytes = max_bytes;
+    cache->bytes = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    return cache;
+}
+
+void result_cache_destroy(result_cache_t *cache) {
+    delete cache;
+}
+
+/* the entry for values, moved to the front, or null; a colliding entry is dropped */
+static cache_entry_t *find_entry(result_cache_t *cache, uint64_t hash, model_t m, method_t method,
+                                 const std::vector<double> &values) {
+    auto found = cache->index.find(hash);
+    if (found == cache->index.end()) return nullptr;
+    const cache_entry_t &e = *found->second;
+    if (e.m == m && e.method == method && e.values == values) {
+        cache->entries.splice(cache->entries.begin(), cache->entries, found->second);
+        return &cache->entries.front();
+    }
+
+    /* a different run with the same hash: it makes way for this one */
+    cache->bytes -= entry_bytes(e);
+    cache->entries.erase(found->second);
+    cache->index.erase(found);
+    return nullptr;
+}
+
+/* a new entry at the front for length results, not yet filled */
+static cache_entry_t *add_entry(result_cache_t *cache, uint64_t hash, model_t m, method_t method,
+                                std::vector<double> *values, int length) {
+    cache->entries.push_front(cache_entry_t());
+    cache_entry_t &e = cache->entries.front();
+    e.hash = hash;
+    e.m = m;
+    e.method = method;
+    e.values.swap(*values);
+    e.results_y1.resize(length);
+    e.results_y2.resize(length);
+    cache->index[hash] = cache->entries.begin();
+    cache->bytes += entry_bytes(e);
+    return &e;
+}
+
+/* back within the budget, least recently used first, keeping the newest run */
+static void evict(result_cache_t *cache) {
+    while (cache->bytes > cache->max_bytes && cache->entries.size() > 1) {
+        const cache_entry_t &last = cache->entries.back();
+        cache->bytes -= entry_bytes(last);
+        cache->index.erase(last.hash);
+        cache->entries.pop_back();
+        cache->evictions++;
+    }
+}
+
+int result_cache_lookup(result_cache_t *cache, model_t m, method_t method, const void *params,
+                        const double **results_y1, const double **results_y2) {
+    std::vector<double> values;
+    params_values(m, params, &values);
+    cache_entry_t *e = find_entry(cache, values_hash(m, method, values), m, method, values);
+    if (e == nullptr) return 0;
+
+    cache->hits++;
+    *results_y1 = e->results_y1.data();
+    *results_y2 = e->results_y2.data();
+    return (int)e->results_y1.size();
+}
+
+int result_cache_lookup_shorter(result_cache_t *cache, model_t m, method_t method, const void *params, int *d,
+                                const double **results_y1, const double **results_y2) {
+    int count;
+    const param_info_t *info = model_param_info(m, &count);
+    int d_index = -1;
+    for (int i=0; i<count; i++) {
+        if (strcmp(info[i].name, "d") == 0) d_index = i;
+    }
+    if (d_index < 0) return 0;
+
+    std::vector<double> values;
+    params_values(m, params, &values);
+
+    /* every value but d the same, and d the longest below the one asked for */
+    std::list<cache_entry_t>::iterator best = cache->entries.end();
+    for (auto it=cache->entries.begin(); it!=cache->entries.end(); ++it) {
+        const cache_entry_t &e = *it;
+        if (e.m != m || e.method != method || e.values[d_index] >= values[d_index]) continue;
+        if (best != cache->entries.end() && e.values[d_index] <= best->values[d_index]) continue;
+        bool same = true;
+        for (int i=0; i<count && same; i++) same = i == d_index || e.values[i] == values[i];
+        if (same) best = it;
+    }
+    if (best == cache->entries.end()) return 0;
+
+    cache->entries.splice(cache->entries.begin(), cache->entries, best);
+    const cache_entry_t &e = cache->entries.front();
+    *d = (int)e.values[d_index];
+    *results_y1 = e.results_y1.data();
+    *results_y2 = e.results_y2.data();
+    return (int)e.results_y1.size();
+}
+
+void result_cache_insert(result_cache_t *cache, model_t m, method_t method, const void *params,
+                         const double *results_y1, const double *results_y2, int length) {
+    std::vector<double> values;
+    params_values(m, params, &values);
+    uint64_t hash = values_hash(m, method, values);
+
+    cache->misses++;
+    cache_entry_t *e = find_entry(cache, hash, m, method, values);
+    if (e == nullptr) e = add_entry(cache, hash, m, method, &values, length);
+    std::copy(results_y1, results_y1 + length, e->results_y1.begin());
+    std::copy(results_y2, results_y2 + length, e->results_y2.begin());
+    evict(cache);
+}
+
+void result_cache_clear(result_cache_t *cache) {
+    cache->entries.clear();
+    cache->index.clear();
+    cache->bytes = 0;
+}
+
+void result_cache_get_stats(const result_cache_t *cache, result_cache_stats_t *stats) {
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->entries = (int)cache->entries.size();
+    stats->bytes = cache->bytes;
+    stats->max_bytes = cache->max_bytes;
+}
@@ -0,0 +1,61 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <cstdint>
+#include "simulation.h"
+
+/*
+ * A memory bounded cache of single runs, so that running a model again with
+ * nothing changed (or going back to a model run before) costs a lookup.
+ *
+ * Runs are keyed by model_params_hash: every user settable parameter of the
+ * model, the seed among them, and the integration method. The noise array
+ * pointers in a params struct are not part of the key, and neither is any
+ * padding. A hit is checked against the parameter values themselves, so
+ * two runs whose keys collide are never confused. When the results held go
+ * past the budget, the least recently used runs are dropped, never the one
+ * just asked for.
+ */
+
+typedef struct result_cache_s result_cache_t;
+
+typedef struct result_cache_stats_s {
+    long hits;
+    long misses;
+    long evictions;
+    int entries;
+    size_t bytes;           /* held by the results */
+    size_t max_bytes;       /* the budget */
+} result_cache_stats_t;
+
+/* a 64 bit FNV-1a hash of the model, method and parameter values */
+uint64_t model_params_hash(model_t m, method_t method, const void *params);
+
+result_cache_t *result_cache_create(size_t max_bytes);
+void result_cache_destroy(result_cache_t *cache);
+
+/*
+ * the cached results of model_integrate for params. returns the number of
+ * results, or 0 if they are not cached; results_y1 and results_y2 are set
+ * to arrays of that many, which stay valid until the next call
+ */
+int result_cache_lookup(result_cache_t *cache, model_t m, method_t method, const void *params,
+                        const double **results_y1, const double **results_y2);
+
+/*
+ * the longest cached run of params but for a shorter duration d, which is
+ * then the start of the run of params (see model_continue_progress): sets
+ * *d to its duration and returns its number of results as
+ * result_cache_lookup, or 0 if there is none. not counted as a hit or a miss
+ */
+int result_cache_lookup_shorter(result_cache_t *cache, model_t m, method_t method, const void *params, int *d,
+                                const double **results_y1, const double **results_y2);
+
+/* add the results of a run made elsewhere (length of each, copied), as a miss */
+void result_cache_insert(result_cache_t *cache, model_t m, method_t method, const void *params,
+                         const double *results_y1, const double *results_y2, int length);
+
+void result_cache_clear(result_cache_t *cache);
+void result_cache_get_stats(const result_cache_t *cache, result_cache_stats_t *stats);
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,307 @@
+#include <cmath>
+#include <cstring>
+#include "rng.h"
+#include "models_batch.h"
+
+/* Philox4x32 multipliers and Weyl key increments */
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+/* steps generated together by rng_normal_block */
+#define RNG_BLOCK 64
+
+noise_key_t noise_key(int seed, uint32_t trial) {
+    noise_key_t key;
+    key.seed = (uint32_t)seed;
+    key.trial = trial;
+    return key;
+}
+
+void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for (int r=0; r<PHILOX_ROUNDS; r++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/*
+ * philox4x32 for the consecutive steps first .. first+n-1 of one stream,
+ * words stored by plane (out0[i] is word 0 of step first+i). Only the step
+ * differs between steps, so whole vectors of them are generated at once on
+ * the instruction set the batch kernels use; the integer arithmetic gives
+ * the same bits on all of them.
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define RNG_HAVE_X86
+#endif
+
+#ifdef RNG_HAVE_X86
+
+#include <immintrin.h>
+
+#define RNG_VECTOR_HELPERS(width, vi, mul) \
+    typedef uint64_t vu __attribute__((vector_size(8*(width)))); \
+    static inline vu vset1u(uint32_t x) { vu v = {}; return v + x; } \
+    static inline vu vmul32(vu a, vu b) { return (vu)mul((vi)a, (vi)b); }
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+namespace philox_sse2 {
+RNG_VECTOR_HELPERS(2, __m128i, _mm_mul_epu32)
+#include "rng_philox.inc"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace philox_avx2 {
+RNG_VECTOR_HELPERS(4, __m256i, _mm256_mul_epu32)
+#include "rng_philox.inc"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace philox_avx512 {
+/* the zero masked form: gcc 12 warns about the undefined source operand of _mm512_mul_epu32 */
+static inline __m512i mul_epu32(__m512i a, __m512i b) { return _mm512_maskz_mul_epu32(0xff, a, b); }
+RNG_VECTOR_HELPERS(8, __m512i, mul_epu32)
+#include "rng_philox.inc"
+}
+#pragma GCC pop_options
+
+#endif // RNG_HAVE_X86
+
+static void philox4x32_steps(uint32_t first, int n, uint32_t c1, uint32_t c2, uint32_t c3, const uint32_t key[2],
+                             uint32_t *out0, uint32_t *out1, uint32_t *out2, uint32_t *out3) {
+    int i = 0;
+#ifdef RNG_HAVE_X86
+    switch (batch_isa()) {
+        case BATCH_AVX512: i = philox_avx512::philox_lanes(first, n, c1, c2, c3, key, out0, out1, out2, out3); break;
+        case BATCH_AVX2: i = philox_avx2::philox_lanes(first, n, c1, c2, c3, key, out0, out1, out2, out3); break;
+        case BATCH_SSE2: i = philox_sse2::philox_lanes(first, n, c1, c2, c3, key, out0, out1, out2, out3); break;
+        default: break;
+    }
+#endif
+    for (; i<n; i++) {
+        uint32_t counter[4] = { first + (uint32_t)i, c1, c2, c3 };
+        uint32_t r[4];
+        philox4x32(counter, key, r);
+        out0[i] = r[0];
+        out1[i] = r[1];
+        out2[i] = r[2];
+        out3[i] = r[3];
+    }
+}
+
+static inline void philox_key(const noise_key_t *key, uint32_t k[2]) {
+    k[0] = (uint32_t)key->seed;
+    k[1] = (uint32_t)(key->seed >> 32);
+}
+
+/*
+ * Counter layout: {step, stream, trial, block}. The block word numbers the
+ * 128 bit blocks a single draw consumes; only samplers that reject (the
+ * normal below, about one draw in a hundred) go past block 0.
+ */
+static inline void block_bits(const noise_key_t *key, uint32_t stream, uint32_t step, uint32_t block, uint32_t out[4]) {
+    uint32_t counter[4] = { step, stream, key->trial, block };
+    uint32_t k[2];
+    philox_key(key, k);
+    philox4x32(counter, k, out);
+}
+
+void rng_bits(const noise_key_t *key, uint32_t stream, uint32_t step, uint32_t out[4]) {
+    block_bits(key, stream, step, 0, out);
+}
+
+/* 53 random bits to a double in (0,1); signed, as that converts faster and 53 bits fit */
+static inline double to_uniform(uint32_t hi, uint32_t lo) {
+    int64_t bits = (int64_t)((((uint64_t)hi << 32) | lo) >> 11);
+    return (bits + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+double rng_uniform(const noise_key_t *key, uint32_t stream, uint32_t step) {
+    uint32_t r[4];
+    rng_bits(key, stream, step, r);
+    return to_uniform(r[0], r[1]);
+}
+
+/*****************************************************************************
+ *
+ * exp and log from + - * / only
+ *
+ * The library versions are free to differ in the last bit between platforms,
+ * which would change the ziggurat tables and the rare tail and wedge draws.
+ * These are built from correctly rounded operations alone (the library is
+ * compiled without fma contraction), so they give the same bits everywhere.
+ *
+ *****************************************************************************/
+
+#define RNG_LN2_HI 6.93147180369123816490e-01 /* ln 2 with the low bits zero, so k*RNG_LN2_HI is exact */
+#define RNG_LN2_LO 1.90821492927058770002e-10
+#define RNG_SQRT_HALF 0.70710678118654752440
+
+static double rng_exp(double x) {
+    if (x < -745.0) return 0.0;
+    double k = floor(x * (1.0 / 0.69314718055994530942) + 0.5);
+    double r = (x - k * RNG_LN2_HI) - k * RNG_LN2_LO;
+
+    /* |r| <= ln(2)/2: Taylor series to r^14 */
+    double p = 1.0;
+    for (int i=14; i>=1; i--) p = 1.0 + p * r / i;
+    return ldexp(p, (int)k);
+}
+
+static double rng_log(double x) {
+    int e;
+    double m = frexp(x, &e);
+    if (m < RNG_SQRT_HALF) {
+        m *= 2.0;
+        e--;
+    }
+
+    /* log(m) = 2 atanh(s), |s| < 0.172 */
+    double s = (m - 1.0) / (m + 1.0);
+    double s2 = s * s;
+    double p = 1.0 / 25;
+    for (int i=23; i>=1; i-=2) p = p * s2 + 1.0 / i;
+    return (e * RNG_LN2_HI + (2.0 * s * p + e * RNG_LN2_LO));
+}
+
+/*****************************************************************************
+ *
+ * Normal deviates: 256 layer ziggurat (Marsaglia & Tsang 2000, in the
+ * floating point form of Doornik 2005)
+ *
+ * The first 64 bits of block 0 pick the layer, the sign and a 53 bit
+ * uniform; in 99% of draws that is all that is needed, costing one compare
+ * and one multiply. The wedge test reads the second 64 bits of the block;
+ * rejections and the tail move on to blocks 1, 2, ...
+ *
+ *****************************************************************************/
+
+#define ZIG_LAYERS 256
+#define ZIG_R 3.6541528853610088
+#define ZIG_V 0.00492867323399
+
+typedef struct zig_tables_s {
+    double x[ZIG_LAYERS + 1];   /* layer edges, x[0] the width of the base strip */
+    double ratio[ZIG_LAYERS];   /* x[i+1] / x[i]: below it a draw is inside the next layer */
+} zig_tables_t;
+
+static zig_tables_t make_zig_tables() {
+    zig_tables_t t;
+    double f = rng_exp(-0.5 * ZIG_R * ZIG_R);
+    t.x[0] = ZIG_V / f;
+    t.x[1] = ZIG_R;
+    for (int i=2; i<ZIG_LAYERS; i++) {
+        t.x[i] = sqrt(-2.0 * rng_log(ZIG_V / t.x[i-1] + f));
+        f = rng_exp(-0.5 * t.x[i] * t.x[i]);
+    }
+    t.x[ZIG_LAYERS] = 0.0;
+    for (int i=0; i<ZIG_LAYERS; i++) t.ratio[i] = t.x[i+1] / t.x[i];
+    return t;
+}
+
+static const zig_tables_t &zig_tables() {
+    static const zig_tables_t t = make_zig_tables();
+    return t;
+}
+
+/* 53 bit uniform in [0,1) from bits 11..63, as the layer and sign take bits 0..8 */
+static inline double zig_uniform(uint32_t hi, uint32_t lo) {
+    return (double)(int64_t)((((uint64_t)hi << 32) | lo) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * the draw at (key, stream, step) when block 0 (in r) missed the fast path:
+ * the wedge and tail tests and any further attempts
+ */
+static double zig_slow(const zig_tables_t *t, const noise_key_t *key, uint32_t stream, uint32_t step, uint32_t r[4]) {
+    uint32_t block = 0;
+    for (;;) {
+        int i = r[0] & 0xff;
+        double sign = (r[0] & 0x100) ? -1.0 : 1.0;
+        double u = zig_uniform(r[1], r[0]);
+        double x = u * t->x[i];
+
+        if (u < t->ratio[i]) return sign * x;
+
+        if (i == 0) {
+            /* base strip beyond ZIG_R: Marsaglia's tail method, one block per try */
+            for (;;) {
+                block_bits(key, stream, step, ++block, r);
+                double xt = -rng_log(to_uniform(r[1], r[0])) / ZIG_R;
+                double yt = -rng_log(to_uniform(r[3], r[2]));
+                if (yt + yt > xt * xt) return sign * (ZIG_R + xt);
+            }
+        }
+
+        double f0 = rng_exp(-0.5 * (t->x[i] * t->x[i] - x * x));
+        double f1 = rng_exp(-0.5 * (t->x[i+1] * t->x[i+1] - x * x));
+        if (f1 + zig_uniform(r[3], r[2]) * (f0 - f1) < 1.0) return sign * x;
+
+        block_bits(key, stream, step, ++block, r);
+    }
+}
+
+/* fast path of a draw from the first 64 bits of its block 0; false if the slow path is needed */
+static inline bool zig_fast(const zig_tables_t *t, uint32_t r0, uint32_t r1, double *z) {
+    int i = r0 & 0xff;
+    double u = zig_uniform(r1, r0);
+    if (u >= t->ratio[i]) return false;
+    double x = u * t->x[i];
+    *z = (r0 & 0x100) ? -x : x;
+    return true;
+}
+
+double rng_normal(const noise_key_t *key, uint32_t stream, uint32_t step) {
+    const zig_tables_t *t = &zig_tables();
+    uint32_t r[4];
+    rng_bits(key, stream, step, r);
+    double z;
+    if (!zig_fast(t, r[0], r[1], &z)) z = zig_slow(t, key, stream, step, r);
+    return z;
+}
+
+void rng_normal_block(const noise_key_t *key, uint32_t stream, uint32_t first, int n, double mean, double std_dev, double *out) {
+    const zig_tables_t *t = &zig_tables();
+    uint32_t k[2];
+    philox_key(key, k);
+
+    uint32_t r0[RNG_BLOCK], r1[RNG_BLOCK], r2[RNG_BLOCK], r3[RNG_BLOCK];
+    for (int b=0; b<n; b+=RNG_BLOCK) {
+        int m = n - b < RNG_BLOCK ? n - b : RNG_BLOCK;
+        uint32_t step = first + (uint32_t)b;
+        philox4x32_steps(step, m, stream, key->trial, 0, k, r0, r1, r2, r3);
+        for (int i=0; i<m; i++) {
+            double z;
+            if (!zig_fast(t, r0[i], r1[i], &z)) {
+                uint32_t r[4] = { r0[i], r1[i], r2[i], r3[i] };
+                z = zig_slow(t, key, stream, step + (uint32_t)i, r);
+            }
+            out[b + i] = mean + std_dev * z;
+        }
+    }
+}
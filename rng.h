@@ -0,0 +1,40 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+/*
+ * Counter-based random numbers (Philox4x32-10, Salmon et al. 2011, "Parallel
+ * random numbers: as easy as 1, 2, 3").
+ *
+ * There is no generator state: every draw is a pure function of
+ * (seed, trial, stream, step). Any block of noise can be produced on its own,
+ * in any order and on any thread, and comes out the same as if the whole
+ * array had been filled in one pass. Models use one stream per noise channel.
+ */
+
+/* identifies the noise of one trajectory */
+typedef struct noise_key_s {
+    uint64_t seed;      /* user seed */
+    uint32_t trial;     /* trial number within an ensemble, 0 for single runs */
+} noise_key_t;
+
+/* noise key of a trial from a params->seed value */
+noise_key_t noise_key(int seed, uint32_t trial);
+
+/* one Philox4x32-10 block: 128 random bits from a 128 bit counter and 64 bit key */
+void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]);
+
+/* the 128 bits belonging to (key, stream, step) */
+void rng_bits(const noise_key_t *key, uint32_t stream, uint32_t step, uint32_t out[4]);
+
+/* uniform on the open interval (0,1) */
+double rng_uniform(const noise_key_t *key, uint32_t stream, uint32_t step);
+
+/* standard normal, by ziggurat: the same bits on every platform and compiler */
+double rng_normal(const noise_key_t *key, uint32_t stream, uint32_t step);
+
+/* out[i] = mean + std_dev * normal for steps first .. first+n-1 of a stream */
+void rng_normal_block(const noise_key_t *key, uint32_t stream, uint32_t first, int n, double mean, double std_dev, double *out);
+
+#endif // RNG_H
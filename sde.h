@@ -0,0 +1,102 @@
+#ifndef SDE_H
+#define SDE_H
+
+#include <cmath>
+
+/*
+ * Stochastic integrators for the models read as Ito SDEs.
+ *
+ * The fixed step kernels add the step's noise sample to the rates and hold
+ * it over the step, so the noise a trajectory sees scales with h. Here each
+ * noise channel c is a Brownian motion instead: its increment over a step is
+ * dW_c = sample * sqrt(h), with the samples drawn as before (mean 0,
+ * standard deviation std_dev), so W_c has variance std_dev^2 per unit time
+ * and the noise intensity no longer depends on h.
+ *
+ * Every model's right-hand side is affine in its noise values,
+ *
+ *   f(y, v) = a(y) + sum_c v_c b_c(y),
+ *
+ * so the drift a and the diffusion columns b_c are found from the stepper.h
+ * functors by setting v: the functor is built over params whose noise
+ * pointers each point at one entry of `w`, which the integrator writes
+ * before every evaluation.
+ */
+
+/* most noise channels of any model */
+#define SDE_MAX_CHANNELS 9
+
+template <class RHS, class Params>
+struct sde_system_t {
+    const Params *p;    /* the noise pointers of *p point into w, one value per channel */
+    double *w;
+    int channels;
+    const double *std_dev;  /* of each channel's samples */
+
+    /* f(y, v) at step i; v = nullptr for the drift alone */
+    inline void eval(int i, const double *v, double y1, double y2, double *dy1, double *dy2) const {
+        for (int c=0; c<channels; c++) w[c] = v != nullptr ? v[c] : 0.0;
+        RHS f(p, i);
+        f.begin(i, y1, y2);
+        f(y1, y2, dy1, dy2);
+    }
+
+    /* b_c(y) at step i, given the drift there */
+    inline void column(int i, int c, double y1, double y2, double a1, double a2, double *b1, double *b2) const {
+        for (int k=0; k<channels; k++) w[k] = k == c ? 1.0 : 0.0;
+        RHS f(p, i);
+        f.begin(i, y1, y2);
+        f(y1, y2, b1, b2);
+        *b1 -= a1;
+        *b2 -= a2;
+    }
+};
+
+/*
+ * Euler-Maruyama: y += a h + sum_c b_c dW_c, one evaluation a step.
+ * strong order 1/2, and 1 when the noise is additive (b independent of y)
+ */
+struct em_method_t {
+    template <class System>
+    static inline void step(const System &s, int i, double h, const double *dw, double *rate, double &y1, double &y2) {
+        for (int c=0; c<s.channels; c++) rate[c] = dw[c] / h;
+        double dy1, dy2;
+        s.eval(i, rate, y1, y2, &dy1, &dy2);
+        y1 = y1 + (dy1 * h);
+        y2 = y2 + (dy2 * h);
+    }
+};
+
+/*
+ * There is no Milstein scheme here. For um and gaze the noise is additive,
+ * where Milstein is Euler-Maruyama. The ant models' channels do not commute
+ * (b_j . grad b_k != b_k . grad b_j), and Milstein is strong order 1 there
+ * only with the Levy areas of every pair of channels: a truncated series
+ * needs of order 1/h extra draws per pair a step. Without them it stays at
+ * order 1/2 like Euler-Maruyama, at several times the cost, so
+ * METHOD_MILSTEIN is not offered for them (see model_offers_method).
+ */
+
+template <class Method, class System>
+struct SdeStepper {
+    /*
+     * advance steps first .. first+count-1; results up to step `first` are
+     * already in place. noise[c*stride + k] is channel c's sample for step
+     * first+k
+     */
+    static inline void run(const System &s, double h, int first, int count, const double *noise, int stride,
+                           double *results_y1, double *results_y2) {
+        const double sqrt_h = sqrt(h);
+        double dw[SDE_MAX_CHANNELS], rate[SDE_MAX_CHANNELS];
+        double y1 = results_y1[first];
+        double y2 = results_y2[first];
+        for (int k=0; k<count; k++) {
+            for (int c=0; c<s.channels; c++) dw[c] = noise[(size_t)c*stride + k] * sqrt_h;
+            Method::step(s, first + k, h, dw, rate, y1, y2);
+            results_y1[first+k+1] = y1;
+            results_y2[first+k+1] = y2;
+        }
+    }
+};
+
+#endif // SDE_H
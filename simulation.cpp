@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "buffer_pool.h"
+#include "model_registry.h"
+#include "simulation.h"
+
+/* steps model_continue_progress runs between progress updates and checks for cancelling */
+#define PROGRESS_BLOCK 4096
+
+/*****************************************************************************
+ *
+ * Model lookup
+ *
+ *****************************************************************************/
+
+const char *model_name(model_t m) {
+    const model_desc_t *desc = model_desc(m);
+    return desc != nullptr ? desc->name : "unknown";
+}
+
+const char *model_long_name(model_t m) {
+    const model_desc_t *desc = model_desc(m);
+    return desc != nullptr ? desc->long_name : "Unknown model";
+}
+
+int model_from_name(const char *name) {
+    for (int m=0; m<MODEL_COUNT; m++) {
+        if (strcmp(name, model_name((model_t)m)) == 0) return m;
+    }
+    return -1;
+}
+
+const char *method_name(method_t method) {
+    switch (method) {
+        case METHOD_RK4: return "rk4";
+        case METHOD_EULER: return "euler";
+        case METHOD_DOPRI5: return "dopri5";
+        case METHOD_EM: return "em";
+        case METHOD_MILSTEIN: return "milstein";
+        case METHOD_EXACT: return "exact";
+        default: return "unknown";
+    }
+}
+
+const char *boundary_name(boundary_kind_t kind) {
+    switch (kind) {
+        case BOUNDARY_NONE: return "none";
+        case BOUNDARY_DIFFERENCE: return "difference";
+        case BOUNDARY_NEST: return "nest";
+        case BOUNDARY_QUORUM: return "quorum";
+        default: return "unknown";
+    }
+}
+
+int boundary_from_name(const char *name) {
+    for (int kind=0; kind<BOUNDARY_COUNT; kind++) {
+        if (strcmp(name, boundary_name((boundary_kind_t)kind)) == 0) return kind;
+    }
+    return -1;
+}
+
+int model_default_boundary(model_t m, const void *params, boundary_kind_t kind, boundary_t *boundary) {
+    double population = 0.;
+    bool has_population = model_get_param(m, params, "population", &population) == 0;
+    boundary->kind = kind;
+    boundary->population = population;
+    switch (kind) {
+        case BOUNDARY_DIFFERENCE: boundary->threshold = has_population ? 0.25 * population : 0.5; return 0;
+        case BOUNDARY_NEST: boundary->threshold = has_population ? 0.5 * population : 1.0; return 0;
+        case BOUNDARY_QUORUM: boundary->threshold = 0.5; return has_population ? 0 : -1;
+        default: boundary->threshold = 0.; return 0;
+    }
+}
+
+int method_from_name(const char *name) {
+    for (int method=0; method<METHOD_COUNT; method++) {
+        if (strcmp(name, method_name((method_t)method)) == 0) return method;
+    }
+    return -1;
+}
+
+int model_offers_method(model_t m, method_t method) {
+    return method != METHOD_MILSTEIN || m == MODEL_UM || m == MODEL_GAZE;
+}
+
+size_t model_params_size(model_t m) {
+    const model_desc_t *desc = model_desc(m);
+    return desc != nullptr ? desc->params_size : 0;
+}
+
+const param_info_t *model_param_info(model_t m, int *count) {
+    const model_desc_t *desc = model_desc(m);
+    *count = desc != nullptr ? desc->param_count : 0;
+    return desc != nullptr ? desc->param_info : nullptr;
+}
+
+void model_set_defaults(model_t m, void *params) {
+    const model_desc_t *desc = model_desc(m);
+    if (desc != nullptr) desc->set_defaults(params);
+}
+
+static const param_info_t *find_param(model_t m, const char *name) {
+    int count;
+    const param_info_t *info = model_param_info(m, &count);
+    for (int i=0; i<count; i++) {
+        if (strcmp(info[i].name, name) == 0) return &info[i];
+    }
+    return nullptr;
+}
+
+int model_set_param(model_t m, void *params, const char *name, const char *value) {
+    const param_info_t *info = find_param(m, name);
+    if (info == nullptr) return -1;
+
+    char *end;
+    char *field = (char *)params + info->offset;
+    if (info->type == PARAM_INT) {
+        long v = strtol(value, &end, 10);
+        if (end == value || *end != '\0') return -2;
+        *(int *)field = (int)v;
+    } else {
+        double v = strtod(value, &end);
+        if (end == value || *end != '\0' || !std::isfinite(v)) return -2;
+        *(double *)field = v;
+    }
+    return 0;
+}
+
+int model_get_param(model_t m, const void *params, const char *name, double *value) {
+    const param_info_t *info = find_param(m, name);
+    if (info == nullptr) return -1;
+
+    const char *field = (const char *)params + info->offset;
+    if (info->type == PARAM_INT) *value = *(const int *)field;
+    else *value = *(const double *)field;
+    return 0;
+}
+
+int model_set_param_value(model_t m, void *params, const char *name, double value) {
+    const param_info_t *info = find_param(m, name);
+    if (info == nullptr) return -1;
+
+    char *field = (char *)params + info->offset;
+    if (info->type == PARAM_INT) *(int *)field = (int)lround(value);
+    else *(double *)field = value;
+    return 0;
+}
+
+int model_length(int d, double h) {
+    return ceil(d/h);
+}
+
+int model_params_length(model_t m, const void *params) {
+    double d = 0., h = 0.;
+    if (model_get_param(m, params, "d", &d) != 0 || model_get_param(m, params, "h", &h) != 0) return 0;
+    return model_length((int)d, h);
+}
+
+/*****************************************************************************
+ *
+ * Simulation
+ *
+ * Mirrors what the chart constructors do: the rk4 kernel is run with noise
+ * streamed from params->seed (trial 0 of the counter-based generator), so
+ * no length sized noise arrays are needed.
+ *
+ *****************************************************************************/
+
+void um_simulate(params_um_t *params, double *results_y1, double *results_y2) {
+    noise_key_t key = noise_key(params->seed, 0);
+    usher_mcclelland_rk4_streamed(params, &key, results_y1, results_y2);
+}
+
+void pratt_simulate(params_pratt_t *params, double *results_y1, double *results_y2) {
+    noise_key_t key = noise_key(params->seed, 0);
+    pratt_rk4_streamed(params, &key, results_y1, results_y2);
+}
+
+void indirect_britton_simulate(params_indirect_britton_t *params, double *results_y1, double *results_y2) {
+    noise_key_t key = noise_key(params->seed, 0);
+    indirect_britton_rk4_streamed(params, &key, results_y1, results_y2);
+}
+
+void direct_britton_simulate(params_direct_britton_t *params, double *results_y1, double *results_y2) {
+    noise_key_t key = noise_key(params->seed, 0);
+    direct_britton_rk4_streamed(params, &key, results_y1, results_y2);
+}
+
+void gaze_simulate(params_gaze_t *params, double *results_y1, double *results_y2) {
+    noise_key_t key = noise_key(params->seed, 0);
+    gaze_rk4_streamed(params, &key, results_y1, results_y2);
+}
+
+void model_simulate(model_t m, void *params, double *results_y1, double *results_y2) {
+    const model_desc_t *desc = model_desc(m);
+    if (desc == nullptr) return;
+    double seed = 0.;
+    model_get_param(m, params, "seed", &seed);
+    noise_key_t key = noise_key((int)seed, 0);
+    desc->rk4_streamed(params, &key, results_y1, results_y2);
+}
+
+void model_integrate(model_t m, method_t method, const void *params, double *results_y1, double *results_y2) {
+    double seed = 0.;
+    model_get_param(m, params, "seed", &seed);
+    noise_key_t key = noise_key((int)seed, 0);
+    model_integrate_trial(m, method, params, &key, results_y1, results_y2);
+}
+
+void model_integrate_trial(model_t m, method_t method, const void *params, const noise_key_t *key, double *results_y1, double *results_y2) {
+    model_integrate_until(m, method, params, key, nullptr, results_y1, results_y2, nullptr);
+}
+
+void model_integrate_until(model_t m, method_t method, const void *params, const noise_key_t *key, const boundary_t *boundary,
+                           double *results_y1, double *results_y2, decision_t *decision) {
+    const model_desc_t *desc = model_desc(m);
+    if (desc != nullptr) desc->integrate_until(params, method, key, boundary, results_y1, results_y2, decision);
+}
+
+struct run_noise_s {
+    model_t m;
+    double values[MODEL_MAX_NOISE_PARAMS];  /* of the model's noise_params (see model_desc_t) */
+    int channels;
+    int steps;                      /* noise samples per channel: the steps of the run */
+    int filled;                     /* steps drawn so far, from the first */
+    buffer_vector_t samples;        /* channel after channel, allocated by the first run */
+};
+
+static void noise_param_values(model_t m, const void *params, double *values) {
+    const model_desc_t *desc = model_desc(m);
+    for (int i=0; i<MODEL_MAX_NOISE_PARAMS; i++) {
+        values[i] = 0.;
+        if (i < desc->noise_param_count) model_get_param(m, params, desc->noise_params[i], &values[i]);
+    }
+}
+
+size_t run_noise_size(model_t m, const void *params) {
+    int steps = model_params_length(m, params) - 1;
+    return steps > 0 ? (size_t)model_noise_channels(m) * steps * sizeof(double) : 0;
+}
+
+run_noise_t *run_noise_create(model_t m, const void *params) {
+    run_noise_t *noise = new run_noise_t;
+    noise->m = m;
+    noise_param_values(m, params, noise->values);
+    noise->channels = model_noise_channels(m);
+    noise->steps = std::max(model_params_length(m, params) - 1, 0);
+    noise->filled = 0;
+    return noise;
+}
+
+void run_noise_destroy(run_noise_t *noise) {
+    delete noise;
+}
+
+/* whether noise was drawn with the noise parameters of params */
+static bool same_noise(const run_noise_t *noise, model_t m, const void *params) {
+    if (noise == nullptr || noise->m != m) return false;
+    double values[MODEL_MAX_NOISE_PARAMS];
+    noise_param_values(m, params, values);
+    return memcmp(values, noise->values, sizeof(values)) == 0;
+}
+
+run_noise_t *run_noise_extend(const run_noise_t *from, model_t m, const void *params) {
+    run_noise_t *noise = run_noise_create(m, params);
+    if (!same_noise(from, m, params)) return noise;
+
+    int filled = std::min(from->filled, noise->steps);
+    if (filled == 0) return noise;
+    noise->samples.resize((size_t)noise->channels * noise->steps);
+    for (int c=0; c<noise->channels; c++) {
+        const double *src = &from->samples[(size_t)c * from->steps];
+        std::copy(src, src + filled, &noise->samples[(size_t)c * noise->steps]);
+    }
+    noise->filled = filled;
+    return noise;
+}
+
+bool run_noise_matches(const run_noise_t *noise, model_t m, const void *params) {
+    return same_noise(noise, m, params) && noise->filled >= model_params_length(m, params) - 1;
+}
+
+int model_continue_progress(model_t m, method_t method, const void *params, int done, run_noise_t *noise,
+                            run_progress_t *progress, double *results_y1, double *results_y2) {
+    const int length = model_params_length(m, params);
+    if (method != METHOD_RK4) {
+        if (progress->cancel.load()) return -1;
+        model_integrate(m, method, params, results_y1, results_y2);
+        progress->steps.store(length, std::memory_order_release);
+        return 0;
+    }
+
+    /*
+     * a copy of the parameters with the noise arrays pointing at the block
+     * being taken: in noise if given, else in buffers drawn afresh each block
+     */
+    const model_desc_t *desc = model_desc(m);
+    if (desc == nullptr) return -1;
+    std::vector<char> copy((const char *)params, (const char *)params + desc->params_size);
+    void *p = copy.data();
+    const int channels = desc->noise_channels;
+    buffer_vector_t buffer;
+    std::vector<double *> block(channels);
+    if (noise != nullptr && noise->samples.empty()) {
+        noise->samples.resize((size_t)channels * noise->steps);
+    } else if (noise == nullptr) {
+        buffer.resize((size_t)channels * PROGRESS_BLOCK);
+        for (int c=0; c<channels; c++) block[c] = &buffer[(size_t)c * PROGRESS_BLOCK];
+    }
+
+    double seed = 0.;
+    model_get_param(m, p, "seed", &seed);
+    noise_key_t key = noise_key((int)seed, 0);
+
+    /* set initial conditions, unless the run is taken up where it was left */
+    if (done < 1) {
+        double y1_0 = 0., y2_0 = 0.;
+        model_get_param(m, p, "y1_0", &y1_0);
+        model_get_param(m, p, "y2_0", &y2_0);
+        results_y1[0] = y1_0;
+        results_y2[0] = y2_0;
+        done = 1;
+    }
+    done = std::min(done, length);
+    progress->steps.store(done, std::memory_order_release);
+
+    for (int first=done-1; first<length-1; first+=PROGRESS_BLOCK) {
+        if (progress->cancel.load(std::memory_order_relaxed)) return -1;
+        int count = length-1-first < PROGRESS_BLOCK ? length-1-first : PROGRESS_BLOCK;
+        if (noise != nullptr) {
+            /* noise is drawn from the first step it lacks, so it stays whole up to filled */
+            if (first + count > noise->filled) {
+                for (int c=0; c<channels; c++) block[c] = &noise->samples[(size_t)c * noise->steps + noise->filled];
+                model_fill_noise(m, p, &key, noise->filled, first + count - noise->filled, block.data());
+                noise->filled = first + count;
+            }
+            for (int c=0; c<channels; c++) block[c] = &noise->samples[(size_t)c * noise->steps + first];
+        } else {
+            model_fill_noise(m, p, &key, first, count, block.data());
+        }
+        desc->set_noise_arrays(p, block.data());
+        desc->rk4_steps(p, first, count, results_y1, results_y2);
+        progress->steps.store(first + count + 1, std::memory_order_release);
+    }
+    return 0;
+}
+
+void model_integrate_adaptive(model_t m, const void *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats) {
+    const model_desc_t *desc = model_desc(m);
+    if (desc != nullptr) desc->adaptive(params, tol, results_y1, results_y2, stats);
+}
+
+void model_jacobian(model_t m, const void *params, double y1, double y2, double f[2], double jac[2][2]) {
+    const model_desc_t *desc = model_desc(m);
+    if (desc != nullptr) desc->jacobian(params, y1, y2, f, jac);
+}
+
+int model_noise_channels(model_t m) {
+    const model_desc_t *desc = model_desc(m);
+    return desc != nullptr ? desc->noise_channels : 0;
+}
+
+void model_fill_noise(model_t m, const void *params, const noise_key_t *key, int first, int length, double *const *noise) {
+    const model_desc_t *desc = model_desc(m);
+    if (desc != nullptr) desc->fill_noise(params, key, first, length, noise);
+}
@@ -0,0 +1,189 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <atomic>
+#include <cstddef>
+#include "models.h"
+
+/*
+ * Headless front end to the models: name lookup, parameter metadata and a
+ * single call that runs a model from its parameters and seed, as the
+ * charts do, without pulling in Qt. The noise is generated from the seed
+ * while the kernel runs, a cache-sized block at a time, so no run holds
+ * noise arrays for its whole length. The model_* functions take any
+ * model, through its descriptor (see model_registry.h).
+ */
+
+/* the available models, in the order they appear in the GUI */
+typedef enum {
+    MODEL_UM = 0,
+    MODEL_PRATT,
+    MODEL_INDIRECT_BRITTON,
+    MODEL_DIRECT_BRITTON,
+    MODEL_GAZE,
+    MODEL_COUNT
+} model_t;
+
+/* type of a field in one of the params_*_t structs */
+typedef enum {
+    PARAM_DOUBLE = 0,
+    PARAM_INT
+} param_type_t;
+
+/* description of a single user settable parameter */
+typedef struct param_info_s {
+    const char *name;           /* field name, as used on the command line */
+    param_type_t type;          /* double or int */
+    size_t offset;              /* offsetof() the field in the params struct */
+    const char *description;
+} param_info_t;
+
+/* model names ("um", "pratt", ...) */
+const char *model_name(model_t m);
+const char *model_long_name(model_t m);
+
+/* look up a model by its short name, -1 if unknown */
+int model_from_name(const char *name);
+
+/* size of the params struct for a model */
+size_t model_params_size(model_t m);
+
+/* parameter table for a model, count is set to the number of entries */
+const param_info_t *model_param_info(model_t m, int *count);
+
+/* fill params with the model defaults */
+void model_set_defaults(model_t m, void *params);
+
+/*
+ * set a parameter from its textual value.
+ * returns 0 on success, -1 for an unknown name and -2 for an unparsable
+ * value (an infinity or nan among them)
+ */
+int model_set_param(model_t m, void *params, const char *name, const char *value);
+
+/* read a parameter as a double, returns 0 and sets value on success */
+int model_get_param(model_t m, const void *params, const char *name, double *value);
+
+/* set a parameter from a double (rounded for int fields), returns -1 for an unknown name */
+int model_set_param_value(model_t m, void *params, const char *name, double value);
+
+/* number of time steps for a duration and step size; d/h must be below INT_MAX */
+int model_length(int d, double h);
+
+/* time steps (and so the size of the results arrays) for a params struct */
+int model_params_length(model_t m, const void *params);
+
+/*
+ * run one trajectory from the model parameters and seed.
+ * results_y1 and results_y2 must hold model_params_length() values each.
+ * the noise is generated as the kernel runs; the noise pointers in params are not used.
+ */
+void um_simulate(params_um_t *params, double *results_y1, double *results_y2);
+void pratt_simulate(params_pratt_t *params, double *results_y1, double *results_y2);
+void indirect_britton_simulate(params_indirect_britton_t *params, double *results_y1, double *results_y2);
+void direct_britton_simulate(params_direct_britton_t *params, double *results_y1, double *results_y2);
+void gaze_simulate(params_gaze_t *params, double *results_y1, double *results_y2);
+
+void model_simulate(model_t m, void *params, double *results_y1, double *results_y2);
+
+/* integration method names as used on the command line ("rk4", "euler", "dopri5", "em", ...) */
+const char *method_name(method_t method);
+int method_from_name(const char *name); /* -1 if unknown */
+
+/* 0 for a method a model does not offer: METHOD_MILSTEIN for the ant models (see sde.h) */
+int model_offers_method(model_t m, method_t method);
+
+/*
+ * as model_simulate, with any of the methods; METHOD_RK4 gives the same results.
+ * METHOD_DOPRI5 integrates the model without noise, to the default tolerances
+ */
+void model_integrate(model_t m, method_t method, const void *params, double *results_y1, double *results_y2);
+
+/* as model_integrate, with the noise of any trial */
+void model_integrate_trial(model_t m, method_t method, const void *params, const noise_key_t *key, double *results_y1, double *results_y2);
+
+/* as model_integrate_trial, stopping at the first crossing of boundary (see *_integrate_until) */
+void model_integrate_until(model_t m, method_t method, const void *params, const noise_key_t *key, const boundary_t *boundary,
+                           double *results_y1, double *results_y2, decision_t *decision);
+
+/*
+ * how far a run on another thread has got, and a way to stop it. steps is
+ * stored with release order once that many results are in place, so a
+ * reader that loads it with acquire order may chart them while the run
+ * goes on: the results arrays themselves are the (single producer, single
+ * consumer) stream, with nothing copied
+ */
+typedef struct run_progress_s {
+    std::atomic<int> steps;     /* results written so far, of model_params_length() */
+    std::atomic<bool> cancel;   /* set to stop the run at the next block of steps */
+} run_progress_t;
+
+/*
+ * room for the noise of trial 0 of a run, so that the model can be run
+ * again with other parameters at the cost of the integration alone: the
+ * noise drawn depends only on the model, seed, h and noise levels, and a
+ * step draws the same noise whatever the duration d.
+ * model_continue_progress draws into it the first time, and reads it
+ * after. one that is not yet complete must not be given to two runs at once
+ */
+typedef struct run_noise_s run_noise_t;
+
+run_noise_t *run_noise_create(model_t m, const void *params);
+void run_noise_destroy(run_noise_t *noise);
+
+/*
+ * as run_noise_create, starting with as much of the noise in from as
+ * params draws (from may be null, or for other noise, when none is)
+ */
+run_noise_t *run_noise_extend(const run_noise_t *from, model_t m, const void *params);
+
+/* the memory run_noise_create takes for params */
+size_t run_noise_size(model_t m, const void *params);
+
+/* whether noise holds all the noise a run of params draws (it may hold more, for a longer d) */
+bool run_noise_matches(const run_noise_t *noise, model_t m, const void *params);
+
+/*
+ * as model_integrate, a block of steps at a time, updating progress->steps
+ * as it goes and giving up if progress->cancel is set. returns 0, or -1 if
+ * cancelled (the results are then incomplete). METHOD_RK4 gives exactly the
+ * results of model_integrate; the other methods run in one piece. noise,
+ * if not null, holds (or is to hold) the noise of params, see run_noise_t;
+ * with METHOD_RK4 it is used and filled as far as the run goes.
+ * the first done results may already be in place: those of a run of the
+ * same parameters with a shorter d, say. the run goes on from the last of
+ * them, so extending a run costs only the new steps, with the same results
+ * as running it whole (a step's noise depends on its index alone). done may
+ * be 0 for a run from the start; progress->steps starts at done. the other
+ * methods than METHOD_RK4 run it all again
+ */
+int model_continue_progress(model_t m, method_t method, const void *params, int done, run_noise_t *noise,
+                            run_progress_t *progress, double *results_y1, double *results_y2);
+
+/* boundary names as used on the command line ("difference", "nest", "quorum") */
+const char *boundary_name(boundary_kind_t kind);
+int boundary_from_name(const char *name); /* -1 if unknown */
+
+/*
+ * a boundary of the given kind with the default threshold: a quarter of the
+ * population (0.5 activation) for the difference, half of it (1.0) for a
+ * nest, and a quorum of one half. -1 for a quorum in a model without a population
+ */
+int model_default_boundary(model_t m, const void *params, boundary_kind_t kind, boundary_t *boundary);
+
+/* the noise-free model with adaptive steps (see *_adaptive in models.h); tol and stats may be null */
+void model_integrate_adaptive(model_t m, const void *params, const adaptive_tol_t *tol, double *results_y1, double *results_y2, adaptive_stats_t *stats);
+
+/* the noise-free right-hand side at (y1, y2) and its Jacobian (see *_jacobian in models.h) */
+void model_jacobian(model_t m, const void *params, double y1, double y2, double f[2], double jac[2][2]);
+
+/* noise channels a model reads each step: the *_set_noise arrays in argument order */
+int model_noise_channels(model_t m);
+
+/*
+ * fill the noise channels with steps first .. first+length-1 of a trajectory's noise.
+ * *_simulate uses trial 0 of params->seed
+ */
+void model_fill_noise(model_t m, const void *params, const noise_key_t *key, int first, int length, double *const *noise);
+
+#endif // SIMULATION_H
@@ -0,0 +1,17 @@
+#include "simulation_job.h"
+
+SimulationJob::SimulationJob(SimulationRunPtr run, QObject *parent)
+    : QObject(parent), sim(run)
+{
+    setAutoDelete(false);
+}
+
+void SimulationJob::run() {
+    /* a cancelled run leaves its cancel flag set, which is what SimulationRun::cancelled() reports */
+    sim->integrate();
+    emit finished();
+}
+
+void SimulationJob::cancel() {
+    sim->cancel();
+}
@@ -0,0 +1,37 @@
+#ifndef SIMULATION_JOB_H
+#define SIMULATION_JOB_H
+
+#include <QObject>
+#include <QRunnable>
+#include "simulation_run.h"
+
+/*
+ * Integrates a SimulationRun on a worker thread (see QThreadPool), so the
+ * window stays responsive while it runs. How far it has got may be read
+ * from the run at any time, and the run can be cancelled. finished() is
+ * emitted from the worker thread when the run ends either way; a queued
+ * connection hands it to the GUI thread, after which all the results may
+ * be read. The job is not deleted by the pool; the run outlives it for as
+ * long as anything holds it.
+ */
+class SimulationJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    SimulationJob(SimulationRunPtr run, QObject *parent = 0);
+
+    void run();
+
+    SimulationRunPtr simulation() const { return sim; }
+
+private:
+    SimulationRunPtr sim;
+
+signals:
+    void finished();
+
+public slots:
+    void cancel();
+};
+
+#endif // SIMULATION_JOB_H
@@ -0,0 +1,39 @@
+#include <algorithm>
+#include "simulation_run.h"
+
+SimulationRun::SimulationRun(model_t model, method_t method, const void *params, QSharedPointer<run_noise_t> noise)
+    : m(model), integration_method(method),
+      params_copy((const char *)params, (const char *)params + model_params_size(model)), run_noise(noise)
+{
+    int length = model_params_length(m, params);
+    results_y1.resize(length);
+    results_y2.resize(length);
+    progress.steps.store(0);
+    progress.cancel.store(false);
+    start = 0;
+}
+
+/*
+ * the results go back to the buffer pool, which is then emptied: runs in
+ * the GUI come seconds apart, not call after call, so what a closed chart's
+ * run gave back would only sit there
+ */
+SimulationRun::~SimulationRun()
+{
+    buffer_vector_t().swap(results_y1);
+    buffer_vector_t().swap(results_y2);
+    buffer_pool_trim();
+}
+
+void SimulationRun::resume_from(const double *start_y1, const double *start_y2, int count) {
+    start = std::min(count, length());
+    std::copy(start_y1, start_y1 + start, results_y1.begin());
+    std::copy(start_y2, start_y2 + start, results_y2.begin());
+    progress.steps.store(start, std::memory_order_release);
+}
+
+int SimulationRun::integrate() {
+    if (done()) return 0;
+    return model_continue_progress(m, integration_method, params_copy.data(), start, run_noise.data(), &progress,
+                                   results_y1.data(), results_y2.data());
+}
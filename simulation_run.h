@@ -0,0 +1,65 @@
+#ifndef SIMULATION_RUN_H
+#define SIMULATION_RUN_H
+
+#include <QSharedPointer>
+#include <vector>
+#include "buffer_pool.h"
+#include "simulation.h"
+
+/*
+ * One run of a model, owning everything it needs: its own copy of the
+ * parameters, its noise (shared with other runs that draw the same, see
+ * run_noise_t) and its results. It is held through a SimulationRunPtr by
+ * the job running it and the charts that show it, and is freed when the
+ * last of them lets go, so runs of the same model go on side by side
+ * without touching each other or the parameters being edited.
+ *
+ * Only integrate() writes to a run, and it is not changed after: the first
+ * steps_done() results may be read from any thread at any time (see
+ * run_progress_t), and all of them once it is done.
+ */
+class SimulationRun
+{
+public:
+    SimulationRun(model_t m, method_t method, const void *params, QSharedPointer<run_noise_t> noise);
+    ~SimulationRun();
+
+    /* before it is integrated: the first count results are these, of the same run with a shorter d (or all of it) */
+    void resume_from(const double *start_y1, const double *start_y2, int count);
+
+    /* run the rest of it, where it is called; returns as model_continue_progress */
+    int integrate();
+
+    /* stop integrate() at its next block of steps, from any thread */
+    void cancel() { progress.cancel.store(true); }
+
+    model_t model() const { return m; }
+    method_t method() const { return integration_method; }
+    const void *params() const { return params_copy.data(); }
+    QSharedPointer<run_noise_t> noise() const { return run_noise; }
+    int length() const { return (int)results_y1.size(); }
+    int steps_done() const { return progress.steps.load(std::memory_order_acquire); }
+    bool done() const { return steps_done() == length(); }
+    bool cancelled() const { return progress.cancel.load(); }
+    int resumed() const { return start; }   /* results it was given to start with */
+
+    const double *y1() const { return results_y1.data(); }
+    const double *y2() const { return results_y2.data(); }
+
+private:
+    SimulationRun(const SimulationRun &);
+    SimulationRun &operator=(const SimulationRun &);
+
+    model_t m;
+    method_t integration_method;
+    std::vector<char> params_copy;
+    QSharedPointer<run_noise_t> run_noise;
+    buffer_vector_t results_y1;
+    buffer_vector_t results_y2;
+    run_progress_t progress;
+    int start;
+};
+
+typedef QSharedPointer<SimulationRun> SimulationRunPtr;
+
+#endif // SIMULATION_RUN_H
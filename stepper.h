@@ -0,0 +1,62 @@
+#ifndef STEPPER_H
+#define STEPPER_H
+
+/*
+ * Fixed step integrators for the two variable models, written once and
+ * instantiated for each model's right-hand side.
+ *
+ * A right-hand side is a small functor:
+ *
+ *   f.begin(i, y1, y2)        step i starts from (y1, y2): read the step's
+ *                             noise and anything else held fixed over the
+ *                             step (the source population s, the gaze input)
+ *   f(y1, y2, &dy1, &dy2)     the derivatives at (y1, y2)
+ *
+ * Everything is inlined, so each instantiation compiles to the same loop
+ * as a hand expanded kernel. The stages are evaluated in the same order
+ * and with the same rounding as the original kernels: k*(h/2) equals
+ * (k*h)/2 exactly, as halving is exact.
+ */
+
+/* forward Euler */
+struct euler_method_t {
+    template <class RHS>
+    static inline void step(RHS &f, double h, double &y1, double &y2) {
+        double y1_k1, y2_k1;
+        f(y1, y2, &y1_k1, &y2_k1);
+        y1 = y1 + (y1_k1 * h);
+        y2 = y2 + (y2_k1 * h);
+    }
+};
+
+/* classic fourth order Runge-Kutta */
+struct rk4_method_t {
+    template <class RHS>
+    static inline void step(RHS &f, double h, double &y1, double &y2) {
+        const double h_2 = h / 2;
+        double y1_k1, y2_k1, y1_k2, y2_k2, y1_k3, y2_k3, y1_k4, y2_k4;
+        f(y1, y2, &y1_k1, &y2_k1);
+        f(y1 + (y1_k1 * h_2), y2 + (y2_k1 * h_2), &y1_k2, &y2_k2);
+        f(y1 + (y1_k2 * h_2), y2 + (y2_k2 * h_2), &y1_k3, &y2_k3);
+        f(y1 + (y1_k3 * h), y2 + (y2_k3 * h), &y1_k4, &y2_k4);
+        y1 = y1 + (((y1_k1 + 2*y1_k2 + 2*y1_k3 + y1_k4)/6)*h);
+        y2 = y2 + (((y2_k1 + 2*y2_k2 + 2*y2_k3 + y2_k4)/6)*h);
+    }
+};
+
+template <class Method, class RHS>
+struct Stepper {
+    /* advance steps first .. first+count-1; results up to step `first` are already in place */
+    static inline void run(RHS &f, double h, int first, int count, double *results_y1, double *results_y2) {
+        double y1 = results_y1[first];
+        double y2 = results_y2[first];
+        for (int i=first; i<first+count; i++) {
+            f.begin(i, y1, y2);
+            Method::step(f, h, y1, y2);
+            results_y1[i+1] = y1;
+            results_y2[i+1] = y2;
+        }
+    }
+};
+
+#endif // STEPPER_H
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "sweep.h"
+
+/*
+ * trial outcomes held by a wave of points: it has as many points as fit,
+ * and at least one. 2^18 outcomes are 8 MiB
+ */
+#define SWEEP_WAVE_TRIALS (1 << 18)
+
+/* random streams of the designs, clear of the models' noise channels */
+#define SWEEP_STREAM_UNIFORM 0x100
+#define SWEEP_STREAM_PERMUTE (SWEEP_STREAM_UNIFORM + SWEEP_MAX_AXES)
+
+/* rounds of the Feistel network behind the Latin hypercube's permutations */
+#define SWEEP_FEISTEL_ROUNDS 4
+
+const char *sweep_design_name(sweep_design_t design) {
+    switch (design) {
+        case SWEEP_GRID: return "grid";
+        case SWEEP_RANDOM: return "random";
+        case SWEEP_LHS: return "lhs";
+        case SWEEP_SOBOL: return "sobol";
+        default: return "unknown";
+    }
+}
+
+int sweep_design_from_name(const char *name) {
+    for (int design=0; design<SWEEP_DESIGN_COUNT; design++) {
+        if (strcmp(name, sweep_design_name((sweep_design_t)design)) == 0) return design;
+    }
+    return -1;
+}
+
+long sweep_points(const sweep_t *sweep) {
+    if (sweep->design != SWEEP_GRID) return sweep->n_points;
+    long points = 1;
+    for (int a=0; a<sweep->n_axes; a++) points *= sweep->axes[a].count > 0 ? sweep->axes[a].count : 1;
+    return points;
+}
+
+/*****************************************************************************
+ *
+ * Designs
+ *
+ *****************************************************************************/
+
+/*
+ * primitive polynomials and initial direction numbers of the Sobol sequence
+ * for dimensions 2 .. 16, from Joe & Kuo (2008), "Constructing Sobol
+ * sequences with better two-dimensional projections" (new-joe-kuo-6.21201).
+ * the first dimension is the van der Corput sequence
+ */
+typedef struct sobol_poly_s {
+    int degree;
+    unsigned a;         /* inner coefficients of the polynomial, highest power first */
+    unsigned m[6];
+} sobol_poly_t;
+
+static const sobol_poly_t sobol_polys[SWEEP_MAX_AXES-1] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+    {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}},
+};
+
+typedef struct sobol_directions_s {
+    uint32_t v[SWEEP_MAX_AXES][32];
+} sobol_directions_t;
+
+static sobol_directions_t sobol_init() {
+    sobol_directions_t d;
+    for (int k=0; k<32; k++) d.v[0][k] = 1u << (31-k);
+    for (int dim=1; dim<SWEEP_MAX_AXES; dim++) {
+        const sobol_poly_t *p = &sobol_polys[dim-1];
+        uint32_t *v = d.v[dim];
+        for (int k=0; k<p->degree; k++) v[k] = p->m[k] << (31-k);
+        for (int k=p->degree; k<32; k++) {
+            v[k] = v[k-p->degree] ^ (v[k-p->degree] >> p->degree);
+            for (int i=1; i<p->degree; i++) {
+                if ((p->a >> (p->degree-1-i)) & 1) v[k] ^= v[k-i];
+            }
+        }
+    }
+    return d;
+}
+
+/* coordinate `dim` of Sobol point `index`, in [0, 1) */
+static double sobol(uint32_t index, int dim) {
+    static const sobol_directions_t directions = sobol_init();
+    uint32_t gray = index ^ (index >> 1);
+    uint32_t x = 0;
+    for (int k=0; gray != 0; k++, gray >>= 1) {
+        if (gray & 1) x ^= directions.v[dim][k];
+    }
+    return x * (1.0 / 4294967296.0);
+}
+
+/*
+ * a pseudo random permutation of 0 .. n-1: a balanced Feistel network over
+ * the smallest even number of bits that holds n, walked until it lands
+ * inside. a pure function of its arguments, so no table of n entries
+ */
+static uint32_t permute(const noise_key_t *key, uint32_t stream, uint32_t index, uint32_t n) {
+    int bits = 2;
+    while (bits < 32 && (1ull << bits) < n) bits += 2;
+    const int half = bits / 2;
+    const uint32_t mask = (1u << half) - 1;
+
+    uint32_t x = index;
+    do {
+        uint32_t left = x >> half, right = x & mask;
+        for (int r=0; r<SWEEP_FEISTEL_ROUNDS; r++) {
+            uint32_t f[4];
+            rng_bits(key, stream, ((uint32_t)r << 24) | right, f);
+            uint32_t next = left ^ (f[0] & mask);
+            left = right;
+            right = next;
+        }
+        x = (left << half) | right;
+    } while (x >= n);
+    return x;
+}
+
+void sweep_point(const sweep_t *sweep, long index, double *values) {
+    noise_key_t key = noise_key((int)sweep->design_seed, 0);
+    long rest = index;
+    for (int a=sweep->n_axes-1; a>=0; a--) {
+        const sweep_axis_t *axis = &sweep->axes[a];
+        double u;
+        switch (sweep->design) {
+            case SWEEP_GRID: {
+                /* the last axis varies fastest */
+                int count = axis->count > 0 ? axis->count : 1;
+                int k = rest % count;
+                rest /= count;
+                u = count > 1 ? (double)k / (count-1) : 0.0;
+                break;
+            }
+            case SWEEP_RANDOM:
+                u = rng_uniform(&key, SWEEP_STREAM_UNIFORM + a, (uint32_t)index);
+                break;
+            case SWEEP_LHS: {
+                uint32_t stratum = permute(&key, SWEEP_STREAM_PERMUTE + a, (uint32_t)index, (uint32_t)sweep->n_points);
+                u = (stratum + rng_uniform(&key, SWEEP_STREAM_UNIFORM + a, (uint32_t)index)) / sweep->n_points;
+                break;
+            }
+            default:
+                u = sobol((uint32_t)index, a);
+                break;
+        }
+        values[a] = axis->lo + (axis->hi - axis->lo) * u;
+    }
+}
+
+/*****************************************************************************
+ *
+ * Work stealing
+ *
+ * Each worker owns a range of the wave's jobs and takes them from the
+ * front. One that runs out takes the back half of another's range; jobs are
+ * never added, so when no range has any left the wave is done.
+ *
+ *****************************************************************************/
+
+typedef struct sweep_queue_s {
+    std::mutex lock;
+    long next;
+    long end;
+} sweep_queue_t;
+
+static bool sweep_take(std::vector<sweep_queue_t> &queues, int self, long *job) {
+    sweep_queue_t &own = queues[self];
+    {
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.next < own.end) {
+            *job = own.next++;
+            return true;
+        }
+    }
+
+    const int n = (int)queues.size();
+    for (int v=1; v<n; v++) {
+        sweep_queue_t &victim = queues[(self + v) % n];
+        long begin, end;
+        {
+            std::lock_guard<std::mutex> guard(victim.lock);
+            long left = victim.end - victim.next;
+            if (left <= 0) continue;
+            long take = (left + 1) / 2;
+            end = victim.end;
+            begin = end - take;
+            victim.end = begin;
+        }
+        std::lock_guard<std::mutex> guard(own.lock);
+        own.next = begin + 1;
+        own.end = end;
+        *job = begin;
+        return true;
+    }
+    return false;
+}
+
+/*****************************************************************************
+ *
+ * Sweep
+ *
+ *****************************************************************************/
+
+int run_sweep(const sweep_t *sweep, sweep_emit_t emit, void *user) {
+    const model_t m = sweep->m;
+    const long n_points = sweep_points(sweep);
+    const int n_trials = sweep->n_trials > 0 ? sweep->n_trials : 1;
+    const int chunks = (n_trials + ENSEMBLE_CHUNK - 1) / ENSEMBLE_CHUNK;
+    const size_t params_size = model_params_size(m);
+    int threads = sweep->threads > 0 ? sweep->threads : ensemble_default_threads();
+
+    long wave_points = SWEEP_WAVE_TRIALS / n_trials;
+    if (wave_points < 1) wave_points = 1;
+    if (wave_points > n_points) wave_points = n_points;
+
+    std::vector<char> params(wave_points * params_size);
+    std::vector<boundary_t> boundaries(wave_points);
+    std::vector<sweep_row_t> rows(wave_points);
+    std::vector<trial_outcome_t> outcomes((size_t)wave_points * n_trials);
+    std::vector<std::atomic<int> > remaining(wave_points);
+
+    for (long wave_first=0; wave_first<n_points; wave_first+=wave_points) {
+        const long points = std::min(wave_points, n_points - wave_first);
+
+        /* the parameters of each point in the wave */
+        for (long k=0; k<points; k++) {
+            void *p = params.data() + k * params_size;
+            sweep_row_t *row = &rows[k];
+            memcpy(p, sweep->params, params_size);
+            row->point = wave_first + k;
+            sweep_point(sweep, row->point, row->values);
+            for (int a=0; a<sweep->n_axes; a++) {
+                model_set_param_value(m, p, sweep->axes[a].name, row->values[a]);
+                model_get_param(m, p, sweep->axes[a].name, &row->values[a]);
+            }
+            if (sweep->boundary != nullptr) {
+                boundaries[k] = *sweep->boundary;
+                model_get_param(m, p, "population", &boundaries[k].population);
+            }
+            remaining[k].store(chunks, std::memory_order_relaxed);
+        }
+
+        /* jobs are (point, chunk of trials), dealt out in even ranges to start with */
+        const long jobs = points * chunks;
+        const int workers = (int)std::min<long>(threads, jobs);
+        std::vector<sweep_queue_t> queues(workers);
+        for (int w=0; w<workers; w++) {
+            queues[w].next = jobs * w / workers;
+            queues[w].end = jobs * (w+1) / workers;
+        }
+
+        auto worker = [&](int self) {
+            ensemble_workspace_t *ws = ensemble_workspace_create();
+            long job;
+            while (sweep_take(queues, self, &job)) {
+                long k = job / chunks;
+                int first = (int)(job % chunks) * ENSEMBLE_CHUNK;
+                int n = std::min(n_trials - first, ENSEMBLE_CHUNK);
+                trial_outcome_t *point_outcomes = outcomes.data() + (size_t)k * n_trials;
+                ensemble_run_trials(ws, m, sweep->method, params.data() + k * params_size, first, n,
+                                    sweep->boundary != nullptr ? &boundaries[k] : nullptr, point_outcomes + first);
+
+                /* whoever runs a point's last chunk summarises it */
+                if (remaining[k].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    ensemble_compute_stats(point_outcomes, n_trials, &rows[k].stats);
+                }
+            }
+            ensemble_workspace_destroy(ws);
+        };
+
+        std::vector<std::thread> pool;
+        for (int w=1; w<workers; w++) pool.push_back(std::thread(worker, w));
+        worker(0);
+        for (auto &t : pool) t.join();
+
+        for (long k=0; k<points; k++) {
+            int status = emit(&rows[k], user);
+            if (status != 0) return status;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstdint>
+#include "ensemble.h"
+
+/*
+ * Parameter sweeps: an ensemble at every point of a design over some of a
+ * model's parameters, summarised one row per point.
+ *
+ * Every point runs the same trials (trial j draws the noise of (seed, j)),
+ * so neighbouring points differ only by their parameters, and a point's
+ * results do not depend on the design it came from or on how the work was
+ * scheduled. The (point, chunk of trials) jobs are shared out over a work
+ * stealing pool a wave of points at a time; a wave's trial outcomes are
+ * kept until its rows are emitted, in point order, and then dropped, so a
+ * sweep of millions of points runs in a fixed amount of memory.
+ */
+
+/* most parameters a sweep can vary (the dimensions of the Sobol table) */
+#define SWEEP_MAX_AXES 16
+
+typedef enum {
+    SWEEP_GRID = 0,     /* every combination of `count` evenly spaced values per axis */
+    SWEEP_RANDOM,       /* independent uniform points */
+    SWEEP_LHS,          /* Latin hypercube: each axis split in n_points strata, one point per stratum */
+    SWEEP_SOBOL,        /* Sobol low discrepancy sequence, Joe & Kuo direction numbers */
+    SWEEP_DESIGN_COUNT
+} sweep_design_t;
+
+/* one varied parameter, over [lo, hi] */
+typedef struct sweep_axis_s {
+    const char *name;   /* parameter name, as for model_set_param */
+    double lo;
+    double hi;
+    int count;          /* values on a grid (lo alone if 1) */
+} sweep_axis_t;
+
+typedef struct sweep_s {
+    model_t m;
+    method_t method;
+    const void *params;         /* every other parameter, and the seed of the trials */
+    int n_axes;
+    sweep_axis_t axes[SWEEP_MAX_AXES];
+    sweep_design_t design;
+    long n_points;              /* points of a random, lhs or sobol design; a grid has the product of the counts */
+    uint32_t design_seed;       /* draws of the random and lhs designs */
+    int n_trials;               /* trials per point */
+    int threads;                /* 0 for one per core */
+    const boundary_t *boundary; /* a quorum's population is taken from each point */
+} sweep_t;
+
+/* the summary of one point */
+typedef struct sweep_row_s {
+    long point;                     /* index in the design */
+    double values[SWEEP_MAX_AXES];  /* of the axes, as set (int parameters rounded) */
+    ensemble_stats_t stats;
+} sweep_row_t;
+
+/* receives the rows in point order; a nonzero return stops the sweep */
+typedef int (*sweep_emit_t)(const sweep_row_t *row, void *user);
+
+/* design names as used on the command line ("grid", "random", "lhs", "sobol") */
+const char *sweep_design_name(sweep_design_t design);
+int sweep_design_from_name(const char *name); /* -1 if unknown */
+
+/* number of points in the design */
+long sweep_points(const sweep_t *sweep);
+
+/* the axis values of point `index`, a pure function of the design and index */
+void sweep_point(const sweep_t *sweep, long index, double *values);
+
+/*
+ * run the sweep, handing each row to emit. returns 0 when every point was
+ * run, or the nonzero value emit stopped it with
+ */
+int run_sweep(const sweep_t *sweep, sweep_emit_t emit, void *user);
+
+#endif // SWEEP_H
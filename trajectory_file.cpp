@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "ensemble.h"
+#include "trajectory_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(trajectory_header_t) == 112, "trajectory_header_t must have no padding");
+static_assert(sizeof(trajectory_column_t) == 32, "trajectory_column_t must have no padding");
+static_assert(sizeof(trajectory_param_t) == 32, "trajectory_param_t must have no padding");
+static_assert(sizeof(trajectory_index_t) == 24, "trajectory_index_t must have no padding");
+
+/* trials handed to a writer thread at a time */
+#define TRAJECTORY_CHUNK 16
+
+static const char *column_names[TRAJECTORY_COLUMNS] = {"y1", "y2"};
+
+struct trajectory_file_s {
+    char *base;
+    size_t size;
+    bool writable;
+    const trajectory_header_t *header;
+    const trajectory_column_t *columns[TRAJECTORY_COLUMNS];
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
+
+const char *trajectory_error_name(int error) {
+    switch (error) {
+        case 0: return "no error";
+        case TRAJECTORY_ERROR_SYSTEM: return strerror(errno);
+        case TRAJECTORY_ERROR_FORMAT: return "not a trajectory file, or a damaged one";
+        case TRAJECTORY_ERROR_VERSION: return "unsupported trajectory file version or byte order";
+        default: return "unknown error";
+    }
+}
+
+static uint64_t align_up(uint64_t n) {
+    return (n + TRAJECTORY_ALIGN - 1) / TRAJECTORY_ALIGN * TRAJECTORY_ALIGN;
+}
+
+/*****************************************************************************
+ *
+ * Mapping
+ *
+ *****************************************************************************/
+
+/* map path: a new file of size bytes for writing, or (size 0) an existing one for reading */
+static int map_file(const char *path, size_t size, trajectory_file_t *tf) {
+    tf->writable = size > 0;
+#ifdef _WIN32
+    tf->file = CreateFileA(path, GENERIC_READ | (tf->writable ? GENERIC_WRITE : 0), FILE_SHARE_READ, NULL,
+                           tf->writable ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (tf->file == INVALID_HANDLE_VALUE) {
+        errno = GetLastError() == ERROR_FILE_NOT_FOUND ? ENOENT : EIO;
+        return TRAJECTORY_ERROR_SYSTEM;
+    }
+    if (!tf->writable) {
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(tf->file, &file_size)) {
+            CloseHandle(tf->file);
+            errno = EIO;
+            return TRAJECTORY_ERROR_SYSTEM;
+        }
+        size = (size_t)file_size.QuadPart;
+        if (size < sizeof(trajectory_header_t)) {
+            CloseHandle(tf->file);
+            return TRAJECTORY_ERROR_FORMAT;
+        }
+    }
+    /* a mapping larger than the file extends it */
+    tf->mapping = CreateFileMappingA(tf->file, NULL, tf->writable ? PAGE_READWRITE : PAGE_READONLY,
+                                     (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+    void *base = tf->mapping != NULL ? MapViewOfFile(tf->mapping, tf->writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size) : NULL;
+    if (base == NULL) {
+        if (tf->mapping != NULL) CloseHandle(tf->mapping);
+        CloseHandle(tf->file);
+        errno = ENOMEM;
+        return TRAJECTORY_ERROR_SYSTEM;
+    }
+#else
+    tf->fd = tf->writable ? open(path, O_RDWR | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+    if (tf->fd < 0) return TRAJECTORY_ERROR_SYSTEM;
+    if (tf->writable) {
+        /* sparse: pages not written read as 0 and take no space */
+        if (ftruncate(tf->fd, (off_t)size) != 0) {
+            close(tf->fd);
+            return TRAJECTORY_ERROR_SYSTEM;
+        }
+    } else {
+        struct stat st;
+        if (fstat(tf->fd, &st) != 0) {
+            close(tf->fd);
+            return TRAJECTORY_ERROR_SYSTEM;
+        }
+        size = (size_t)st.st_size;
+        if (size < sizeof(trajectory_header_t)) {
+            close(tf->fd);
+            return TRAJECTORY_ERROR_FORMAT;
+        }
+    }
+    void *base = mmap(nullptr, size, tf->writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, tf->fd, 0);
+    if (base == MAP_FAILED) {
+        close(tf->fd);
+        return TRAJECTORY_ERROR_SYSTEM;
+    }
+#endif
+    tf->base = (char *)base;
+    tf->size = size;
+    tf->header = (const trajectory_header_t *)base;
+    return 0;
+}
+
+static int unmap_file(trajectory_file_t *tf) {
+    int status = 0;
+#ifdef _WIN32
+    if (tf->writable && !FlushViewOfFile(tf->base, 0)) status = -1;
+    if (!UnmapViewOfFile(tf->base)) status = -1;
+    CloseHandle(tf->mapping);
+    if (tf->writable && !FlushFileBuffers(tf->file)) status = -1;
+    if (!CloseHandle(tf->file)) status = -1;
+#else
+    if (tf->writable && msync(tf->base, tf->size, MS_SYNC) != 0) status = -1;
+    if (munmap(tf->base, tf->size) != 0) status = -1;
+    if (close(tf->fd) != 0) status = -1;
+#endif
+    return status;
+}
+
+/*****************************************************************************
+ *
+ * Files
+ *
+ *****************************************************************************/
+
+int trajectory_file_create(const char *path, model_t m, method_t method, const void *params,
+                           long first_trial, long n_trials, bool with_index, trajectory_file_t **tf) {
+    int n_params;
+    const param_info_t *info = model_param_info(m, &n_params);
+    const uint64_t length = model_params_length(m, params);
+    const uint64_t column_size = (uint64_t)n_trials * length * sizeof(double);
+
+    /* the layout */
+    trajectory_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.version = TRAJECTORY_VERSION;
+    header.byte_order = TRAJECTORY_BYTE_ORDER;
+    header.header_size = sizeof(trajectory_header_t);
+    header.flags = with_index ? TRAJECTORY_HAS_INDEX : 0;
+    header.model = m;
+    header.method = method;
+    header.n_columns = TRAJECTORY_COLUMNS;
+    header.n_params = n_params;
+    header.n_trials = n_trials;
+    header.first_trial = first_trial;
+    header.length = length;
+    double seed = 0., h = 0.;
+    model_get_param(m, params, "seed", &seed);
+    model_get_param(m, params, "h", &h);
+    header.seed = (int64_t)seed;
+    header.h = h;
+    header.columns_offset = sizeof(trajectory_header_t);
+    header.params_offset = header.columns_offset + TRAJECTORY_COLUMNS * sizeof(trajectory_column_t);
+    uint64_t offset = align_up(header.params_offset + n_params * sizeof(trajectory_param_t));
+    trajectory_column_t columns[TRAJECTORY_COLUMNS];
+    memset(columns, 0, sizeof(columns));
+    for (int c=0; c<TRAJECTORY_COLUMNS; c++) {
+        strncpy(columns[c].name, column_names[c], sizeof(columns[c].name) - 1);
+        columns[c].offset = offset;
+        columns[c].size = column_size;
+        offset = align_up(offset + column_size);
+    }
+    if (with_index) {
+        header.index_offset = offset;
+        offset += (uint64_t)n_trials * sizeof(trajectory_index_t);
+    }
+    header.file_size = offset;
+    if ((uint64_t)(size_t)offset != offset) {
+        errno = EFBIG;
+        return TRAJECTORY_ERROR_SYSTEM;
+    }
+
+    trajectory_file_t *f = new trajectory_file_t;
+    int status = map_file(path, (size_t)offset, f);
+    if (status != 0) {
+        delete f;
+        return status;
+    }
+
+    memcpy(f->base, &header, sizeof(header));
+    memcpy(f->base + header.columns_offset, columns, sizeof(columns));
+    trajectory_param_t *stored = (trajectory_param_t *)(f->base + header.params_offset);
+    for (int i=0; i<n_params; i++) {
+        strncpy(stored[i].name, info[i].name, sizeof(stored[i].name) - 1);
+        model_get_param(m, params, info[i].name, &stored[i].value);
+    }
+    for (int c=0; c<TRAJECTORY_COLUMNS; c++) f->columns[c] = (const trajectory_column_t *)(f->base + header.columns_offset) + c;
+    *tf = f;
+    return 0;
+}
+
+int trajectory_file_open(const char *path, trajectory_file_t **tf) {
+    trajectory_file_t *f = new trajectory_file_t;
+    int status = map_file(path, 0, f);
+    if (status != 0) {
+        delete f;
+        return status;
+    }
+
+    /* check everything the accessors rely on, so they need not */
+    const trajectory_header_t *h = f->header;
+    const uint64_t size = f->size;
+    status = 0;
+    if (memcmp(h->magic, TRAJECTORY_MAGIC, sizeof(h->magic)) != 0) {
+        status = TRAJECTORY_ERROR_FORMAT;
+    } else if (h->byte_order != TRAJECTORY_BYTE_ORDER || h->version > TRAJECTORY_VERSION) {
+        status = TRAJECTORY_ERROR_VERSION;
+    } else if (h->header_size != sizeof(trajectory_header_t) || h->file_size != size || h->model >= MODEL_COUNT ||
+               h->columns_offset > size || h->n_columns > (size - h->columns_offset) / sizeof(trajectory_column_t) ||
+               h->params_offset > size || h->n_params > (size - h->params_offset) / sizeof(trajectory_param_t) ||
+               (h->length > 0 && h->n_trials > size / sizeof(double) / h->length)) {
+        status = TRAJECTORY_ERROR_FORMAT;
+    } else if ((h->flags & TRAJECTORY_HAS_INDEX) &&
+               (h->index_offset > size || h->n_trials > (size - h->index_offset) / sizeof(trajectory_index_t))) {
+        status = TRAJECTORY_ERROR_FORMAT;
+    }
+
+    /* find the columns by name, each a whole number of trials within the file */
+    const uint64_t column_size = h->n_trials * h->length * sizeof(double);
+    for (int c=0; c<TRAJECTORY_COLUMNS && status == 0; c++) {
+        f->columns[c] = nullptr;
+        const trajectory_column_t *columns = (const trajectory_column_t *)(f->base + h->columns_offset);
+        for (uint32_t k=0; k<h->n_columns; k++) {
+            if (strncmp(columns[k].name, column_names[c], sizeof(columns[k].name)) == 0) f->columns[c] = &columns[k];
+        }
+        const trajectory_column_t *column = f->columns[c];
+        if (column == nullptr || column->size != column_size || column->offset % sizeof(double) != 0 ||
+            column->offset > size || column->size > size - column->offset) {
+            status = TRAJECTORY_ERROR_FORMAT;
+        }
+    }
+
+    if (status != 0) {
+        unmap_file(f);
+        delete f;
+        return status;
+    }
+    *tf = f;
+    return 0;
+}
+
+int trajectory_file_close(trajectory_file_t *tf) {
+    int status = unmap_file(tf);
+    delete tf;
+    return status;
+}
+
+const trajectory_header_t *trajectory_file_header(const trajectory_file_t *tf) {
+    return tf->header;
+}
+
+const double *trajectory_file_column(const trajectory_file_t *tf, trajectory_column_id_t column, long trial) {
+    if (column < 0 || column >= TRAJECTORY_COLUMNS || trial < 0 || (uint64_t)trial >= tf->header->n_trials) return nullptr;
+    return (const double *)(tf->base + tf->columns[column]->offset) + (uint64_t)trial * tf->header->length;
+}
+
+double *trajectory_file_column_for_writing(trajectory_file_t *tf, trajectory_column_id_t column, long trial) {
+    if (!tf->writable) return nullptr;
+    return (double *)trajectory_file_column(tf, column, trial);
+}
+
+int trajectory_file_get_index(const trajectory_file_t *tf, long trial, decision_t *decision) {
+    const trajectory_header_t *h = tf->header;
+    if (!(h->flags & TRAJECTORY_HAS_INDEX) || trial < 0 || (uint64_t)trial >= h->n_trials) return -1;
+    const trajectory_index_t *index = (const trajectory_index_t *)(tf->base + h->index_offset) + trial;
+    decision->choice = index->choice;
+    decision->time = index->decision_time;
+    decision->steps = (int)index->steps;
+    decision->written = decision->steps;
+    return 0;
+}
+
+void trajectory_file_set_index(trajectory_file_t *tf, long trial, const decision_t *decision) {
+    const trajectory_header_t *h = tf->header;
+    if (!tf->writable || !(h->flags & TRAJECTORY_HAS_INDEX) || trial < 0 || (uint64_t)trial >= h->n_trials) return;
+    trajectory_index_t *index = (trajectory_index_t *)(tf->base + h->index_offset) + trial;
+    index->steps = decision->steps;
+    index->choice = decision->choice;
+    index->reserved = 0;
+    index->decision_time = decision->time;
+}
+
+void trajectory_file_params(const trajectory_file_t *tf, void *params) {
+    const trajectory_header_t *h = tf->header;
+    const model_t m = (model_t)h->model;
+    model_set_defaults(m, params);
+    const trajectory_param_t *stored = (const trajectory_param_t *)(tf->base + h->params_offset);
+    for (uint32_t i=0; i<h->n_params; i++) {
+        char name[sizeof(stored[i].name) + 1];
+        memcpy(name, stored[i].name, sizeof(stored[i].name));
+        name[sizeof(stored[i].name)] = '\0';
+        model_set_param_value(m, params, name, stored[i].value);
+    }
+}
+
+/*****************************************************************************
+ *
+ * Writing runs
+ *
+ *****************************************************************************/
+
+int write_trajectory_file(const char *path, model_t m, method_t method, const void *params,
+                          long first_trial, long n_trials, int threads, const boundary_t *boundary) {
+    trajectory_file_t *tf;
+    int status = trajectory_file_create(path, m, method, params, first_trial, n_trials, true, &tf);
+    if (status != 0) return status;
+
+    const int length = (int)tf->header->length;
+    double seed = 0.;
+    model_get_param(m, params, "seed", &seed);
+
+    const long n_chunks = (n_trials + TRAJECTORY_CHUNK - 1) / TRAJECTORY_CHUNK;
+    if (threads <= 0) threads = ensemble_default_threads();
+    if (threads > n_chunks) threads = (int)(n_chunks > 0 ? n_chunks : 1);
+    std::atomic<long> next_chunk(0);
+
+    auto worker = [&]() {
+        for (;;) {
+            long chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= n_chunks) break;
+            long last = std::min(n_trials, (chunk + 1) * TRAJECTORY_CHUNK);
+            for (long trial=chunk * TRAJECTORY_CHUNK; trial<last; trial++) {
+                double *results_y1 = trajectory_file_column_for_writing(tf, TRAJECTORY_Y1, trial);
+                double *results_y2 = trajectory_file_column_for_writing(tf, TRAJECTORY_Y2, trial);
+                noise_key_t key = noise_key((int)seed, (uint32_t)(first_trial + trial));
+                decision_t decision = {0, -1., length, length};
+                model_integrate_until(m, method, params, &key, boundary, results_y1, results_y2, &decision);
+
+                /*
+                 * a run stopped at its boundary may have gone to the end of
+                 * the block past it: clear that, and leave the pages after
+                 * it untouched, so they take no space
+                 */
+                memset(results_y1 + decision.steps, 0, (decision.written - decision.steps) * sizeof(double));
+                memset(results_y2 + decision.steps, 0, (decision.written - decision.steps) * sizeof(double));
+                trajectory_file_set_index(tf, trial, &decision);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i=1; i<threads; i++) pool.push_back(std::thread(worker));
+    worker();
+    for (auto &t : pool) t.join();
+
+    return trajectory_file_close(tf) != 0 ? TRAJECTORY_ERROR_SYSTEM : 0;
+}
@@ -0,0 +1,130 @@
+#ifndef TRAJECTORY_FILE_H
+#define TRAJECTORY_FILE_H
+
+#include <cstdint>
+#include "simulation.h"
+
+/*
+ * A binary, columnar archive of trajectories, read and written through a
+ * memory mapping.
+ *
+ * Layout (little endian, version 1):
+ *   header        trajectory_header_t
+ *   columns       n_columns x trajectory_column_t: "y1", then "y2"
+ *   params        n_params x trajectory_param_t: the model's parameters,
+ *                 in table order, so the run can be set up again
+ *   y1 column     n_trials x length doubles, trial after trial
+ *   y2 column     likewise
+ *   index         n_trials x trajectory_index_t, if TRAJECTORY_HAS_INDEX
+ * Each column starts on a TRAJECTORY_ALIGN boundary, so a mapped column is
+ * page aligned and a trial's results are a plain array in place.
+ *
+ * Opening a file maps it and checks the header; nothing else is read until
+ * it is used, so the cost of opening does not grow with the file. A new
+ * file is created at its full size and mapped for writing, and an
+ * integrator writes each trial straight into its columns.
+ */
+
+#define TRAJECTORY_MAGIC "IDTRAJ\r\n"
+#define TRAJECTORY_VERSION 1
+#define TRAJECTORY_BYTE_ORDER 0x01020304u
+#define TRAJECTORY_ALIGN 4096
+
+/* flags */
+#define TRAJECTORY_HAS_INDEX 1u
+
+/* columns written by version 1 */
+typedef enum {
+    TRAJECTORY_Y1 = 0,
+    TRAJECTORY_Y2,
+    TRAJECTORY_COLUMNS
+} trajectory_column_id_t;
+
+typedef struct trajectory_header_s {
+    char magic[8];              /* TRAJECTORY_MAGIC */
+    uint32_t version;
+    uint32_t byte_order;        /* TRAJECTORY_BYTE_ORDER as the writer stored it */
+    uint32_t header_size;       /* sizeof(trajectory_header_t) */
+    uint32_t flags;
+    uint32_t model;             /* model_t */
+    uint32_t method;            /* method_t */
+    uint32_t n_columns;
+    uint32_t n_params;
+    uint64_t n_trials;
+    uint64_t first_trial;       /* trial number (of the seed's noise) of the first trial */
+    uint64_t length;            /* results per trial */
+    int64_t seed;
+    double h;
+    uint64_t columns_offset;
+    uint64_t params_offset;
+    uint64_t index_offset;      /* 0 without an index */
+    uint64_t file_size;
+} trajectory_header_t;
+
+typedef struct trajectory_column_s {
+    char name[16];
+    uint64_t offset;            /* of the first trial's results */
+    uint64_t size;              /* in bytes, all trials */
+} trajectory_column_t;
+
+typedef struct trajectory_param_s {
+    char name[24];
+    double value;
+} trajectory_param_t;
+
+/* how a trial ended, for runs stopped at a boundary */
+typedef struct trajectory_index_s {
+    uint64_t steps;             /* results written; the rest of the trial's columns are 0 */
+    int32_t choice;             /* as decision_t */
+    uint32_t reserved;
+    double decision_time;
+} trajectory_index_t;
+
+typedef struct trajectory_file_s trajectory_file_t;
+
+/* errors from trajectory_file_create and trajectory_file_open */
+#define TRAJECTORY_ERROR_SYSTEM -1      /* see errno */
+#define TRAJECTORY_ERROR_FORMAT -2      /* not a trajectory file, or a damaged one */
+#define TRAJECTORY_ERROR_VERSION -3     /* a version or byte order this build cannot read */
+
+const char *trajectory_error_name(int error);
+
+/*
+ * create path, sized for n_trials trials of the model's length, and map it
+ * for writing. returns 0 or an error
+ */
+int trajectory_file_create(const char *path, model_t m, method_t method, const void *params,
+                           long first_trial, long n_trials, bool with_index, trajectory_file_t **tf);
+
+/* map path for reading. returns 0 or an error */
+int trajectory_file_open(const char *path, trajectory_file_t **tf);
+
+/* unmap and close, flushing a file being written. returns 0, or -1 if writing it failed */
+int trajectory_file_close(trajectory_file_t *tf);
+
+const trajectory_header_t *trajectory_file_header(const trajectory_file_t *tf);
+
+/* a trial's results in a column, length of them; null for a bad column or trial */
+const double *trajectory_file_column(const trajectory_file_t *tf, trajectory_column_id_t column, long trial);
+
+/* the same, writable, in a file being created */
+double *trajectory_file_column_for_writing(trajectory_file_t *tf, trajectory_column_id_t column, long trial);
+
+/* how a trial ended. returns -1 if the file has no index */
+int trajectory_file_get_index(const trajectory_file_t *tf, long trial, decision_t *decision);
+void trajectory_file_set_index(trajectory_file_t *tf, long trial, const decision_t *decision);
+
+/* set params (a struct of the file's model) to the defaults, then to the values stored */
+void trajectory_file_params(const trajectory_file_t *tf, void *params);
+
+/*
+ * run trials first_trial .. first_trial+n_trials-1 of the seed with any
+ * method on threads threads (0 for one per core), stopping each at
+ * boundary if not null, straight into a new file at path. a stopped
+ * trial's column reads 0 past its decision, and the pages after the block
+ * it stopped in are never written, so take no space. returns 0 or an error
+ */
+int write_trajectory_file(const char *path, model_t m, method_t method, const void *params,
+                          long first_trial, long n_trials, int threads, const boundary_t *boundary);
+
+#endif // TRAJECTORY_FILE_H